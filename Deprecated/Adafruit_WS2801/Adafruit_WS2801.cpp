@@ -1,30 +1,60 @@
-#include "SPI.h"
 #include "Adafruit_WS2801.h"
 
 // Example to control WS2801-based RGB LED Modules in a strand or strip
 // Written by Adafruit - MIT license
 /*****************************************************************************/
 
+// Pixels a streamed show() builds up before handing them to the output
+#define STREAM_CHUNK 16
+
+// Store one pixel's three bytes, returning true if that changed anything.
+// Used by every setter so show() knows how much of the strand is stale.
+static inline bool storePixel(uint8_t *p, uint8_t a, uint8_t b, uint8_t c) {
+  if(p[0] == a && p[1] == b && p[2] == c) return false;
+  p[0] = a;
+  p[1] = b;
+  p[2] = c;
+  return true;
+}
+
 // Constructor for use with hardware SPI (specific clock/data pins):
-Adafruit_WS2801::Adafruit_WS2801(uint16_t n, uint8_t order) {
+Adafruit_WS2801::Adafruit_WS2801(uint32_t n, uint8_t order) {
   rgb_order = order;
+  wallWidth = 18;
+  wallHeight = 11;
+  output    = NULL;
+  indexMap  = NULL;
+  ownMap    = true;
+  pixelGenerator = NULL;
+  rowGenerator   = NULL;
+  generatorArg   = NULL;
+  rowColours     = NULL;
   alloc(n);
   updatePins();
 }
 
 // Constructor for use with arbitrary clock/data pins, and LED wall width/height:
-Adafruit_WS2801::Adafruit_WS2801(uint16_t n, uint8_t dpin, uint8_t cpin, uint8_t order, uint8_t w, uint8_t h) {
+Adafruit_WS2801::Adafruit_WS2801(uint32_t n, uint8_t dpin, uint8_t cpin, uint8_t order, uint8_t w, uint8_t h) {
   wallWidth = w;
   wallHeight = h;
   rgb_order = order;
+  output    = NULL;
+  indexMap  = NULL;
+  ownMap    = true;
+  pixelGenerator = NULL;
+  rowGenerator   = NULL;
+  generatorArg   = NULL;
+  rowColours     = NULL;
   alloc(n);
   updatePins(dpin, cpin);
 }
 
 // Allocate 3 bytes per pixel, init to RGB 'off' state:
-void Adafruit_WS2801::alloc(uint16_t n) {
+void Adafruit_WS2801::alloc(uint32_t n) {
   begun   = false;
   numLEDs = ((pixels = (uint8_t *)calloc(n, 3)) != NULL) ? n : 0;
+  dirtyEnd = numLEDs; // First show() clears the whole strand
+  buildIndexMap();
 }
 
 // via Michael Vogt/neophob: empty constructor is used when strand length
@@ -36,10 +66,18 @@ void Adafruit_WS2801::alloc(uint16_t n) {
 Adafruit_WS2801::Adafruit_WS2801(void) {
   begun     = false;
   numLEDs   = 0;
+  dirtyEnd  = 0;
   pixels    = NULL;
   rgb_order = WS2801_RGB;
   wallWidth = 18;
   wallHeight = 11;
+  output    = NULL;
+  indexMap  = NULL;
+  ownMap    = true;
+  pixelGenerator = NULL;
+  rowGenerator   = NULL;
+  generatorArg   = NULL;
+  rowColours     = NULL;
   updatePins(); // Must assume hardware SPI until pins are set
 }
 
@@ -48,63 +86,73 @@ Adafruit_WS2801::~Adafruit_WS2801(void) {
   if (pixels != NULL) {
     free(pixels);
   }
+  if (rowColours != NULL) {
+    free(rowColours);
+  }
+  if (ownOutput) {
+    delete output;
+  }
+  if (ownMap && indexMap != NULL) {
+    free((void *)indexMap);
+  }
 }
 
-// Activate hard/soft SPI as appropriate:
+// Activate the output (hard/soft SPI, capture, ...):
 void Adafruit_WS2801::begin(void) {
-  if(hardwareSPI == true) {
-    startSPI();
-  } else {
-    pinMode(datapin, OUTPUT);
-    pinMode(clkpin , OUTPUT);
-  }
+  if(output != NULL) output->begin();
   begun = true;
 }
 
-// Change pin assignments post-constructor, switching to hardware SPI:
+// Change pin assignments post-constructor, switching to hardware SPI.
+// Host builds have no pins, so pixel data is captured in memory instead.
 void Adafruit_WS2801::updatePins(void) {
-  hardwareSPI = true;
-  datapin     = clkpin = 0;
-  // If begin() was previously invoked, init the SPI hardware now:
-  if(begun == true) startSPI();
+#ifdef LEDWALL_HOST
+  attachOutput(new WS2801Capture(), true);
+#else
+  attachOutput(new WS2801HardwareSPI(), true);
+#endif
+  // If begin() was previously invoked, the SPI hardware is initted now.
   // Otherwise, SPI is NOT initted until begin() is explicitly called.
-
-  // Note: any prior clock/data pin directions are left as-is and are
-  // NOT restored as inputs!
 }
 
 // Change pin assignments post-constructor, using arbitrary pins:
 void Adafruit_WS2801::updatePins(uint8_t dpin, uint8_t cpin) {
+#ifdef LEDWALL_HOST
+  (void)dpin;
+  (void)cpin;
+  attachOutput(new WS2801Capture(), true);
+#else
+  attachOutput(new WS2801BitBang(dpin, cpin), true);
+#endif
+  // Pins are set to outputs now if begin() was previously invoked,
+  // otherwise when begin() is called.
+}
 
-  if(begun == true) { // If begin() was previously invoked...
-    // If previously using hardware SPI, turn that off:
-    if(hardwareSPI == true) SPI.end();
-    // Regardless, now enable output on 'soft' SPI pins:
-    pinMode(dpin, OUTPUT);
-    pinMode(cpin, OUTPUT);
-  } // Otherwise, pins are not set to outputs until begin() is called.
-
-  // Note: any prior clock/data pin directions are left as-is and are
-  // NOT restored as inputs!
+// Send pixel data to a caller-supplied output (capture, file, ...).
+// The strip does not take ownership; o must outlive the strip or be
+// replaced before it is destroyed.
+void Adafruit_WS2801::setOutput(WS2801Output *o) {
+  attachOutput(o, false);
+}
 
-  hardwareSPI = false;
-  datapin     = dpin;
-  clkpin      = cpin;
-  clkport     = portOutputRegister(digitalPinToPort(cpin));
-  clkpinmask  = digitalPinToBitMask(cpin);
-  dataport    = portOutputRegister(digitalPinToPort(dpin));
-  datapinmask = digitalPinToBitMask(dpin);
+WS2801Output *Adafruit_WS2801::getOutput(void) {
+  return output;
 }
 
-// Enable SPI hardware and set up protocol details:
-void Adafruit_WS2801::startSPI(void) {
-    SPI.begin();
-    SPI.setBitOrder(MSBFIRST);
-    SPI.setDataMode(SPI_MODE0);
-    SPI.setClockDivider(SPI_CLOCK_DIV16); // 1 MHz max, else flicker
+// Swap outputs, shutting down the old one and starting the new one if
+// begin() was previously invoked:
+void Adafruit_WS2801::attachOutput(WS2801Output *o, boolean owned) {
+  if(output != NULL) {
+    if(begun == true) output->end();
+    if(ownOutput) delete output;
+  }
+  output    = o;
+  ownOutput = owned;
+  invalidate(); // New output hasn't seen the current frame
+  if((output != NULL) && (begun == true)) output->begin();
 }
 
-uint16_t Adafruit_WS2801::numPixels(void) {
+uint32_t Adafruit_WS2801::numPixels(void) {
   return numLEDs;
 }
 
@@ -116,96 +164,285 @@ uint8_t Adafruit_WS2801::h(void) {
   return wallHeight; 
 }
 
-// Change strand length (see notes with empty constructor, above):
-void Adafruit_WS2801::updateLength(uint16_t n) {
+// Change strand length (see notes with empty constructor, above).
+// While streaming, nothing is allocated, so the strand may be as long as
+// the pixels will go.
+void Adafruit_WS2801::updateLength(uint32_t n) {
   if(pixels != NULL) free(pixels); // Free existing data (if any)
-  // Allocate new data -- note: ALL PIXELS ARE CLEARED
-  numLEDs = ((pixels = (uint8_t *)calloc(n, 3)) != NULL) ? n : 0;
+  pixels = NULL;
+  if(streaming()) {
+    numLEDs = n;
+  } else {
+    // Allocate new data -- note: ALL PIXELS ARE CLEARED
+    numLEDs = ((pixels = (uint8_t *)calloc(n, 3)) != NULL) ? n : 0;
+  }
+  dirtyEnd = numLEDs;
+  buildIndexMap();
   // 'begun' state does not change -- pins retain prior modes
 }
 
+// Fill in the grid-to-strand table, so spc()/gpc() and the bulk
+// operations need no row-parity arithmetic.  Without one (no memory for
+// it) they work the index out instead, only more slowly.  AVRs can't
+// spare the RAM (two bytes a grid position), so never build it; they
+// read a setIndexMap() table from flash, or do the arithmetic.
+void Adafruit_WS2801::buildIndexMap(void) {
+#ifndef __AVR__
+  uint16_t k, n = (uint16_t)wallWidth * wallHeight;
+  uint16_t *map;
+
+  if(!ownMap || indexMap != NULL) return;
+  indexMap = map = (uint16_t *)malloc(n * sizeof(uint16_t));
+  if(map != NULL) {
+    for(k=0; k<n; k++) map[k] = ws2801Serpentine(wallWidth, k);
+  }
+#endif
+}
+
+// Use a grid-to-strand table built elsewhere, typically at compile time
+// with WS2801SerpentineMap<w, h>::table.  It must hold w() * h() entries,
+// and be in PROGMEM (as that one is), which only matters on AVRs.
+void Adafruit_WS2801::setIndexMap(const uint16_t *map) {
+  if(ownMap && indexMap != NULL) free((void *)indexMap);
+  indexMap = map;
+  ownMap   = false;
+}
+
+// Streaming mode: show() takes every pixel's colour from g as it sends
+// it, and the pixel buffer is freed.  The setters then do nothing, and
+// getPixelColor()/gpc() return 0.  For a strand longer than the board
+// has RAM for, use the empty constructor, set the generator, then set
+// the length with updateLength().  With g NULL the strip keeps its own
+// pixels again, all off.
+void Adafruit_WS2801::setGenerator(WS2801PixelGenerator g, void *arg) {
+  stream(g, NULL, arg);
+}
+
+// As setGenerator(), but g draws a grid row at a time, and the rows go
+// out in strand order as the serpentine wiring has them (a table from
+// setIndexMap() isn't consulted).  Pixels past the end of the wall are
+// sent off.  Needs only a row of colours (4 * w() bytes) of RAM.
+void Adafruit_WS2801::setRowGenerator(WS2801RowGenerator g, void *arg) {
+  stream(NULL, g, arg);
+}
+
+void Adafruit_WS2801::stream(WS2801PixelGenerator p, WS2801RowGenerator r, void *arg) {
+  uint32_t n = numLEDs;
+
+  if(rowColours != NULL) free(rowColours);
+  rowColours = NULL;
+  if(r != NULL) {
+    if((rowColours = (uint32_t *)malloc(wallWidth * sizeof(uint32_t))) == NULL) r = NULL;
+  }
+  pixelGenerator = p;
+  rowGenerator   = r;
+  generatorArg   = arg;
+  updateLength(n);
+}
+
+boolean Adafruit_WS2801::streaming(void) {
+  return (pixelGenerator != NULL) || (rowGenerator != NULL);
+}
+
 // Change RGB data order (see notes with empty constructor, above):
 void Adafruit_WS2801::updateOrder(uint8_t order) {
   rgb_order = order;
+  invalidate();
   // Existing LED data, if any, is NOT reformatted to new data order.
   // Calling function should clear or fill pixel data anew.
 }
 
+// Send pixel data out, but only as far as the last pixel changed since
+// the previous show().  WS2801 pixels keep their latched colour when a
+// shorter stream is clocked in, so the untouched tail need not be
+// resent -- and if nothing changed at all, there's nothing to do.
 void Adafruit_WS2801::show(void) {
-  uint16_t i, nl3 = numLEDs * 3; // 3 bytes per LED
-  uint8_t  bit;
-
-  // Write 24 bits per pixel:
-  if(hardwareSPI) {
-    for(i=0; i<nl3; i++) {
-      SPDR = pixels[i];
-      while(!(SPSR & (1<<SPIF)));
-    }
-  } else {
-    for(i=0; i<nl3; i++ ) {
-      for(bit=0x80; bit; bit >>= 1) {
-        if(pixels[i] & bit) *dataport |=  datapinmask;
-        else                *dataport &= ~datapinmask;
-        *clkport |=  clkpinmask;
-        *clkport &= ~clkpinmask;
+  if(output == NULL) return;
+  if(streaming()) {
+    showStreamed();
+    return;
+  }
+  if(dirtyEnd == 0) return;
+  output->start(dirtyEnd * 3);
+  output->write(pixels, dirtyEnd * 3); // 3 bytes per LED
+  output->latch(); // Data is latched by holding clock pin low for 1 millisecond
+  dirtyEnd = 0;
+}
+
+// Send the whole strand from the generator, a few pixels at a time.
+// There's nothing to compare with, so every pixel goes every time.
+void Adafruit_WS2801::showStreamed(void) {
+  uint8_t  chunk[STREAM_CHUNK * 3], *p = chunk;
+  uint32_t n, c;
+  uint8_t  row = 0, x = 0; // Grid position of pixel n, for rowGenerator
+
+  output->start(numLEDs * 3);
+  for(n = 0; n < numLEDs; n++) {
+    if(pixelGenerator != NULL) {
+      c = pixelGenerator(n, generatorArg);
+    } else if(row < wallHeight) {
+      if(x == 0) rowGenerator(row, rowColours, generatorArg);
+      c = rowColours[(row & 1) ? wallWidth - 1 - x : x];
+      if(++x == wallWidth) {
+        x = 0;
+        row++;
       }
+    } else {
+      c = 0;
+    }
+    // Same byte order as setPixelColor()
+    if(rgb_order == WS2801_RGB) { p[0] = c >> 16; p[1] = c >> 8; }
+    else                        { p[0] = c >> 8;  p[1] = c >> 16; }
+    p[2] = c;
+    if((p += 3) == chunk + sizeof(chunk)) {
+      output->write(chunk, sizeof(chunk));
+      p = chunk;
     }
   }
+  if(p > chunk) output->write(chunk, p - chunk);
+  output->latch();
+}
 
-  delay(1); // Data is latched by holding clock pin low for 1 millisecond
+// Mark the whole strand as changed, so the next show() resends all of
+// it (e.g. after the pixels lost power, or to force a refresh).
+void Adafruit_WS2801::invalidate(void) {
+  dirtyEnd = numLEDs;
 }
 
 // Set pixel color from separate 8-bit R, G, B components:
-void Adafruit_WS2801::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
-  if(n < numLEDs) { // Arrays are 0-indexed, thus NOT '<='
+void Adafruit_WS2801::setPixelColor(uint32_t n, uint8_t r, uint8_t g, uint8_t b) {
+  if(n < numLEDs && pixels != NULL) { // Arrays are 0-indexed, thus NOT '<='
     uint8_t *p = &pixels[n * 3];
+    bool     changed;
     // See notes later regarding color order
-    if(rgb_order == WS2801_RGB) {
-      *p++ = r;
-      *p++ = g;
-    } else {
-      *p++ = g;
-      *p++ = r;
-    }
-    *p++ = b;
+    if(rgb_order == WS2801_RGB) changed = storePixel(p, r, g, b);
+    else                        changed = storePixel(p, g, r, b);
+    if(changed && n >= dirtyEnd) dirtyEnd = n + 1;
   }
 }
 
 // Set pixel color from 'packed' 32-bit RGB value:
-void Adafruit_WS2801::setPixelColor(uint16_t n, uint32_t c) {
-  if(n < numLEDs) { // Arrays are 0-indexed, thus NOT '<='
+void Adafruit_WS2801::setPixelColor(uint32_t n, uint32_t c) {
+  if(n < numLEDs && pixels != NULL) { // Arrays are 0-indexed, thus NOT '<='
     uint8_t *p = &pixels[n * 3];
+    bool     changed;
     // To keep the show() loop as simple & fast as possible, the
     // internal color representation is native to different pixel
     // types.  For compatibility with existing code, 'packed' RGB
     // values passed in or out are always 0xRRGGBB order.
-    if(rgb_order == WS2801_RGB) {
-      *p++ = c >> 16; // Red
-      *p++ = c >>  8; // Green
-    } else {
-      *p++ = c >>  8; // Green
-      *p++ = c >> 16; // Red
-    }
-    *p++ = c;         // Blue
+    if(rgb_order == WS2801_RGB) changed = storePixel(p, c >> 16, c >> 8, c);
+    else                        changed = storePixel(p, c >> 8, c >> 16, c);
+    if(changed && n >= dirtyEnd) dirtyEnd = n + 1;
   }
 }
 
 // Set the colours of the pixels using grid coordinates
 void Adafruit_WS2801::spc(uint8_t i, uint8_t j, uint32_t c) {
-   if (0 <= i && i < h() && 0 <= j && j < w()) {
-		if (i % 2 == 0) {
-			setPixelColor(w()*i + j, c);        
-		}
-		else {
-			setPixelColor(w()*i + ((w() - 1) - j), c);
-		}
-   }
+  if (i < wallHeight && j < wallWidth) {
+    setPixelColor(strandIndex(i, j), c);
+  }
+}
+
+// Fill columns j1..j2 (inclusive, either order) of row i with colour c:
+void Adafruit_WS2801::fillRow(int16_t i, int16_t j1, int16_t j2, uint32_t c) {
+  uint8_t  r = c >> 16, g = c >> 8, b = c;
+  uint16_t n;
+
+  if(j1 > j2) { int16_t t = j1; j1 = j2; j2 = t; }
+  if(i < 0 || i >= wallHeight || j2 < 0 || j1 >= wallWidth || pixels == NULL) return;
+  if(j1 < 0)           j1 = 0;
+  if(j2 >= wallWidth)  j2 = wallWidth - 1;
+  if(rgb_order != WS2801_RGB) { uint8_t t = r; r = g; g = t; }
+
+  for(; j1 <= j2; j1++) {
+    if((n = strandIndex(i, j1)) < numLEDs) {
+      if(storePixel(&pixels[n * 3], r, g, b) && n >= dirtyEnd) dirtyEnd = n + 1;
+    }
+  }
+}
+
+// Fill the rectangle with corners (i1,j1) and (i2,j2) with colour c:
+void Adafruit_WS2801::fillRect(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c) {
+  if(i1 > i2) { int16_t t = i1; i1 = i2; i2 = t; }
+  if(i1 < 0)            i1 = 0;
+  if(i2 >= wallHeight)  i2 = wallHeight - 1;
+  for(; i1 <= i2; i1++) fillRow(i1, j1, j2, c);
+}
+
+// Set every pixel of row i from w() packed colours:
+void Adafruit_WS2801::setRow(uint8_t i, const uint32_t *c) {
+  blit(c, i, 0, wallWidth, 1);
+}
+
+// Copy a bw x bh block of packed colours (row-major) onto the wall with
+// its upper left corner at (i,j).  Parts off the wall are clipped.
+void Adafruit_WS2801::blit(const uint32_t *c, int16_t i, int16_t j, uint8_t bw, uint8_t bh) {
+  int16_t  y, x, x0 = (j < 0) ? -j : 0, x1 = bw;
+  const uint32_t *src;
+  uint32_t v;
+  uint16_t n;
+  bool     changed;
+
+  if(pixels == NULL) return;
+  if(j + x1 > wallWidth) x1 = wallWidth - j;
+  for(y = (i < 0) ? -i : 0; y < bh && i + y < wallHeight; y++) {
+    src = &c[y * bw];
+    for(x = x0; x < x1; x++) {
+      if((n = strandIndex(i + y, j + x)) < numLEDs) {
+        v       = src[x];
+        changed = (rgb_order == WS2801_RGB) ? storePixel(&pixels[n * 3], v >> 16, v >> 8, v)
+                                            : storePixel(&pixels[n * 3], v >> 8, v >> 16, v);
+        if(changed && n >= dirtyEnd) dirtyEnd = n + 1;
+      }
+    }
+  }
+}
+
+// Copy a bw x bh block of the wall, upper left corner at (i,j), out to
+// packed colours (row-major).  Entries for positions off the wall are 0.
+void Adafruit_WS2801::grab(uint32_t *c, int16_t i, int16_t j, uint8_t bw, uint8_t bh) {
+  int16_t  y, x;
+  uint16_t n;
+  uint8_t  ro = (rgb_order == WS2801_RGB) ? 0 : 1, go = 1 - ro;
+  const uint8_t *p;
+
+  for(y = 0; y < bh; y++) {
+    for(x = 0; x < bw; x++) {
+      n = numLEDs;
+      if(i + y >= 0 && i + y < wallHeight && j + x >= 0 && j + x < wallWidth && pixels != NULL) {
+        n = strandIndex(i + y, j + x);
+      }
+      if(n < numLEDs) {
+        p = &pixels[n * 3];
+        *c++ = ((uint32_t)p[ro] << 16) | ((uint16_t)p[go] << 8) | p[2];
+      } else {
+        *c++ = 0;
+      }
+    }
+  }
+}
+
+// Set the whole wall from a row-major buffer of w() * h() R,G,B triplets:
+void Adafruit_WS2801::blitRGB(const uint8_t *rgb) {
+  uint16_t n;
+  uint8_t  i, j, ro = (rgb_order == WS2801_RGB) ? 0 : 1;
+
+  if(pixels == NULL) return;
+  for(i = 0; i < wallHeight; i++) {
+    for(j = 0; j < wallWidth; j++, rgb += 3) {
+      if((n = strandIndex(i, j)) < numLEDs) {
+        bool changed = (ro == 0) ? storePixel(&pixels[n * 3], rgb[0], rgb[1], rgb[2])
+                                 : storePixel(&pixels[n * 3], rgb[1], rgb[0], rgb[2]);
+        if(changed && n >= dirtyEnd) dirtyEnd = n + 1;
+      }
+    }
+  }
 }
 
 // Query color from previously-set pixel (returns packed 32-bit RGB value)
-uint32_t Adafruit_WS2801::getPixelColor(uint16_t n) {
-  if(n < numLEDs) {
-    uint16_t ofs = n * 3;
+uint32_t Adafruit_WS2801::getPixelColor(uint32_t n) {
+  if(n < numLEDs && pixels != NULL) {
+    uint32_t ofs = n * 3;
     // To keep the show() loop as simple & fast as possible, the
     // internal color representation is native to different pixel
     // types.  For compatibility with existing code, 'packed' RGB
@@ -220,13 +457,10 @@ uint32_t Adafruit_WS2801::getPixelColor(uint16_t n) {
 
 // Query colour from previously-set pixel using grid coordinates (returns packed 32-bit RGB value)
 uint32_t Adafruit_WS2801::gpc(uint8_t i, uint8_t j) {
-
-	if (i % 2 == 0) {
-		return getPixelColor(w() * i + j);
-	}
-	else {
-		return getPixelColor(w() * i + ((w() - 1) - j));
-	}
+  if (i < wallHeight && j < wallWidth) {
+    return getPixelColor(strandIndex(i, j));
+  }
+  return 0; // Off the wall
 }
 
 // Create a 24 bit color value from R,G,B
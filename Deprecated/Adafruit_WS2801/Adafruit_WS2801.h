@@ -7,6 +7,8 @@
  #include <WProgram.h>
  #include <pins_arduino.h>
 #endif
+#include "WS2801Output.h"
+#include "WS2801SerpentineMap.h"
 
 // Not all LED pixels are RGB order; 36mm type expects GRB data.
 // Optional flag to constructors indicates data order (default if
@@ -16,14 +18,22 @@
 #define WS2801_RGB 0
 #define WS2801_GRB 1
 
+// Streaming mode: no pixel buffer is kept, and show() asks a generator
+// for the colours as it clocks them out, so the strand can be far longer
+// than the board has RAM for.  A pixel generator returns the packed
+// colour of strand pixel n; a row generator fills in w() packed colours,
+// left to right, for grid row i.  arg is whatever was given with it.
+typedef uint32_t (*WS2801PixelGenerator)(uint32_t n, void *arg);
+typedef void     (*WS2801RowGenerator)(uint8_t i, uint32_t *colours, void *arg);
+
 class Adafruit_WS2801 {
 
  public:
 
   // Use SPI hardware; specific pins only:
-  Adafruit_WS2801(uint16_t n, uint8_t order=WS2801_RGB);
+  Adafruit_WS2801(uint32_t n, uint8_t order=WS2801_RGB);
   // Includes width/height of wall, and Configurable pins
-  Adafruit_WS2801(uint16_t n, uint8_t dpin, uint8_t cpin, uint8_t order=WS2801_RGB, uint8_t w = 18, uint8_t h = 11);  
+  Adafruit_WS2801(uint32_t n, uint8_t dpin, uint8_t cpin, uint8_t order=WS2801_RGB, uint8_t w = 18, uint8_t h = 11);  
   // Empty constructor; init pins/strand length/data order later:
   Adafruit_WS2801();
   // Release memory (as needed):
@@ -31,44 +41,84 @@ class Adafruit_WS2801 {
 
   void
     begin(void),
-    show(void),
-    setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
-    setPixelColor(uint16_t n, uint32_t c),
+    show(void), // Send out pixels changed since the last show(), if any
+    invalidate(void), // Make the next show() resend the whole strand
+    setPixelColor(uint32_t n, uint8_t r, uint8_t g, uint8_t b),
+    setPixelColor(uint32_t n, uint32_t c),
     updatePins(uint8_t dpin, uint8_t cpin), // Change pins, configurable
     updatePins(void), // Change pins, hardware SPI
-    updateLength(uint16_t n), // Change strand length
+    updateLength(uint32_t n), // Change strand length
     updateOrder(uint8_t order), // Change data order
-    spc(uint8_t i, uint8_t j, uint32_t c); // set pixel colour using grid coordinates
+    setOutput(WS2801Output *o), // Send data to another output (not owned)
+    setIndexMap(const uint16_t *map), // Use a fixed grid-to-strand table in PROGMEM (not owned)
+    setGenerator(WS2801PixelGenerator g, void *arg = NULL), // Stream from g (NULL: buffer again)
+    setRowGenerator(WS2801RowGenerator g, void *arg = NULL), // Stream rows from g (NULL: buffer again)
+    spc(uint8_t i, uint8_t j, uint32_t c), // set pixel colour using grid coordinates
+    // Bulk operations, in grid coordinates; anything off the wall is clipped:
+    fillRow(int16_t i, int16_t j1, int16_t j2, uint32_t c), // columns j1..j2 of row i
+    fillRect(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c), // corners (i1,j1), (i2,j2)
+    setRow(uint8_t i, const uint32_t *c), // whole row i from w() packed colours
+    blit(const uint32_t *c, int16_t i, int16_t j, uint8_t bw, uint8_t bh), // bw x bh colours, row-major, upper left at (i,j)
+    grab(uint32_t *c, int16_t i, int16_t j, uint8_t bw, uint8_t bh), // reverse of blit()
+    blitRGB(const uint8_t *rgb); // whole wall from a row-major R,G,B buffer
   uint8_t
     w(void),
     h(void);
-  uint16_t
+  uint32_t
     numPixels(void);
+  WS2801Output
+    *getOutput(void);
+  boolean
+    streaming(void); // True while show() takes colours from a generator
   uint32_t
-    getPixelColor(uint16_t n),
+    getPixelColor(uint32_t n),
     gpc(uint8_t i, uint8_t j),
     color(byte r, byte g, byte b);
     
 
  private:
 
-  uint16_t
-    numLEDs;
+  uint32_t
+    numLEDs,
+    dirtyEnd,  // One past the highest pixel changed since the last show()
+    *rowColours; // One row from rowGenerator
   uint8_t
-    *pixels,   // Holds color values for each LED (3 bytes each)
+    *pixels,   // Holds color values for each LED (3 bytes each); NULL while streaming
     rgb_order, // Color order; RGB vs GRB (or others, if needed in future)
-    clkpin    , datapin,     // Clock & data pin numbers
-    clkpinmask, datapinmask, // Clock & data PORT bitmasks
     wallWidth, wallHeight; // wall width/height
-  volatile uint8_t
-    *clkport  , *dataport;   // Clock & data PORT registers
-  
+  WS2801Output
+    *output;   // Where show() sends the pixel data
+  const uint16_t
+    *indexMap; // Strand index of each grid position, row-major (see strandIndex())
+  WS2801PixelGenerator
+    pixelGenerator;
+  WS2801RowGenerator
+    rowGenerator;
+  void
+    *generatorArg;
+
   void
-    alloc(uint16_t n),
-    startSPI(void);
+    alloc(uint32_t n),
+    buildIndexMap(void),
+    stream(WS2801PixelGenerator p, WS2801RowGenerator r, void *arg),
+    showStreamed(void),
+    attachOutput(WS2801Output *o, boolean owned);
+  uint16_t
+    strandIndex(uint8_t i, uint8_t j);
   boolean
-    hardwareSPI, // If 'true', using hardware SPI
-    begun;       // If 'true', begin() method was previously invoked
+    ownOutput, // If 'true', output was allocated here and is deleted here
+    ownMap,    // If 'true', indexMap was allocated here and is freed here
+    begun;     // If 'true', begin() method was previously invoked
 };
 
+// Strand index of grid position (i, j), which must be on the wall: from
+// the table, or with none (always, on AVRs, unless one is set with
+// setIndexMap(); elsewhere if there was no memory for it) worked out
+// for the serpentine wiring.
+inline uint16_t Adafruit_WS2801::strandIndex(uint8_t i, uint8_t j) {
+  uint16_t base = (uint16_t)i * wallWidth;
+  if(indexMap != NULL) return pgm_read_word(&indexMap[base + j]);
+  return (i & 1) ? base + wallWidth - 1 - j : base + j;
+}
+
 #endif
\ No newline at end of file
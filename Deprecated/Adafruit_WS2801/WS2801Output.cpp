@@ -0,0 +1,188 @@
+#ifndef LEDWALL_HOST
+ #include "SPI.h"
+#else
+ #include <fcntl.h>
+ #include <termios.h>
+ #include <unistd.h>
+#endif
+#include "WS2801Output.h"
+
+/*****************************************************************************/
+
+#ifndef LEDWALL_HOST
+
+// Enable SPI hardware and set up protocol details:
+void WS2801HardwareSPI::begin(void) {
+  SPI.begin();
+  SPI.setBitOrder(MSBFIRST);
+  SPI.setDataMode(SPI_MODE0);
+  SPI.setClockDivider(SPI_CLOCK_DIV16); // 1 MHz max, else flicker
+}
+
+void WS2801HardwareSPI::end(void) {
+  SPI.end();
+}
+
+void WS2801HardwareSPI::write(const uint8_t *data, uint32_t len) {
+  const uint8_t *end = data + len;
+
+  while(data < end) {
+    SPDR = *data++;
+    while(!(SPSR & (1<<SPIF)));
+  }
+}
+
+/*****************************************************************************/
+
+WS2801BitBang::WS2801BitBang(uint8_t dpin, uint8_t cpin) {
+  datapin     = dpin;
+  clkpin      = cpin;
+  clkport     = portOutputRegister(digitalPinToPort(cpin));
+  clkpinmask  = digitalPinToBitMask(cpin);
+  dataport    = portOutputRegister(digitalPinToPort(dpin));
+  datapinmask = digitalPinToBitMask(dpin);
+}
+
+// Note: any prior clock/data pin directions are left as-is and are
+// NOT restored as inputs when switching away from this output!
+void WS2801BitBang::begin(void) {
+  pinMode(datapin, OUTPUT);
+  pinMode(clkpin , OUTPUT);
+}
+
+void WS2801BitBang::write(const uint8_t *data, uint32_t len) {
+  const uint8_t *end = data + len;
+  uint8_t        bit;
+
+  for(; data < end; data++) {
+    for(bit=0x80; bit; bit >>= 1) {
+      if(*data & bit) *dataport |=  datapinmask;
+      else              *dataport &= ~datapinmask;
+      *clkport |=  clkpinmask;
+      *clkport &= ~clkpinmask;
+    }
+  }
+}
+
+#endif // LEDWALL_HOST
+
+/*****************************************************************************/
+
+WS2801Capture::WS2801Capture(void) {
+  data     = NULL;
+  len      = capacity = pos = 0;
+  frames   = bytes    = 0;
+}
+
+WS2801Capture::~WS2801Capture(void) {
+  if(data != NULL) free(data);
+}
+
+// Like the pixels themselves, bytes past the end of a short frame keep
+// their previous value.  Each write() carries on where the last one in
+// the frame left off -- even if there's no memory to keep all of this
+// one, in which case only the part that fits is kept, so later writes
+// still land where they belong.
+void WS2801Capture::write(const uint8_t *d, uint32_t n) {
+  uint32_t keep = n;
+
+  if(pos + n > capacity) {
+    uint8_t *p = (uint8_t *)realloc(data, pos + n);
+    if(p != NULL) {
+      data     = p;
+      capacity = pos + n;
+    } else {
+      keep = (pos < capacity) ? capacity - pos : 0;
+    }
+  }
+  if(keep > 0) memcpy(data + pos, d, keep);
+  if(pos + keep > len) len = pos + keep;
+  pos   += n;
+  bytes += n;
+}
+
+// No delay: captured frames are 'latched' instantly.
+void WS2801Capture::latch(void) {
+  frames++;
+  pos = 0;
+}
+
+const uint8_t *WS2801Capture::frame(void) {
+  return data;
+}
+
+uint32_t WS2801Capture::length(void) {
+  return len;
+}
+
+uint32_t WS2801Capture::frameCount(void) {
+  return frames;
+}
+
+uint32_t WS2801Capture::byteCount(void) {
+  return bytes;
+}
+
+/*****************************************************************************/
+
+#ifdef LEDWALL_HOST
+
+WS2801FileOutput::WS2801FileOutput(const char *path, boolean adaHeader) {
+  header   = adaHeader;
+  skipping = false;
+  fd       = open(path, O_WRONLY | O_CREAT | O_NOCTTY | O_APPEND, 0644);
+  if((fd >= 0) && isatty(fd)) {
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      cfsetispeed(&tio, B115200);
+      cfsetospeed(&tio, B115200);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+}
+
+WS2801FileOutput::~WS2801FileOutput(void) {
+  if(fd >= 0) close(fd);
+}
+
+boolean WS2801FileOutput::isOpen(void) {
+  return fd >= 0;
+}
+
+// Write everything, retrying short writes (pipes and ttys may take less
+// than was asked for).
+static void writeAll(int fd, const uint8_t *data, size_t len) {
+  while(len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if(n <= 0) return;
+    data += n;
+    len  -= n;
+  }
+}
+
+// Same header the Processing sketches send: magic word, LED count minus
+// one (high byte first), then a checksum of the two.  The count is 16
+// bits, so a frame of more than 65536 LEDs (or less than one) can't be
+// described; rather than send a header that's wrong and desynchronise
+// the receiver, the whole frame is dropped.
+void WS2801FileOutput::start(uint32_t len) {
+  skipping = header && ((len < 3) || (len > 65536UL * 3));
+  if((fd < 0) || !header || skipping) return;
+  uint16_t n = len / 3 - 1;
+  uint8_t  h[6] = { 'A', 'd', 'a', (uint8_t)(n >> 8), (uint8_t)n, 0 };
+  h[5] = h[3] ^ h[4] ^ 0x55;
+  writeAll(fd, h, sizeof(h));
+}
+
+void WS2801FileOutput::write(const uint8_t *data, uint32_t len) {
+  if((fd < 0) || skipping) return;
+  writeAll(fd, data, len);
+}
+
+// The receiving end (LEDstream, or a simulator) is responsible for the
+// latch; nothing to wait for here.
+void WS2801FileOutput::latch(void) {
+}
+
+#endif // LEDWALL_HOST
@@ -0,0 +1,136 @@
+#ifndef __WS2801_OUTPUT_INCLUDED__
+#define __WS2801_OUTPUT_INCLUDED__
+
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Destination for the byte stream produced by Adafruit_WS2801::show().
+// show() says how long the frame is with start(), hands it to write() --
+// the whole pixel buffer at once, or in pieces when streaming from a
+// generator -- and then calls latch() to end the frame.  Hardware SPI
+// and bit-bang outputs drive real pixels; the capture and file outputs
+// let the drawing code run on a host computer, where it can be profiled
+// and checked without a board.
+class WS2801Output {
+
+ public:
+
+  virtual ~WS2801Output() {}
+
+  // Set up pins/ports (called from Adafruit_WS2801::begin()):
+  virtual void begin(void) {}
+  // Release pins/ports before the strip switches to another output:
+  virtual void end(void) {}
+  // A frame of len bytes follows, in one or more write() calls:
+  virtual void start(uint32_t len) { (void)len; }
+  // Clock out the next len bytes of pixel data:
+  virtual void write(const uint8_t *data, uint32_t len) = 0;
+  // Finish the frame; WS2801 latches when the clock is held low for 1 ms:
+  virtual void latch(void) { delay(1); }
+};
+
+#ifndef LEDWALL_HOST
+
+// Hardware SPI; data and clock on the board's fixed SPI pins.
+class WS2801HardwareSPI : public WS2801Output {
+
+ public:
+
+  void
+    begin(void),
+    end(void),
+    write(const uint8_t *data, uint32_t len);
+};
+
+// Bit-banged output on arbitrary clock/data pins.
+class WS2801BitBang : public WS2801Output {
+
+ public:
+
+  WS2801BitBang(uint8_t dpin, uint8_t cpin);
+
+  void
+    begin(void),
+    write(const uint8_t *data, uint32_t len);
+
+ private:
+
+  uint8_t
+    clkpin    , datapin,     // Clock & data pin numbers
+    clkpinmask, datapinmask; // Clock & data PORT bitmasks
+  volatile uint8_t
+    *clkport  , *dataport;   // Clock & data PORT registers
+};
+
+#endif // LEDWALL_HOST
+
+// Keeps a copy of the most recent frame in memory instead of driving
+// pixels.  Used for regression checks and benchmarks; the latch is
+// instantaneous so timings measure the drawing code alone.
+class WS2801Capture : public WS2801Output {
+
+ public:
+
+  WS2801Capture(void);
+  ~WS2801Capture(void);
+
+  void
+    write(const uint8_t *data, uint32_t len),
+    latch(void);
+  const uint8_t
+    *frame(void);      // Bytes as latched by the pixels (NULL if none yet)
+  uint32_t
+    length(void);      // Length of frame(), the longest frame written
+  uint32_t
+    frameCount(void),  // Number of latched frames
+    byteCount(void);   // Total bytes written
+
+ private:
+
+  uint8_t
+    *data;
+  uint32_t
+    len,
+    capacity,
+    pos;               // Where the next write() goes in this frame
+  uint32_t
+    frames,
+    bytes;
+};
+
+#ifdef LEDWALL_HOST
+
+// Writes the byte stream to a file, FIFO or (pseudo-)terminal.  With
+// adaHeader set, each frame is prefixed with the 'Ada' header that
+// LEDstream expects, so a serial device path drives a real wall and a
+// pty can feed a simulator.  Terminals are switched to raw 115200 baud.
+class WS2801FileOutput : public WS2801Output {
+
+ public:
+
+  WS2801FileOutput(const char *path, boolean adaHeader = false);
+  ~WS2801FileOutput(void);
+
+  void
+    start(uint32_t len),
+    write(const uint8_t *data, uint32_t len),
+    latch(void);
+  boolean
+    isOpen(void);
+
+ private:
+
+  int
+    fd;
+  boolean
+    header,
+    skipping;          // Frame too long for the header; not sent
+};
+
+#endif // LEDWALL_HOST
+
+#endif
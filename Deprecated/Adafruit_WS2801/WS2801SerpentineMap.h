@@ -0,0 +1,50 @@
+#ifndef __WS2801_SERPENTINE_MAP_INCLUDED__
+#define __WS2801_SERPENTINE_MAP_INCLUDED__
+
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Strand index of the k'th grid position (row-major) on a wall w pixels
+// wide, wired as a serpentine: even rows run left to right, odd rows
+// right to left.
+constexpr uint16_t ws2801Serpentine(uint8_t w, uint16_t k) {
+  return ((k / w) % 2 == 0) ? k : (k / w) * w + (w - 1) - (k % w);
+}
+
+// Grid-to-strand table for a wall whose size is known at compile time.
+// The table is built by the compiler instead of being malloc'd and filled
+// in at run time, and kept in flash (PROGMEM) so it costs no RAM:
+//
+//   strip.setIndexMap(WS2801SerpentineMap<18, 11>::table);
+//
+// (Built with template recursion, so W * H must stay under the compiler's
+// instantiation depth limit -- 900 by default, or raise -ftemplate-depth.)
+
+template<uint16_t... I> struct WS2801IndexList {};
+
+template<uint16_t N, uint16_t... I>
+struct WS2801IndexRange : WS2801IndexRange<N - 1, N - 1, I...> {};
+
+template<uint16_t... I>
+struct WS2801IndexRange<0, I...> {
+  typedef WS2801IndexList<I...> type;
+};
+
+template<uint8_t W, uint8_t H,
+         class L = typename WS2801IndexRange<(uint16_t)W * H>::type>
+struct WS2801SerpentineMap;
+
+template<uint8_t W, uint8_t H, uint16_t... I>
+struct WS2801SerpentineMap<W, H, WS2801IndexList<I...> > {
+  static const uint16_t table[(uint16_t)W * H];
+};
+
+template<uint8_t W, uint8_t H, uint16_t... I>
+const uint16_t WS2801SerpentineMap<W, H, WS2801IndexList<I...> >::table[(uint16_t)W * H] PROGMEM =
+  { ws2801Serpentine(W, I)... };
+
+#endif
@@ -4,40 +4,17 @@
 #include <string.h>
 
 // Constructor for alphanumeric
-Alphanumeric::Alphanumeric(Adafruit_WS2801* board, char* l, uint8_t yOff, uint8_t xOff, uint32_t c) : Drawable(board, yOff, xOff, getBBWidth(l), getBBHeight(l)) {
-	int w = getBBWidth(l);
-	int h = getBBHeight(l);
-	
-	// Here we define all of the different letters
-	// Every case is defined by the ASCII code for the letter/number (but capitals only)
-	switch(toupper(l[0])) {
-		case 'A':
-			Drawable(board, yOff, xOff, w, h);
-			spc(0, 1, c);
-			spc(1, 0, c);		//  #
-			spc(1, 2, c);		// # #
-			spc(2, 0, c);		// ###
-			spc(2, 1, c);		// # #
-			spc(2, 2, c);		// # #
-			spc(3, 0, c);
-			spc(3, 2, c);
-			spc(4, 0, c);
-			spc(4, 2, c); 
-			break;
-		case 'B':
-			Drawable(board, yOff, xOff, w, h);
-			spc(0, 0, c);
-			spc(0, 1, c);
-			spc(1, 0, c);		// ##
-			spc(1, 2, c);		// # #
-			spc(2, 0, c);		// ##
-			spc(2, 1, c);		// # #
-			spc(3, 0, c);		// ##
-			spc(3, 2, c);
-			spc(4, 0, c);
-			spc(4, 1, c);
-			break;
-		// TODO FOR STEVEN: REST OF ALPHABET AND NUMBERS
+// The glyph comes from the font table; every set pixel in it gets colour c.
+Alphanumeric::Alphanumeric(Adafruit_WS2801* board, const char* l, int16_t yOff, int16_t xOff, uint32_t c) : Drawable(board, yOff, xOff, getBBWidth(l), getBBHeight(l)) {
+	uint8_t i, j, column;
+
+	setColour(c);
+	for (j = 0; j < w(); j++) {
+		column = font3x5Column(l[0], j);
+		for (i = 0; i < h(); i++) {
+			if (column & (1 << i))
+				setPaletteIndex(i, j, 1);
+		}
 	}
 }
 
@@ -47,33 +24,72 @@ Alphanumeric::~Alphanumeric(void) {
 
 }
 
-int Alphanumeric::getBBWidth(char* l) {
-	switch((int) l[0]) {
-		case 73:
-			return 1;
-		default:
-			return 3;
+int Alphanumeric::getBBWidth(const char* l) {
+	return font3x5Width(l[0]);
+}
+
+int Alphanumeric::getBBHeight(const char* l) {
+	return FONT3X5_HEIGHT;
+}
+
+uint8_t Alphanumeric::drawChar(Adafruit_WS2801* board, char ch, int16_t yOff, int16_t xOff, uint32_t c) {
+	uint8_t i, j, column, width = font3x5Width(ch);
+	int16_t x;
+
+	for (j = 0; j < width; j++) {
+		x = xOff + j;
+		if (x < 0 || x >= (*board).w()) continue;
+		column = font3x5Column(ch, j);
+		for (i = 0; column; i++, column >>= 1) {
+			if ((column & 1) && yOff + i >= 0)
+				(*board).spc(yOff + i, x, c); // spc() clips rows past the bottom
+		}
 	}
+	return width + FONT3X5_SPACING;
 }
 
-int Alphanumeric::getBBHeight(char* l) {
-	return 5;
+int16_t Alphanumeric::drawString(Adafruit_WS2801* board, const char* text, int16_t yOff, int16_t xOff, uint32_t c) {
+	for (; *text && xOff < (*board).w(); text++) {
+		if (xOff + FONT3X5_STRIDE < 0)
+			xOff += font3x5Width(*text) + FONT3X5_SPACING; // Entirely off the left edge
+		else
+			xOff += drawChar(board, *text, yOff, xOff, c);
+	}
+	return xOff + textWidth(text); // Count anything past the right edge too
 }
 
-Drawable** Alphanumeric::alphanumericString(Adafruit_WS2801* board, char* text, uint8_t yOff, uint8_t xOff, uint32_t c) {
-	int i;
+uint16_t Alphanumeric::textWidth(const char* text) {
+	uint16_t width = 0;
+	for (; *text; text++) {
+		width += font3x5Width(*text) + FONT3X5_SPACING;
+	}
+	return width;
+}
+
+uint16_t Alphanumeric::renderColumns(const char* text, uint8_t* columns, uint16_t maxColumns) {
+	uint16_t n = 0;
+	uint8_t j, width;
+
+	for (; *text; text++) {
+		width = font3x5Width(*text);
+		for (j = 0; j < width + FONT3X5_SPACING; j++, n++) {
+			if (n < maxColumns) columns[n] = font3x5Column(*text, j);
+		}
+	}
+	return n;
+}
+
+Drawable** Alphanumeric::alphanumericString(Adafruit_WS2801* board, const char* text, int16_t yOff, int16_t xOff, uint32_t c) {
+	int i, len = strlen(text);
 	int offset = 0;
 	Drawable** textList;
-	textList = (Drawable**) malloc(strlen(text));
+	textList = (Drawable**) malloc(len * sizeof(Drawable*));
+	if (textList == NULL) return NULL;
 	
-	for(i = 0; i < strlen(text); i++) {
-		// TODO: TEST HOW FUNCTION HANDLES TEXT WITH SPACES
-		if ((int) text[i] == 32)
-			offset += 3;
-		else {
-			textList[i] = new Alphanumeric(board, &text[i], yOff, xOff + offset, c);
-			offset += 1 + getBBWidth(&text[i]);
-		}
+	for(i = 0; i < len; i++) {
+		// Spaces are (blank) glyphs too, so every entry is valid
+		textList[i] = new Alphanumeric(board, &text[i], yOff, xOff + offset, c);
+		offset += FONT3X5_SPACING + getBBWidth(&text[i]);
 	}
 	
 	return textList;
@@ -3,7 +3,7 @@
 
 #include "../Adafruit_WS2801/Adafruit_WS2801.h"
 #include "../Drawable/Drawable.h"
-#include <list>
+#include "Font3x5.h"
 #if (ARDUINO >= 100)
  #include <Arduino.h>
 #else
@@ -11,22 +11,39 @@
  #include <pins_arduino.h>
 #endif
 
+// A single character as a Drawable, built from the 3x5 font (see Font3x5.h).
+// To just put text on the wall, use the static drawChar/drawString functions instead: they draw straight from
+// the font table to the strip and allocate nothing. Marquee scrolls text the same way.
 class Alphanumeric : public Drawable {
 
 	public:
 	
 		// Creates a letter l from colour c, at position y, x
-		Alphanumeric(Adafruit_WS2801* board, char* l, uint8_t yOff, uint8_t xOff, uint32_t c);
+		Alphanumeric(Adafruit_WS2801* board, const char* l, int16_t yOff, int16_t xOff, uint32_t c);
 		// Release memory as needed
 		~Alphanumeric();
 		
 		static int
-			getBBWidth(char* l),	// Returns width of bounding box for given char
-			getBBHeight(char* l);	// Returns height of bounding box for given char
+			getBBWidth(const char* l),	// Returns width of bounding box for given char
+			getBBHeight(const char* l);	// Returns height of bounding box for given char
+		static uint8_t
+			// Draw character ch with its upper left corner at (yOff, xOff), in colour c; clipped to the wall.
+			// Only the character's set pixels are drawn. Returns how far to move right for the next character.
+			drawChar(Adafruit_WS2801* board, char ch, int16_t yOff, int16_t xOff, uint32_t c);
+		static int16_t
+			// Draw text with its upper left corner at (yOff, xOff), in colour c; clipped to the wall.
+			// Returns the x-coordinate just past the end of the text.
+			drawString(Adafruit_WS2801* board, const char* text, int16_t yOff, int16_t xOff, uint32_t c);
+		static uint16_t
+			// Width of text in columns, including the spacing after each character
+			textWidth(const char* text),
+			// Render text into one byte per column (bit r = row r), for scrolling or other effects.
+			// Writes at most maxColumns bytes; returns the number of columns the whole text needs.
+			renderColumns(const char* text, uint8_t* columns, uint16_t maxColumns);
 			
 		static Drawable**
-			alphanumericString(Adafruit_WS2801* board, char* text, uint8_t yOff, uint8_t xOff, uint32_t c); //Takes in a string and returns an array of alphanumerics of each letter. yOff and xOff refer to the first letter.
+			alphanumericString(Adafruit_WS2801* board, const char* text, int16_t yOff, int16_t xOff, uint32_t c); //Takes in a string and returns an array of alphanumerics of each letter (strlen(text) entries, spaces included). yOff and xOff refer to the first letter.
 
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,75 @@
+#include "Font3x5.h"
+
+// Glyphs for ' ' .. '~', skipping 'a' .. 'z' (see font3x5Offset()).
+// Columns left to right, top row in bit 0; width in bits 5-6 of the first.
+const uint8_t font3x5[] PROGMEM = {
+	0x40, 0x00, 0x00, // ' '
+	0x37, 0x00, 0x00, // '!'
+	0x63, 0x00, 0x03, // '"'
+	0x7f, 0x0a, 0x1f, // '#'
+	0x72, 0x1f, 0x09, // '$'
+	0x79, 0x04, 0x13, // '%'
+	0x6a, 0x15, 0x1a, // '&'
+	0x23, 0x00, 0x00, // '\''
+	0x4e, 0x11, 0x00, // '('
+	0x51, 0x0e, 0x00, // ')'
+	0x65, 0x02, 0x05, // '*'
+	0x64, 0x0e, 0x04, // '+'
+	0x50, 0x08, 0x00, // ','
+	0x64, 0x04, 0x04, // '-'
+	0x30, 0x00, 0x00, // '.'
+	0x78, 0x04, 0x03, // '/'
+	0x7f, 0x11, 0x1f, // '0'
+	0x72, 0x1f, 0x10, // '1'
+	0x79, 0x15, 0x12, // '2'
+	0x71, 0x15, 0x0a, // '3'
+	0x67, 0x04, 0x1f, // '4'
+	0x77, 0x15, 0x09, // '5'
+	0x7e, 0x15, 0x1d, // '6'
+	0x61, 0x1d, 0x03, // '7'
+	0x7f, 0x15, 0x1f, // '8'
+	0x77, 0x15, 0x0f, // '9'
+	0x2a, 0x00, 0x00, // ':'
+	0x50, 0x0a, 0x00, // ';'
+	0x64, 0x0a, 0x11, // '<'
+	0x6a, 0x0a, 0x0a, // '='
+	0x71, 0x0a, 0x04, // '>'
+	0x61, 0x15, 0x02, // '?'
+	0x6f, 0x11, 0x17, // '@'
+	0x7e, 0x05, 0x1e, // 'A'
+	0x7f, 0x15, 0x0a, // 'B'
+	0x6e, 0x11, 0x11, // 'C'
+	0x7f, 0x11, 0x0e, // 'D'
+	0x7f, 0x15, 0x11, // 'E'
+	0x7f, 0x05, 0x01, // 'F'
+	0x6e, 0x11, 0x1d, // 'G'
+	0x7f, 0x04, 0x1f, // 'H'
+	0x3f, 0x00, 0x00, // 'I'
+	0x68, 0x10, 0x0f, // 'J'
+	0x7f, 0x04, 0x1b, // 'K'
+	0x7f, 0x10, 0x10, // 'L'
+	0x7f, 0x06, 0x1f, // 'M'
+	0x7f, 0x01, 0x1e, // 'N'
+	0x6e, 0x11, 0x0e, // 'O'
+	0x7f, 0x05, 0x02, // 'P'
+	0x6e, 0x19, 0x16, // 'Q'
+	0x7f, 0x05, 0x1a, // 'R'
+	0x72, 0x15, 0x09, // 'S'
+	0x61, 0x1f, 0x01, // 'T'
+	0x7f, 0x10, 0x1f, // 'U'
+	0x6f, 0x10, 0x0f, // 'V'
+	0x7f, 0x0c, 0x1f, // 'W'
+	0x7b, 0x04, 0x1b, // 'X'
+	0x63, 0x1c, 0x03, // 'Y'
+	0x79, 0x15, 0x13, // 'Z'
+	0x5f, 0x11, 0x00, // '['
+	0x63, 0x04, 0x18, // '\\'
+	0x51, 0x1f, 0x00, // ']'
+	0x62, 0x01, 0x02, // '^'
+	0x70, 0x10, 0x10, // '_'
+	0x41, 0x02, 0x00, // '`'
+	0x64, 0x1f, 0x11, // '{'
+	0x3f, 0x00, 0x00, // '|'
+	0x71, 0x1f, 0x04, // '}'
+	0x64, 0x06, 0x02, // '~'
+};
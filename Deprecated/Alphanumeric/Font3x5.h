@@ -0,0 +1,41 @@
+#ifndef __FONT3X5_H_INCLUDED__
+#define __FONT3X5_H_INCLUDED__
+
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// 3x5 pixel font covering printable ASCII, kept in flash (PROGMEM) so it costs no RAM.
+// Each glyph is FONT3X5_STRIDE bytes, one per column from left to right; bit r of a column is row r, with the
+// top row in bit 0. Bits 5-6 of the first byte hold the glyph's width in columns (1 to 3).
+// Lowercase letters have no glyphs of their own and are drawn as capitals.
+
+#define FONT3X5_HEIGHT  5
+#define FONT3X5_STRIDE  3
+#define FONT3X5_SPACING 1 // Blank columns between glyphs
+
+extern const uint8_t font3x5[] PROGMEM;
+
+// Offset of the glyph for c in font3x5; characters outside ' ' .. '~' get '?'
+constexpr uint16_t font3x5Offset(char c) {
+	return FONT3X5_STRIDE * (
+		(c < ' ' || c > '~') ? ('?' - ' ') :
+		(c < 'a')            ? (c - ' ') :
+		(c <= 'z')           ? (c - 'a' + 'A' - ' ') :
+		                       (c - ' ' - 26));
+}
+
+// Width of c's glyph in columns
+inline uint8_t font3x5Width(char c) {
+	return pgm_read_byte(&font3x5[font3x5Offset(c)]) >> 5;
+}
+
+// Column col of c's glyph, as a bitmask of rows (0 past the glyph's width)
+inline uint8_t font3x5Column(char c, uint8_t col) {
+	return (col < FONT3X5_STRIDE) ? (pgm_read_byte(&font3x5[font3x5Offset(c) + col]) & 0x1f) : 0;
+}
+
+#endif
@@ -3,17 +3,40 @@
 
 /**********************************************************************************/
 
-BackgroundEngine::BackgroundEngine(Adafruit_WS2801* board) {
+ColourWipe::ColourWipe(Adafruit_WS2801* board, uint32_t c, uint16_t period) : Effect(period) {
+	strip = board;
+	colour = c;
+	pos = 0;
+}
+
+void ColourWipe::setColour(uint32_t c) {
+	colour = c;
+}
+
+void ColourWipe::reset(void) {
+	pos = 0;
+}
+
+bool ColourWipe::step(unsigned long now) {
+	uint16_t n = (uint16_t)(*strip).w() * (*strip).h();
+	if (pos < n) {
+		(*strip).spc(pos / (*strip).w(), pos % (*strip).w(), colour);
+		pos++;
+	}
+	// We don't need to continue after we've done every pixel.
+	return pos < n;
+}
+
+/**********************************************************************************/
+
+BackgroundEngine::BackgroundEngine(Adafruit_WS2801* board) : wipe(board, 0, 0) {
 	strip = board;
 	isFirstIter = true;
 	isDone = false;
-	// NOTE: We will not allocate the background member here, since there are effects where we can avoid this and save memory. Thus allocation for background will be done in the specific effect.
+	lastStep = 0;
 }
 
-BackgroundEngine::~BackgroundEngine() {
-	free(background);
-	free(data);
-}
+BackgroundEngine::~BackgroundEngine() {}
 
 void BackgroundEngine::setIsFirstIter(bool val) {
 	isFirstIter = val;
@@ -21,30 +44,28 @@ void BackgroundEngine::setIsFirstIter(bool val) {
 
 void BackgroundEngine::setIsDone(bool val) {
 	isDone = val;
-	free(data);
-	data = NULL;
 }
 
-// Performs colourwipe. wait is in milliseconds.
+// Fills the whole wall with the background colour c
+void BackgroundEngine::setColour(uint32_t c) {
+	(*strip).fillRect(0, 0, (*strip).h() - 1, (*strip).w() - 1, c);
+}
+
+// Performs colourwipe. wait is in milliseconds. Colours the next pixel if wait has passed since the last one,
+// and returns straight away otherwise.
 void BackgroundEngine::colourWipe(uint32_t c, uint8_t wait) {
-	if (!isDone) {
-		if (isFirstIter) {
-			// To perform a colourWipe iteration, we need to store the current LED we need to colour. Since all we need to store for this effect is one int, we'll store it in data without any memory allocation.
-			*data = 0;
-		}
+	unsigned long now = millis();
+
+	if (isDone) return;
+	if (isFirstIter) {
+		wipe.setColour(c);
+		wipe.reset();
+		lastStep = now - wait;
 		setIsFirstIter(false);
-		int i;
-		for (i = 0; i < *data; i++) {
-			(*strip).spc(*data / (*strip).w(), *data % (*strip).w(), c);
-		}
-		
-		*data++;
-		
-		// We don't need to continue after we've done every pixel.
-		if (*data == ((*strip).w() * (*strip).h())) {
-			setIsDone(true);
-		}
-		
-		delay(wait);
 	}
-}
\ No newline at end of file
+	if (now - lastStep < wait) return;
+	lastStep = now;
+	if (!wipe.step(now)) {
+		setIsDone(true);
+	}
+}
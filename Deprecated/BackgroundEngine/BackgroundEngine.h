@@ -1,7 +1,8 @@
-#ifndef __SHAPES_H_INCLUDED__
-#define __SHAPES_H_INCLUDED__
+#ifndef __BACKGROUNDENGINE_H_INCLUDED__
+#define __BACKGROUNDENGINE_H_INCLUDED__
 
 #include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../Scheduler/Scheduler.h"
 #if (ARDUINO >= 100)
  #include <Arduino.h>
 #else
@@ -9,8 +10,31 @@
  #include <pins_arduino.h>
 #endif
 
+// Background effects, for running from a Scheduler alongside text and other effects.
+
+// Colours the wall one pixel per period, row by row, then finishes.
+class ColourWipe : public Effect {
+	public:
+
+		ColourWipe(Adafruit_WS2801* board, uint32_t c, uint16_t period);
+
+		void
+			// Colour used from the next pixel on
+			setColour(uint32_t c),
+			reset(void);
+		bool
+			step(unsigned long now);
+
+	private:
+		Adafruit_WS2801* strip;
+		uint32_t colour;
+		// Next pixel to colour, counting along the rows
+		uint16_t pos;
+};
+
 // This class will act as a sort of 'engine' that can run background effects on the board. It is initialized as a global variable, and the effect is to be called in the loop() function.
 // In most cases, the effect performed by the engine should be the first thing called in loop().
+// The effects no longer block: each call does whatever is due and returns. To run several effects together, add them to a Scheduler instead.
 class BackgroundEngine {
 	public:
 	
@@ -18,13 +42,13 @@ class BackgroundEngine {
 		~BackgroundEngine(void);
 		
 		void
-			// set the firstIt value
+			// set the firstIt value (true starts the effect again on the next call)
 			setIsFirstIter(bool val),
 			// set the isDone value
 			setIsDone(bool val),
 			// set the background colour
 			setColour(uint32_t c),
-			// performs the colour wipe effect. The wait is optional since 
+			// performs the colour wipe effect, one pixel every wait milliseconds
 			colourWipe(uint32_t c, uint8_t wait);
 		
 	private:
@@ -34,11 +58,11 @@ class BackgroundEngine {
 		bool isFirstIter;
 		// boolean to determine whether the effect is finished
 		bool isDone;
-		// We store the background explicitly
-		uint32_t * background;
-		// We don't know what data we need for the given effect, so we'll just have an int pointer point to another pointer containing the data we need (in most cases).
-		int * data;
+		// Each effect keeps its own state
+		ColourWipe wipe;
+		// When the current effect last took a step
+		unsigned long lastStep;
 		
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,194 @@
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../Drawable/Drawable.h"
+#include "Compositor.h"
+#include <stdlib.h>
+
+/**********************************************************************************/
+
+Compositor::Compositor(Adafruit_WS2801* board, uint8_t maxLayers) {
+	strip = board;
+	count = numDirty = 0;
+	capacity = maxLayers;
+	// Each layer can dirty its old and new boxes, plus one spare for removals and invalidateAll
+	dirtyCapacity = 2 * maxLayers + 1;
+	layers = (Layer*) calloc(capacity, sizeof(Layer));
+	dirty = (Rect*) calloc(dirtyCapacity, sizeof(Rect));
+	if (layers == NULL || dirty == NULL) {
+		capacity = dirtyCapacity = 0;
+	}
+	background = NULL;
+	backgroundColour = 0;
+}
+
+Compositor::~Compositor(void) {
+	free(layers);
+	free(dirty);
+	free(background);
+}
+
+uint8_t Compositor::numLayers(void) {
+	return count;
+}
+
+// Bounding box of a drawable, clipped to the wall
+Compositor::Rect Compositor::boxOf(Drawable* d) {
+	Rect r;
+	r.i1 = max((*d).getBasePointY(), 0);
+	r.j1 = max((*d).getBasePointX(), 0);
+	r.i2 = min((*d).getBasePointY() + (*d).h() - 1, (*strip).h() - 1);
+	r.j2 = min((*d).getBasePointX() + (*d).w() - 1, (*strip).w() - 1);
+	if (r.j2 < r.j1) r.i2 = r.i1 - 1; // Normalize to a single kind of empty
+	return r;
+}
+
+bool Compositor::overlaps(const Rect& a, const Rect& b) {
+	return a.i1 <= b.i2 && b.i1 <= a.i2 && a.j1 <= b.j2 && b.j1 <= a.j2;
+}
+
+// Queue a rectangle for repainting. If the list is full, the last entry grows to cover r as well.
+void Compositor::addDirty(Rect r) {
+	if (r.i2 < r.i1 || dirtyCapacity == 0) return;
+	if (numDirty < dirtyCapacity) {
+		dirty[numDirty++] = r;
+	} else {
+		Rect& last = dirty[numDirty - 1];
+		last.i1 = min(last.i1, r.i1);
+		last.j1 = min(last.j1, r.j1);
+		last.i2 = max(last.i2, r.i2);
+		last.j2 = max(last.j2, r.j2);
+	}
+}
+
+// Paint the background over r
+void Compositor::restore(const Rect& r) {
+	int16_t i;
+	if (background == NULL) {
+		(*strip).fillRect(r.i1, r.j1, r.i2, r.j2, backgroundColour);
+	} else {
+		for (i = r.i1; i <= r.i2; i++) {
+			(*strip).blit(&background[i * (*strip).w() + r.j1], i, r.j1, r.j2 - r.j1 + 1, 1);
+		}
+	}
+}
+
+int Compositor::find(Drawable* d) {
+	int k;
+	for (k = 0; k < count; k++) {
+		if (layers[k].d == d) return k;
+	}
+	return -1;
+}
+
+bool Compositor::addLayer(Drawable* d, int8_t dy, int8_t dx, uint16_t period) {
+	if (count >= capacity) return false;
+	Layer& l = layers[count++];
+	l.d = d;
+	l.drawn.i1 = 0;
+	l.drawn.i2 = -1; // Not drawn yet
+	l.drawn.j1 = l.drawn.j2 = 0;
+	l.dy = dy;
+	l.dx = dx;
+	l.period = period;
+	l.lastMove = millis();
+	l.dirty = true;
+	return true;
+}
+
+void Compositor::removeLayer(Drawable* d) {
+	int k = find(d);
+	if (k < 0) return;
+	addDirty(layers[k].drawn);
+	for (; k < count - 1; k++) {
+		layers[k] = layers[k + 1];
+	}
+	count--;
+}
+
+void Compositor::setMotion(Drawable* d, int8_t dy, int8_t dx, uint16_t period) {
+	int k = find(d);
+	if (k < 0) return;
+	layers[k].dy = dy;
+	layers[k].dx = dx;
+	layers[k].period = period;
+}
+
+void Compositor::invalidate(Drawable* d) {
+	int k = find(d);
+	if (k >= 0) layers[k].dirty = true;
+}
+
+void Compositor::invalidateAll(void) {
+	Rect r;
+	r.i1 = r.j1 = 0;
+	r.i2 = (*strip).h() - 1;
+	r.j2 = (*strip).w() - 1;
+	addDirty(r);
+}
+
+// Snapshot the board as the background. Falls back to the solid colour if there isn't enough memory.
+void Compositor::captureBackground(void) {
+	if (background == NULL) {
+		background = (uint32_t*) malloc((*strip).h() * (*strip).w() * sizeof(uint32_t));
+	}
+	if (background != NULL) {
+		(*strip).grab(background, 0, 0, (*strip).w(), (*strip).h());
+	}
+}
+
+void Compositor::setBackground(uint32_t c) {
+	free(background);
+	background = NULL;
+	backgroundColour = c;
+	invalidateAll();
+}
+
+bool Compositor::render(void) {
+	int k, r;
+	Rect box;
+
+	// Find the layers that moved or changed, and mark where they were and where they are now
+	for (k = 0; k < count; k++) {
+		Layer& l = layers[k];
+		box = boxOf(l.d);
+		if (l.dirty || box.i1 != l.drawn.i1 || box.j1 != l.drawn.j1 || box.i2 != l.drawn.i2 || box.j2 != l.drawn.j2) {
+			addDirty(l.drawn);
+			addDirty(box);
+			l.drawn = box;
+			l.dirty = false;
+		}
+	}
+	if (numDirty == 0) return false;
+
+	for (r = 0; r < numDirty; r++) {
+		restore(dirty[r]);
+	}
+	// Redraw, bottom layer first, everything that touches a repainted area. A redrawn layer is drawn whole,
+	// so any layer above that overlaps it has to be redrawn too, or it would end up underneath.
+	for (k = 0; k < count; k++) {
+		Layer& l = layers[k];
+		l.redrawn = false;
+		for (r = 0; r < numDirty && !l.redrawn; r++) {
+			l.redrawn = overlaps(l.drawn, dirty[r]);
+		}
+		for (r = 0; r < k && !l.redrawn; r++) {
+			l.redrawn = layers[r].redrawn && overlaps(l.drawn, layers[r].drawn);
+		}
+		if (l.redrawn) (*l.d).draw();
+	}
+	numDirty = 0;
+	return true;
+}
+
+bool Compositor::update(unsigned long now) {
+	int k;
+	for (k = 0; k < count; k++) {
+		Layer& l = layers[k];
+		if (l.period > 0 && now - l.lastMove >= l.period) {
+			(*l.d).translate(l.dy, l.dx);
+			l.lastMove = now;
+		}
+	}
+	if (!render()) return false;
+	(*strip).show();
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef __COMPOSITOR_H_INCLUDED__
+#define __COMPOSITOR_H_INCLUDED__
+
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../Drawable/Drawable.h"
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Draws an ordered stack of Drawables (layers) over a background, repainting only the parts of the wall that changed.
+// For every layer it remembers the bounding box it was last drawn at; when a layer moves (or is invalidated), the
+// background is restored over its old and new boxes, and the layers touching those areas are redrawn in order.
+// Work per frame is proportional to the size of what moved, not to the size of the wall.
+// Nothing here blocks: call update(millis()) from loop() and it will move, redraw and show as needed.
+// Like the rest of the library, positions use matrix notation (i = row, j = column).
+class Compositor {
+
+	public:
+
+		// Compositor for board holding up to maxLayers layers. The background starts out as solid colour 0.
+		Compositor(Adafruit_WS2801* board, uint8_t maxLayers);
+		// Release memory (the layers themselves belong to the caller)
+		~Compositor(void);
+
+		bool
+			// Add a layer above all existing ones. Every period milliseconds (0 = never), update() moves it by dy,dx.
+			// Returns false if the compositor is full.
+			addLayer(Drawable* d, int8_t dy = 0, int8_t dx = 0, uint16_t period = 0),
+			// Advance moving layers to time now (usually millis()), redraw what changed and show it.
+			// Returns true if a new frame was shown.
+			update(unsigned long now),
+			// Redraw what changed since the last render, without showing it. Returns true if anything was redrawn.
+			render(void);
+		void
+			// Remove a layer; the area it covered is repainted on the next render
+			removeLayer(Drawable* d),
+			// Change how update() moves a layer
+			setMotion(Drawable* d, int8_t dy, int8_t dx, uint16_t period),
+			// Redraw a layer on the next render even though it hasn't moved (e.g. after setColour)
+			invalidate(Drawable* d),
+			// Redraw the whole wall on the next render
+			invalidateAll(void),
+			// Use the current contents of the board as the background
+			captureBackground(void),
+			// Use a solid colour as the background
+			setBackground(uint32_t c);
+		uint8_t
+			// Number of layers
+			numLayers(void);
+
+	private:
+
+		// Inclusive rectangle on the wall; empty if i2 < i1
+		struct Rect {
+			int16_t i1, j1, i2, j2;
+		};
+
+		struct Layer {
+			Drawable* d;
+			Rect drawn;				// Where it was last drawn (clipped to the wall)
+			int8_t dy, dx;			// Motion per period
+			uint16_t period;		// Milliseconds between moves, 0 = stationary
+			unsigned long lastMove;
+			bool dirty;				// Redraw even if it hasn't moved
+			bool redrawn;			// Drawn during the current render
+		};
+
+		void
+			addDirty(Rect r),
+			restore(const Rect& r);
+		Rect
+			boxOf(Drawable* d);
+		int
+			find(Drawable* d);
+		static bool
+			overlaps(const Rect& a, const Rect& b);
+
+		Adafruit_WS2801* strip;
+		Layer* layers;
+		Rect* dirty;				// Areas to repaint on the next render
+		uint8_t
+			count,
+			capacity,
+			numDirty,
+			dirtyCapacity;
+		uint32_t* background;		// Snapshot of the board, or NULL for a solid colour
+		uint32_t backgroundColour;
+};
+
+#endif
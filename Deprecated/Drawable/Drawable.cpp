@@ -1,21 +1,39 @@
 #include "../Adafruit_WS2801/Adafruit_WS2801.h"
 #include "Drawable.h"
+#include "../Compositor/Compositor.h"
 #include <stdlib.h>
+#include <string.h>
 
 /**********************************************************************************/
 
 // Constructor with colour
-Drawable::Drawable(Adafruit_WS2801* board, uint8_t yOff, uint8_t xOff, uint8_t w, uint8_t h) {
+Drawable::Drawable(Adafruit_WS2801* board, int16_t yOff, int16_t xOff, uint8_t w, uint8_t h, uint8_t bpp) {
 	strip = board;
 	basePoint[0] = yOff;
 	basePoint[1] = xOff;
 	width = w;
 	height = h;
-	boundingBox = (uint32_t*) calloc(w * h, 4);
+	bitsPerPixel = (bpp == 2 || bpp == 4 || bpp == 8) ? bpp : 1;
+	paletteUsed = 0;
+	// Palette and bitmap share one allocation; the palette comes first so it stays aligned
+	uint8_t entries = (1 << bitsPerPixel) - 1;
+	palette = (uint32_t*) calloc(1, entries * sizeof(uint32_t) + bitmapBytes());
+	if (palette == NULL) {
+		// Out of memory: an empty drawable, which draws nothing and ignores colours
+		width = height = 0;
+		bits = ownBits = NULL;
+	} else {
+		bits = ownBits = (uint8_t*) (palette + entries);
+	}
 }
 
 Drawable::~Drawable(void) {
-	free(boundingBox);
+	free(palette);
+}
+
+// Size of the bitmap in bytes
+uint16_t Drawable::bitmapBytes(void) {
+	return ((uint32_t)width * height * bitsPerPixel + 7) / 8;
 }
 
 // Width of bounding box
@@ -35,81 +53,169 @@ void Drawable::translate(int dy, int dx) {
 }
 
 // Set the upper left corner position of bounding box
-void Drawable::setPosition(uint8_t y, uint8_t x) {
+void Drawable::setPosition(int16_t y, int16_t x) {
 	basePoint[0] = y;
 	basePoint[1] = x;
 }
 
 // Set the colour of the drawing (affects only the non-transparent entries of bounding box array)
+// Only the palette is touched, so this costs the same whatever the size of the drawing.
 void Drawable::setColour(uint32_t c) {
-	int i;
-	for (i = 0; i < w() * h(); i++) {
-		if (boundingBox[i] != 0) {
-			boundingBox[i] = c;
-		}
+	uint8_t n, entries = (1 << bitsPerPixel) - 1;
+	if (palette == NULL) return;
+	for (n = 0; n < entries; n++) {
+		palette[n] = c;
 	}
 }
+
+void Drawable::setPaletteColour(uint8_t n, uint32_t c) {
+	if (palette != NULL && n > 0 && n < (1 << bitsPerPixel)) {
+		palette[n - 1] = c;
+		if (n > paletteUsed) paletteUsed = n;
+	}
+}
+
+uint32_t Drawable::getPaletteColour(uint8_t n) {
+	if (palette != NULL && n > 0 && n < (1 << bitsPerPixel)) {
+		return palette[n - 1];
+	}
+	return 0;
+}
+
 // Set the colour of a specific pixel in Drawable. Must be valid pixel, else will do nothing.
 void Drawable::spc(uint8_t i, uint8_t j, uint32_t c) {
-	if ( i < h() && i >= 0 && j < w() && j >= 0 ) {
-		boundingBox[i * w() + j] = c;
+	uint16_t n; // Can reach 256
+
+	if (palette == NULL || i >= h() || j >= w()) return;
+	if (c == 0) {
+		setPaletteIndex(i, j, 0);
+		return;
+	}
+	// Reuse the palette entry with this colour if there is one, else take a new one, widening the bitmap
+	// when the palette is full. Changing an entry in use would recolour other pixels, so if it can't be
+	// widened the colour is refused.
+	for (n = 1; n <= paletteUsed && palette[n - 1] != c; n++);
+	if (n > paletteUsed) {
+		if (paletteUsed == (1 << bitsPerPixel) - 1 && !widen()) return;
+		n = ++paletteUsed;
+		palette[n - 1] = c;
 	}
+	setPaletteIndex(i, j, n);
 }
+
+// Double the bits per pixel (up to 8), keeping every pixel's palette entry. The palette and bitmap are
+// reallocated together; a borrowed bitmap is copied as it is repacked. False if already 8 bits, or out of memory.
+bool Drawable::widen(void) {
+	uint8_t bpp = bitsPerPixel * 2, entries = (1 << bitsPerPixel) - 1, i, j;
+	uint32_t k, *wider;
+	uint8_t *wideBits;
+
+	if (bitsPerPixel == 8) return false;
+	wider = (uint32_t*) calloc(1, ((1 << bpp) - 1) * sizeof(uint32_t) + ((uint32_t)w() * h() * bpp + 7) / 8);
+	if (wider == NULL) return false;
+	memcpy(wider, palette, entries * sizeof(uint32_t));
+	wideBits = (uint8_t*) (wider + (1 << bpp) - 1);
+	for (i = 0; i < h(); i++) {
+		for (j = 0; j < w(); j++) {
+			k = ((uint32_t)i * w() + j) * bpp;
+			wideBits[k >> 3] |= getPaletteIndex(i, j) << (k & 7);
+		}
+	}
+	free(palette);
+	palette = wider;
+	bits = ownBits = wideBits;
+	bitsPerPixel = bpp;
+	return true;
+}
+
+void Drawable::setPaletteIndex(uint8_t i, uint8_t j, uint8_t n) {
+	uint32_t k;
+	uint8_t shift, valueMask = (1 << bitsPerPixel) - 1;
+
+	if (i >= h() || j >= w()) return;
+	if (bits != ownBits) {
+		// Copy on write: start from the borrowed bitmap
+		memcpy(ownBits, bits, bitmapBytes());
+		bits = ownBits;
+	}
+	k = ((uint32_t)i * w() + j) * bitsPerPixel;
+	shift = k & 7;
+	ownBits[k >> 3] = (ownBits[k >> 3] & ~(valueMask << shift)) | ((n & valueMask) << shift);
+}
+
+uint8_t Drawable::getPaletteIndex(uint8_t i, uint8_t j) {
+	uint32_t k;
+
+	if (i >= h() || j >= w()) return 0;
+	k = ((uint32_t)i * w() + j) * bitsPerPixel;
+	return (bits[k >> 3] >> (k & 7)) & ((1 << bitsPerPixel) - 1);
+}
+
+void Drawable::setBitmap(const uint8_t* b) {
+	bits = (b != NULL) ? b : ownBits;
+}
+
 // Draw the drawable onto the board
 // If transparent = true, then entries with colour 0 will not be drawn to the screen (so the object will be transparent where it is not coloured), else it will overwrite.
+// Parts of the drawable that are off the wall are clipped. Empty bytes of the bitmap are skipped whole.
 void Drawable::draw(bool transparent) {
-	int i,j;
-	
-	for (i = 0; i < h(); i++) {
-		for (j = 0; j < w(); j++) {
-			if (!transparent || boundingBox[i * w() + j] > 0) 
-				(*strip).spc(i + basePoint[0],j + basePoint[1], boundingBox[i * w() + j]); // Remember, we are using matrix subscript notation, so yOff first, then xOff
+	uint16_t k, n = (uint16_t)w() * h();
+	uint8_t perByte = 8 / bitsPerPixel, valueMask = (1 << bitsPerPixel) - 1, byte, v, b;
+	int16_t i = 0, j = 0, y, x; // (i,j) is pixel k's position within the drawable
+
+	for (k = 0; k < n; k += perByte) {
+		byte = bits[k / perByte];
+		if (byte == 0 && transparent) {
+			j += perByte;
+		} else {
+			for (b = 0; b < perByte && k + b < n; b++, j++, byte >>= bitsPerPixel) {
+				while (j >= w()) { j -= w(); i++; }
+				v = byte & valueMask;
+				if (v == 0 && transparent) continue;
+				y = i + basePoint[0]; // Remember, we are using matrix subscript notation, so yOff first, then xOff
+				x = j + basePoint[1];
+				if (y >= 0 && y < (*strip).h() && x >= 0 && x < (*strip).w())
+					(*strip).spc(y, x, v ? palette[v - 1] : 0);
+			}
 		}
+		while (j >= w() && w() > 0) { j -= w(); i++; }
 	}
 }
 
 // Returns the base point x-coordinate
-uint8_t Drawable::getBasePointX(void) {
+int16_t Drawable::getBasePointX(void) {
 	return basePoint[1];
 }
 
 // REturns the base point y-coordinate
-uint8_t Drawable::getBasePointY(void) {
+int16_t Drawable::getBasePointY(void) {
 	return basePoint[0];
 }
 
 // Returns pixel color in (i,j)th coordinate of bounding box array
 uint32_t Drawable::gpc(uint8_t i, uint8_t j) {
-	return boundingBox[i * w() + j];
+	return getPaletteColour(getPaletteIndex(i, j));
 }
 
 // Causes drawables to crawl across screen. Delay is in milliseconds.
 // NOTE: To work properly, board cannot already have any of the letters to be crawled drawn on it yet.
-//		 Every iteration it will redraw the 'original' board, and then draw the drawables being crawled.
+//		 The 'original' board is kept as the background, and only the areas the drawables leave or enter are redrawn.
+//		 This blocks for the whole crawl; to animate while doing other work, use a Compositor from loop().
 void Drawable::crawl(Adafruit_WS2801* board, Drawable** d, int dlen, int dy, int dx, int n, int wait) {
-	int i,j,k,l;
-	
-	uint32_t* background = (uint32_t*) calloc((*board).h() * (*board).w(), 4);
+	int i,j;
+	Compositor layers(board, dlen);
 	
-	for (i = 0; i < (*board).h(); i++) {
-		for (j = 0; j < (*board).w(); j++) {
-			background[i*(*board).w() + j] = (*board).gpc(i,j);
-		}
+	layers.captureBackground();
+	for (j = 0; j < dlen; j++) {
+		layers.addLayer(d[j]);
 	}
 
 	for (i = 0; i < n; i++) {
-		for (k = 0; k < (*board).h(); k++) {
-			for (l = 0; l < (*board).w(); l++) {
-				(*board).spc(k,l,background[k*(*board).w() + l]);
-			}
-		}
+		layers.render();
 		for (j = 0; j < dlen; j++) {
-			(*d[j]).draw();
 			(*d[j]).translate(dy, dx);
 		}
 		(*board).show();
 		delay(wait);
 	}
-	
-	free(background);
-}
\ No newline at end of file
+}
@@ -11,24 +11,41 @@
 
 // BIG NOTE: The grid is organized by matrix notation, so basepoint will be [y,x] not the reverse. Similarly, the functions related to the x,y position will be done using y then x.
 
+// Pixels are stored packed, bpp bits each (1, 2, 4 or 8), as indices into a small palette; index 0 is transparent.
+// With the default of 1 bit per pixel the drawable is monochrome: every set pixel shares one colour, so a 3x5
+// glyph takes 2 bytes plus its colour instead of 60 bytes. With 2, 4 or 8 bits, up to 3, 15 or 255 colours can
+// be mixed; spc() widens the bitmap when it needs another colour.
+// Bitmap layout (also for setBitmap): pixel (i,j) is number k = i*w + j, held in bits k*bpp .. k*bpp+bpp-1
+// counting from the least significant bit of byte 0, i.e. ((w*h*bpp + 7) / 8) bytes in all.
+
 class Drawable {
 
 	public:
 
 		// Create drawable object, initialize upper left corner, bounding box and also pass the strip to which it will draw
-		Drawable(Adafruit_WS2801* board, uint8_t yOff, uint8_t xOff, uint8_t w, uint8_t h);
+		Drawable(Adafruit_WS2801* board, int16_t yOff, int16_t xOff, uint8_t w, uint8_t h, uint8_t bpp = 1);
 		// Release memory (as needed):
 		~Drawable();
 	
 		void
 			// Translate the drawable object to another position relative to current
 			translate(int dy, int dx),
-			// Set the upper left corner position of bounding box
-			setPosition(uint8_t y, uint8_t x),
+			// Set the upper left corner position of bounding box (may be off the wall)
+			setPosition(int16_t y, int16_t x),
 			// Set the colour of the drawing (affects only the non-transparent entries of bounding box array)
 			setColour(uint32_t c),
-			// Set the colour of a specific pixel in Drawable
+			// Set the colour of a specific pixel in Drawable. 0 makes it transparent. When the palette is full
+			// (always, for monochrome drawables once a colour is set) the bitmap is widened to the next bpp,
+			// which stops using a setBitmap() bitmap; if that can't be done (255 colours, or out of memory)
+			// the pixel is left as it is.
 			spc(uint8_t i, uint8_t j, uint32_t c),
+			// Set palette entry n (1 .. 2^bpp - 1) to colour c; recolours every pixel using it
+			setPaletteColour(uint8_t n, uint32_t c),
+			// Set pixel (i,j) to palette entry n (0 = transparent)
+			setPaletteIndex(uint8_t i, uint8_t j, uint8_t n),
+			// Show a bitmap held elsewhere (same size, bpp and layout, see above) instead of our own, e.g. to flip
+			// through animation frames. It is not copied until a pixel is changed, so it must stay valid.
+			setBitmap(const uint8_t* b),
 			// Draw the drawable onto the board
 			// If transparent == true, then entries with colour 0 will not be drawn to the screen (so the object will be transparent where it is not coloured), else it will overwrite.
 			draw(bool transparent = true);
@@ -37,16 +54,22 @@ class Drawable {
 			w(void),
 			// Height of bounding box
 			h(void),
+			// Palette entry used by pixel (i,j), 0 if transparent
+			getPaletteIndex(uint8_t i, uint8_t j);
+		int16_t
 			// Returns the x-coordinate of base point
 			getBasePointX(void),
 			// Returns the y-coordinate of base point
 			getBasePointY(void);
 		uint32_t
 			// Returns pixel color in (i,j)th coordinate of bounding box array
-			gpc(uint8_t i, uint8_t j);
+			gpc(uint8_t i, uint8_t j),
+			// Colour of palette entry n (0 for transparent)
+			getPaletteColour(uint8_t n);
 		static void
 			// Causes drawables to move across screen dy,dx for n iterations. dlen is length of array
 			// Takes in array of pointers to the drawable objects
+			// Blocks for n * wait milliseconds; use a Compositor to animate from loop() instead.
 			crawl(Adafruit_WS2801* board, Drawable** d, int dlen, int dy, int dx, int n, int wait);
 			
 	private:
@@ -54,11 +77,23 @@ class Drawable {
 		uint8_t 
 			width,
 			height,
+			bitsPerPixel,
+			paletteUsed;		// Palette entries assigned by spc() so far
+		int16_t
 			basePoint[2];
 		Adafruit_WS2801* 
 			strip;
 		uint32_t  
-			*boundingBox;
+			*palette;			// Entries 1 .. 2^bpp - 1 are palette[0] .. ; one allocation with ownBits
+		uint8_t
+			*ownBits;			// Our own bitmap
+		const uint8_t
+			*bits;				// Bitmap being drawn: ownBits, or one passed to setBitmap()
+
+		uint16_t
+			bitmapBytes(void);
+		bool
+			widen(void);
 };
 
 #endif
\ No newline at end of file
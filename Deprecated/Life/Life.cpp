@@ -0,0 +1,221 @@
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "Life.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************************************/
+
+Life::Life(uint16_t h, uint16_t w, const char* rule) {
+	height = h;
+	width = w;
+	words = (w + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+	// Both generations share one allocation
+	cells = (LifeWord*) calloc(2 * (size_t)height * words, sizeof(LifeWord));
+	if (cells == NULL) {
+		height = width = words = 0;
+	}
+	spare = cells + (size_t)height * words;
+	birth = 1 << 3;
+	survive = (1 << 2) | (1 << 3);
+	setRule(rule);
+	clear();
+}
+
+Life::~Life(void) {
+	// cells and spare get swapped, so free whichever holds the start of the allocation
+	free(cells < spare ? cells : spare);
+}
+
+uint16_t Life::h(void) {
+	return height;
+}
+
+uint16_t Life::w(void) {
+	return width;
+}
+
+uint32_t Life::population(void) {
+	return pop;
+}
+
+unsigned long Life::generation(void) {
+	return gen;
+}
+
+bool Life::setRule(const char* rule) {
+	uint16_t masks[2] = {0, 0};
+	uint8_t part = 0;
+	bool named = false;		// "B.../S..." rather than "survive/birth"
+	const char* p;
+
+	if (rule == NULL) return false;
+	for (p = rule; *p; p++) {
+		if (*p == 'B' || *p == 'b') {
+			part = 1;
+			named = true;
+		}
+		else if (*p == 'S' || *p == 's') {
+			part = 0;
+			named = true;
+		}
+		else if (*p == '/') {
+			if (!named) part++;
+			if (part > 1) return false;
+		}
+		else if (*p >= '0' && *p <= '8') {
+			masks[part] |= 1 << (*p - '0');
+		}
+		else {
+			return false;
+		}
+	}
+	survive = masks[0];
+	birth = masks[1];
+	return true;
+}
+
+void Life::clear(void) {
+	memset(cells, 0, (size_t)height * words * sizeof(LifeWord));
+	pop = 0;
+	gen = 0;
+	historyPos = historyUsed = cycle = 0;
+}
+
+bool Life::get(uint16_t i, uint16_t j) {
+	if (i >= height || j >= width) return false;
+	return (cells[i * words + j / LIFE_WORD_BITS] >> (j % LIFE_WORD_BITS)) & 1;
+}
+
+void Life::set(uint16_t i, uint16_t j, bool alive) {
+	LifeWord bit, *c;
+	if (i >= height || j >= width) return;
+	c = &cells[i * words + j / LIFE_WORD_BITS];
+	bit = (LifeWord)1 << (j % LIFE_WORD_BITS);
+	if (alive && !(*c & bit)) pop++;
+	if (!alive && (*c & bit)) pop--;
+	*c = alive ? (*c | bit) : (*c & ~bit);
+	// The board has been edited, so earlier generations tell us nothing
+	historyUsed = cycle = 0;
+}
+
+void Life::randomize(uint16_t n) {
+	uint16_t k;
+	if (height == 0) return;
+	for (k = 0; k < n; k++) {
+		set(random(height), random(width), true);
+	}
+}
+
+// Valid bits of word k of a row: the last word may be partly used
+LifeWord Life::mask(uint16_t k) {
+	if (k + 1 < words || width % LIFE_WORD_BITS == 0) return ~(LifeWord)0;
+	return ((LifeWord)1 << (width % LIFE_WORD_BITS)) - 1;
+}
+
+// Word k of row r, moved so that each cell sees its neighbour to the west (column j-1, wrapping around)
+LifeWord Life::west(const LifeWord* r, uint16_t k) {
+	LifeWord v = r[k] << 1;
+	if (k > 0)
+		v |= r[k - 1] >> (LIFE_WORD_BITS - 1);
+	else
+		v |= (r[(width - 1) / LIFE_WORD_BITS] >> ((width - 1) % LIFE_WORD_BITS)) & 1;
+	return v & mask(k);
+}
+
+// Word k of row r, moved so that each cell sees its neighbour to the east (column j+1, wrapping around)
+LifeWord Life::east(const LifeWord* r, uint16_t k) {
+	LifeWord v = r[k] >> 1;
+	if (k + 1 < words)
+		v |= r[k + 1] << (LIFE_WORD_BITS - 1);
+	else
+		v |= (r[0] & 1) << ((width - 1) % LIFE_WORD_BITS);
+	return v;
+}
+
+void Life::step(void) {
+	uint16_t i, k;
+	uint8_t n;
+	const LifeWord *up, *mid, *down;
+	LifeWord *out, *t;
+	LifeWord nw, nn, ne, ww, ee, sw, ss, se, alive, v, m;
+	LifeWord a0, a1, b0, b1, c0, c1, d1, e1, e2, f2, s0, s1, s2, s3;
+	uint32_t hash = 2166136261UL;
+
+	if (height == 0) return;
+	pop = 0;
+	for (i = 0; i < height; i++) {
+		up = &cells[(i == 0 ? height - 1 : i - 1) * words];
+		mid = &cells[i * words];
+		down = &cells[(i + 1 == height ? 0 : i + 1) * words];
+		out = &spare[i * words];
+
+		for (k = 0; k < words; k++) {
+			nw = west(up, k);	nn = up[k];		ne = east(up, k);
+			ww = west(mid, k);	alive = mid[k];	ee = east(mid, k);
+			sw = west(down, k);	ss = down[k];	se = east(down, k);
+
+			// Add the eight neighbour words, bit by bit, into a 4-bit count (s3 s2 s1 s0) for every cell.
+			// Full adders on three rows of three, then the carries.
+			a0 = nw ^ nn ^ ne;	a1 = (nw & nn) | (ne & (nw ^ nn));
+			b0 = ww ^ ee ^ sw;	b1 = (ww & ee) | (sw & (ww ^ ee));
+			c0 = ss ^ se;		c1 = ss & se;
+			s0 = a0 ^ b0 ^ c0;	d1 = (a0 & b0) | (c0 & (a0 ^ b0));
+			// Twos: a1, b1, c1, d1
+			e1 = a1 ^ b1 ^ c1;	f2 = (a1 & b1) | (c1 & (a1 ^ b1));
+			s1 = e1 ^ d1;		e2 = e1 & d1;
+			// Fours: f2, e2
+			s2 = f2 ^ e2;		s3 = f2 & e2;
+
+			// Apply the rule, one neighbour count at a time
+			v = 0;
+			for (n = 0; n <= 8; n++) {
+				if (!(((birth | survive) >> n) & 1)) continue;
+				m = ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1) & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+				if ((birth >> n) & 1) v |= m & ~alive;
+				if ((survive >> n) & 1) v |= m & alive;
+			}
+			v &= mask(k);
+			out[k] = v;
+
+			hash = (hash ^ v) * 16777619UL;
+			for (m = v; m; m &= m - 1) pop++;
+		}
+	}
+	t = cells;
+	cells = spare;
+	spare = t;
+	gen++;
+	remember(hash ^ pop);
+}
+
+// Record the new generation's hash, and look for it among the ones before
+void Life::remember(uint32_t hash) {
+	uint8_t p;
+	cycle = 0;
+	for (p = 1; p <= historyUsed && cycle == 0; p++) {
+		if (history[(historyPos + LIFE_HISTORY - p) % LIFE_HISTORY] == hash) cycle = p;
+	}
+	history[historyPos] = hash;
+	historyPos = (historyPos + 1) % LIFE_HISTORY;
+	if (historyUsed < LIFE_HISTORY) historyUsed++;
+}
+
+uint8_t Life::cycleLength(void) {
+	return cycle;
+}
+
+bool Life::isSteady(void) {
+	return cycle != 0;
+}
+
+void Life::draw(Adafruit_WS2801* strip, uint32_t alive, uint32_t dead) {
+	uint16_t i, j;
+	LifeWord v = 0;
+	for (i = 0; i < height && i < (*strip).h(); i++) {
+		for (j = 0; j < width && j < (*strip).w(); j++) {
+			if (j % LIFE_WORD_BITS == 0) v = cells[i * words + j / LIFE_WORD_BITS];
+			(*strip).spc(i, j, (v & 1) ? alive : dead);
+			v >>= 1;
+		}
+	}
+}
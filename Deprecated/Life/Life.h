@@ -0,0 +1,92 @@
+#ifndef __LIFE_H_INCLUDED__
+#define __LIFE_H_INCLUDED__
+
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Number of earlier generations remembered for cycle detection, i.e. the longest period that is recognised
+#define LIFE_HISTORY 8
+
+typedef uint32_t LifeWord;
+#define LIFE_WORD_BITS 32
+
+// Life-like cellular automaton on a board of any size whose edges wrap around (a torus), as in conwaysGame.
+// Each row is packed into words, one bit per cell (column j is bit j % 32 of word j / 32), and a generation is
+// computed a whole word at a time: the eight neighbour words are added with bitwise adders, giving each cell's
+// count as four bit planes, and the rule is applied to those. Rules use B/S notation, e.g. "B3/S23" (Conway).
+// Cycles (including still lifes) are found by keeping a hash of each of the last LIFE_HISTORY generations.
+// Like the rest of the library, positions use matrix notation (i = row, j = column).
+class Life {
+
+	public:
+
+		// Board of height x width cells, all dead, following rule (see setRule)
+		Life(uint16_t height, uint16_t width, const char* rule = "B3/S23");
+		~Life(void);
+
+		bool
+			// Set the rule: "B3/S23" or "b36/s23" style, or the older survive/birth "23/3". Returns false (and
+			// leaves the rule alone) if it can't be read.
+			setRule(const char* rule),
+			// Is cell (i,j) alive?
+			get(uint16_t i, uint16_t j),
+			// Has the board come back to one of the last LIFE_HISTORY generations?
+			isSteady(void);
+		void
+			// Kill every cell and forget the history
+			clear(void),
+			// Make cell (i,j) alive or dead
+			set(uint16_t i, uint16_t j, bool alive),
+			// Bring n randomly chosen cells to life (using random(), so seed it first)
+			randomize(uint16_t n),
+			// Advance one generation
+			step(void),
+			// Paint the board onto the wall (as much of it as fits), live cells in colour alive and dead ones in dead
+			draw(Adafruit_WS2801* strip, uint32_t alive, uint32_t dead);
+		uint8_t
+			// Period of the cycle the board is in: 1 for a still life, 2 for a blinker, ..., 0 if none found
+			cycleLength(void);
+		uint16_t
+			h(void),
+			w(void);
+		uint32_t
+			// Number of live cells
+			population(void);
+		unsigned long
+			// Generations since the board was last cleared
+			generation(void);
+
+	private:
+
+		LifeWord
+			west(const LifeWord* r, uint16_t k),
+			east(const LifeWord* r, uint16_t k),
+			mask(uint16_t k);
+		void
+			remember(uint32_t hash);
+
+		uint16_t
+			height,
+			width,
+			words,			// Words per row
+			birth,			// Bit n set: a dead cell with n live neighbours comes alive
+			survive;		// Bit n set: a live cell with n live neighbours stays alive
+		LifeWord
+			*cells,			// Current generation, words per row, row after row
+			*spare;			// Next generation is built here, then the two are swapped
+		uint32_t
+			pop,
+			history[LIFE_HISTORY];
+		uint8_t
+			historyPos,
+			historyUsed,
+			cycle;
+		unsigned long gen;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../Alphanumeric/Alphanumeric.h"
+#include "Marquee.h"
+
+/**********************************************************************************/
+
+Marquee::Marquee(Adafruit_WS2801* board, const char* t, int16_t y, uint32_t c, uint32_t b, uint16_t p) {
+	strip = board;
+	yOff = y;
+	fg = c;
+	bg = b;
+	period = p;
+	lastStep = millis();
+	setText(t);
+}
+
+Marquee::~Marquee(void) {}
+
+void Marquee::setText(const char* t) {
+	text = t;
+	cycle = Alphanumeric::textWidth(text) + (*strip).w();
+	// Start with the text just off the right edge
+	offset = Alphanumeric::textWidth(text);
+}
+
+void Marquee::setColours(uint32_t c, uint32_t b) {
+	fg = c;
+	bg = b;
+}
+
+void Marquee::setPeriod(uint16_t p) {
+	period = p;
+}
+
+void Marquee::scroll(uint16_t n) {
+	offset = (offset + n) % cycle;
+}
+
+// Paint one column of the band: set rows in the text colour, the rest in the background colour
+void Marquee::drawColumn(int16_t x, uint8_t bits) {
+	uint8_t i;
+	for (i = 0; i < FONT3X5_HEIGHT; i++, bits >>= 1) {
+		if (yOff + i >= 0)
+			(*strip).spc(yOff + i, x, (bits & 1) ? fg : bg);
+	}
+}
+
+void Marquee::draw(void) {
+	const char* p;
+	uint8_t j, width;
+	int16_t x = -(int16_t)offset; // Where the first column of the text is, this pass
+
+	// The pattern (text, then a wall's width of blank columns) repeats every cycle columns; walk it until
+	// the wall is covered, drawing only the columns that land on it.
+	while (x < (*strip).w()) {
+		for (p = text; *p && x < (*strip).w(); p++) {
+			width = font3x5Width(*p) + FONT3X5_SPACING;
+			if (x + width <= 0) {
+				x += width;
+				continue;
+			}
+			for (j = 0; j < width; j++, x++) {
+				if (x >= 0 && x < (*strip).w()) drawColumn(x, font3x5Column(*p, j));
+			}
+		}
+		for (j = 0; j < (*strip).w() && x < (*strip).w(); j++, x++) {
+			if (x >= 0) drawColumn(x, 0);
+		}
+	}
+}
+
+bool Marquee::update(unsigned long now) {
+	if (now - lastStep < period) return false;
+	lastStep = now;
+	scroll(1);
+	draw();
+	(*strip).show();
+	return true;
+}
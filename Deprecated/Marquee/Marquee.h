@@ -0,0 +1,60 @@
+#ifndef __MARQUEE_H_INCLUDED__
+#define __MARQUEE_H_INCLUDED__
+
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../Alphanumeric/Font3x5.h"
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Scrolling text ticker. Text moves right to left across a 5-row band of the wall, one column at a time, and
+// comes back in from the right once it has scrolled off completely. Columns are read straight from the font
+// table as they are drawn, so nothing is allocated however long the text is.
+// Call update(millis()) from loop(); it never blocks.
+class Marquee {
+
+	public:
+
+		// Ticker for text (not copied, so it must stay valid) on rows yOff .. yOff+4, in colour c over background
+		// bg, moving one column every period milliseconds.
+		Marquee(Adafruit_WS2801* board, const char* text, int16_t yOff, uint32_t c, uint32_t bg = 0, uint16_t period = 100);
+		~Marquee(void);
+
+		void
+			// Change the text; scrolling restarts from the right edge
+			setText(const char* text),
+			// Change the text and background colours
+			setColours(uint32_t c, uint32_t bg),
+			// Change the scrolling speed
+			setPeriod(uint16_t period),
+			// Move the text left by n columns (without drawing)
+			scroll(uint16_t n),
+			// Draw the band in its current position
+			draw(void);
+		bool
+			// Scroll if period milliseconds have passed since the last step, then draw and show.
+			// Returns true if a new frame was shown.
+			update(unsigned long now);
+
+	private:
+
+		void
+			drawColumn(int16_t x, uint8_t bits);
+
+		Adafruit_WS2801* strip;
+		const char* text;
+		int16_t yOff;
+		uint32_t
+			fg,
+			bg;
+		uint16_t
+			period,
+			offset,		// Columns scrolled so far, modulo cycle
+			cycle;		// Text width plus the wall width of blank columns
+		unsigned long lastStep;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "Scheduler.h"
+#include <stdlib.h>
+
+/**********************************************************************************/
+
+Effect::Effect(uint16_t p) {
+	period = p;
+	done = started = false;
+}
+
+Effect::~Effect(void) {}
+
+void Effect::reset(void) {}
+
+void Effect::setPeriod(uint16_t p) {
+	period = p;
+}
+
+uint16_t Effect::getPeriod(void) {
+	return period;
+}
+
+void Effect::restart(void) {
+	done = started = false;
+}
+
+bool Effect::isDone(void) {
+	return done;
+}
+
+/**********************************************************************************/
+
+Scheduler::Scheduler(Adafruit_WS2801* board, uint8_t maxEffects, uint16_t p) {
+	strip = board;
+	count = 0;
+	capacity = maxEffects;
+	entries = (Entry*) calloc(capacity, sizeof(Entry));
+	if (entries == NULL) {
+		capacity = 0;
+	}
+	framePeriod = p;
+	lastFrame = millis() - p; // First update() runs a frame straight away
+	dropped = 0;
+}
+
+Scheduler::~Scheduler(void) {
+	free(entries);
+}
+
+uint8_t Scheduler::numEffects(void) {
+	return count;
+}
+
+unsigned long Scheduler::droppedSteps(void) {
+	return dropped;
+}
+
+void Scheduler::setFramePeriod(uint16_t p) {
+	framePeriod = p;
+}
+
+int Scheduler::find(Effect* e) {
+	int k;
+	for (k = 0; k < count; k++) {
+		if (entries[k].e == e) return k;
+	}
+	return -1;
+}
+
+bool Scheduler::add(Effect* e, uint16_t budget) {
+	if (count >= capacity || find(e) >= 0) return false;
+	Entry& en = entries[count++];
+	en.e = e;
+	en.budget = budget;
+	return true;
+}
+
+void Scheduler::remove(Effect* e) {
+	int k = find(e);
+	if (k < 0) return;
+	for (; k < count - 1; k++) {
+		entries[k] = entries[k + 1];
+	}
+	count--;
+}
+
+bool Scheduler::update(unsigned long now) {
+	int k;
+	unsigned long start;
+
+	if (now - lastFrame < framePeriod) return false;
+	lastFrame = now;
+
+	for (k = 0; k < count; k++) {
+		Entry& en = entries[k];
+		Effect& e = *en.e;
+		if (!e.started) {
+			e.reset();
+			e.started = true;
+			e.done = false;
+			en.next = now;
+		}
+		if (e.done) continue;
+		if (e.period == 0) {
+			e.done = !e.step(now);
+			continue;
+		}
+		// Catch up on the steps due since the last frame, while the budget lasts
+		start = micros();
+		while ((long)(now - en.next) >= 0) {
+			if (!e.step(en.next)) {
+				e.done = true;
+				break;
+			}
+			en.next += e.period;
+			if (micros() - start >= en.budget) break;
+		}
+		// Out of time: give up on the rest rather than fall further behind
+		if (!e.done && (long)(now - en.next) >= 0) {
+			dropped += (now - en.next) / e.period + 1;
+			en.next = now + e.period;
+		}
+	}
+	(*strip).show();
+	return true;
+}
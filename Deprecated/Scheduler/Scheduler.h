@@ -0,0 +1,104 @@
+#ifndef __SCHEDULER_H_INCLUDED__
+#define __SCHEDULER_H_INCLUDED__
+
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// One animation (or any other periodic job, e.g. reading a button) that a Scheduler runs a step at a time.
+// Subclasses keep whatever state they need as ordinary members and do one short, non-blocking step per call.
+class Effect {
+
+	public:
+
+		// Effect that wants a step every period milliseconds (0 = once per frame)
+		Effect(uint16_t period = 0);
+		virtual ~Effect(void);
+
+		virtual void
+			// Put the effect back at its start. Called before the first step.
+			reset(void);
+		virtual bool
+			// Do one step; now is the time it was due. Return false once the effect has finished.
+			step(unsigned long now) = 0;
+
+		void
+			// Change how often step() is wanted
+			setPeriod(uint16_t p),
+			// Start again from the beginning (even if finished)
+			restart(void);
+		uint16_t
+			getPeriod(void);
+		bool
+			// True once step() has returned false
+			isDone(void);
+
+	private:
+
+		friend class Scheduler;
+
+		uint16_t period;
+		bool
+			done,
+			started;
+};
+
+// Runs several effects together from loop() at a steady frame rate, without blocking.
+// Every frame, each effect is given the steps that have fallen due since the last frame (so it moves at the same
+// speed whatever the frame rate), but only as many as fit in its time budget; if it still falls behind, the
+// missed steps are dropped rather than making the next frame late too. After the effects run, the strip is shown
+// (which, with dirty tracking, sends nothing if nothing changed).
+class Scheduler {
+
+	public:
+
+		// Scheduler for board with room for maxEffects effects, drawing a frame every framePeriod milliseconds
+		Scheduler(Adafruit_WS2801* board, uint8_t maxEffects, uint16_t framePeriod = 20);
+		// Release memory (the effects themselves belong to the caller)
+		~Scheduler(void);
+
+		bool
+			// Add an effect, run after those already added. budget is the most time, in microseconds, it may take
+			// per frame (it always gets at least one step when one is due). Returns false if the scheduler is full.
+			add(Effect* e, uint16_t budget = 2000),
+			// Run a frame if one is due at time now (usually millis()). Returns true if a frame was run.
+			update(unsigned long now);
+		void
+			// Stop running an effect
+			remove(Effect* e),
+			// Change the frame rate
+			setFramePeriod(uint16_t p);
+		uint8_t
+			// Number of effects (finished ones included)
+			numEffects(void);
+		unsigned long
+			// Steps dropped so far because an effect ran out of budget
+			droppedSteps(void);
+
+	private:
+
+		struct Entry {
+			Effect* e;
+			unsigned long next;		// When its next step is due
+			uint16_t budget;		// Microseconds per frame
+		};
+
+		int
+			find(Effect* e);
+
+		Adafruit_WS2801* strip;
+		Entry* entries;
+		uint8_t
+			count,
+			capacity;
+		uint16_t framePeriod;
+		unsigned long
+			lastFrame,
+			dropped;
+};
+
+#endif
@@ -1,6 +1,5 @@
 #include "../Adafruit_WS2801/Adafruit_WS2801.h"
 #include "Shapes.h"
-#include <math.h>
 /**********************************************************************************/
 
 Shapes::Shapes(Adafruit_WS2801* board) {
@@ -9,104 +8,135 @@ Shapes::Shapes(Adafruit_WS2801* board) {
 
 Shapes::~Shapes(void) {}
 
-// rounds a number. >=x.5 rounds up, <x.5 rounds down.
-int Shapes::round1(float n) {
-	return (int) floor(n + 0.5);
+// sets pixel (i,j) if it is on the wall
+void Shapes::plot(int16_t i, int16_t j, uint32_t c) {
+	if (i >= 0 && i < (*strip).h() && j >= 0 && j < (*strip).w())
+		(*strip).spc(i, j, c);
 }
 
-// returns minimum of two numbers
-int Shapes::min2(int n1, int n2) {
-	if (n1 > n2) 
-		return (float) n2;
-	else
-		return (float) n1;
+// draws rows i1..i2 of column j, clipped to the wall
+void Shapes::column(int16_t j, int16_t i1, int16_t i2, uint32_t c) {
+	if (i1 > i2) { int16_t t = i1; i1 = i2; i2 = t; }
+	if (j < 0 || j >= (*strip).w()) return;
+	if (i1 < 0) i1 = 0;
+	if (i2 >= (*strip).h()) i2 = (*strip).h() - 1;
+	for (; i1 <= i2; i1++) {
+		(*strip).spc(i1, j, c);
+	}
 }
 
-// returns maximum of two numbers
-int Shapes::max2(int n1, int n2) {
-	if (n1 > n2) 
-		return (float) n1;
-	else
-		return (float) n2;
-}
+// draws line from (i1,j1) to (i2,j2) of colour c (Bresenham)
+void Shapes::line(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c) {
+	int16_t di, dj, si, sj, err, start;
 
-// draws line from (x1,y1) to (x2,y2) of colour c
-void Shapes::line(uint8_t i1, uint8_t j1, uint8_t i2, uint8_t j2, uint32_t c) {
-	int i;
-	// if its a vertical line
+	// horizontal and vertical lines
+	if (i1 == i2) {
+		(*strip).fillRow(i1, j1, j2, c);
+		return;
+	}
 	if (j1 == j2) {
-		for (i = min(i1, i2); i <= max(i1,i2); i++) {
-			(*strip).spc(i,j1,c);
+		column(j1, i1, i2, c);
+		return;
+	}
+	// nothing to do if the line's bounding box misses the wall
+	if (max(i1, i2) < 0 || min(i1, i2) >= (*strip).h() || max(j1, j2) < 0 || min(j1, j2) >= (*strip).w()) return;
+
+	di = (i2 > i1) ? i2 - i1 : i1 - i2;
+	dj = (j2 > j1) ? j2 - j1 : j1 - j2;
+	si = (i2 > i1) ? 1 : -1;
+	sj = (j2 > j1) ? 1 : -1;
+
+	if (dj >= di) {
+		// mostly horizontal: one step along j per pixel, and the pixels on each row form a run
+		err = dj / 2;
+		start = j1;
+		while (j1 != j2) {
+			err -= di;
+			if (err < 0) {
+				(*strip).fillRow(i1, start, j1, c);
+				i1 += si;
+				err += dj;
+				start = j1 + sj;
+			}
+			j1 += sj;
 		}
+		(*strip).fillRow(i1, start, j2, c);
 	}
 	else {
-		// We do the following to make sure that for (a1,b1) and (a2,b2) that a1 < a2.
-		// The case x1 = x2 is handled above.
-		float a1 = (float) min2(j1,j2);
-		float a2 = (float) max2(j1,j2);
-		float b1;
-		float b2;
-		if (a1 == j1) {
-			b1 = (float) i1;
-			b2 = (float) i2;
-		}
-		else {
-			b1 = (float) i2;
-			b2 = (float) i1;
-		}
-		
-		float m = (b2 - b1)/(a2 - a1);
-		for (i = (int) a1; i <= (int) a2; i++) {
-			(*strip).spc(round1(m * (i - a1) + b1), i, c);
+		// mostly vertical: one step along i per pixel, so there are no gaps however steep the line
+		err = di / 2;
+		for (;;) {
+			plot(i1, j1, c);
+			if (i1 == i2) break;
+			err -= dj;
+			if (err < 0) {
+				j1 += sj;
+				err += di;
+			}
+			i1 += si;
 		}
 	}
 }
 
-// draws solid rectangle from corner (x1, y1) to corner (x2,y2) of colour c
-void Shapes::rectangleFill(uint8_t j1, uint8_t i1, uint8_t j2, uint8_t i2, uint32_t c) {
-	uint8_t a1 = min2(j1,j2);
-	uint8_t a2 = max2(j1,j2);
-	uint8_t b1 = min2(i1,i2);
-	uint8_t b2 = max2(i1,i2);
-
-	int i;
-	//Rectangle is made by drawing vertical lines along x-axis for a1 to a2
-	for (i = a1; i <= a2; i++) {
-		line(b1,i,b2,i,c);
-	}
+// draws solid rectangle from corner (i1,j1) to corner (i2,j2) of colour c
+void Shapes::rectangleFill(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c) {
+	(*strip).fillRect(i1, j1, i2, j2, c);
 }
 
-// draws outline of rectangle, from corner (x1, y1) to corner (x2,y2) of colour c
-void Shapes::rectangleOutline(uint8_t i1, uint8_t j1, uint8_t i2, uint8_t j2, uint32_t c) {
-	uint8_t a1 = min2(j1,j2);
-	uint8_t a2 = max2(j1,j2);
-	uint8_t b1 = min2(i1,i2);
-	uint8_t b2 = max2(i1,i2);
-	
-	//left vertical line
-	line(b1,a1,b2,a1,c);
-	//top horizontal line
-	line(b2,a1,b2,a2,c);
-	//right vertical line
-	line(b2,a2,b1,a2,c);
-	//bottom horizontal line
-	line(b2,a2,b2,a1,c);
+// draws outline of rectangle, from corner (i1,j1) to corner (i2,j2) of colour c
+void Shapes::rectangleOutline(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c) {
+	//top and bottom
+	(*strip).fillRow(i1, j1, j2, c);
+	(*strip).fillRow(i2, j1, j2, c);
+	//left and right
+	column(j1, i1, i2, c);
+	column(j2, i1, i2, c);
 }
 
-// draws a disk centered at (x,y) of radius r of colour c
-disk(uint8_t i, uint8_t j, uint8_t r, uint32_t c) {
-	int k;
-	for (k = j-r; k <= j+r; k++) {
-		// draw series of vertical lines to form disk
-		line(i + round1(sqrt(pow(r,2) - pow((k-j),2))), k, i - round1(sqrt(pow(r,2) - pow((k-j),2))), k, c);
+// draws a disk centered at (i,j) of radius r of colour c
+// Walks one octant of the circle as circle() does; each point gives the ends of two pairs of rows.
+void Shapes::disk(int16_t i, int16_t j, uint8_t r, uint32_t c) {
+	int16_t x = r, y = 0, err = 1 - r;
+
+	while (x >= y) {
+		(*strip).fillRow(i + y, j - x, j + x, c);
+		if (y > 0) (*strip).fillRow(i - y, j - x, j + x, c);
+		// rows i+-x are widest at the last y before x steps in (if x == y they were just drawn)
+		if (err >= 0 && x != y) {
+			(*strip).fillRow(i + x, j - y, j + y, c);
+			(*strip).fillRow(i - x, j - y, j + y, c);
+		}
+		y++;
+		if (err < 0) {
+			err += 2 * y + 1;
+		}
+		else {
+			x--;
+			err += 2 * (y - x) + 1;
+		}
 	}
 }
 
-// draws circle centered at (x,y) of radius r of colour c
-void Shapes::circle(uint8_t i, uint8_t j, uint8_t r, uint32_t c) {
-	int k;
-	for (k = j-r; k <= j+r; k++) {
-		(*strip).spc(i + round1(sqrt(pow(r,2) - pow((k-j),2))), k, c);
-		(*strip).spc(i - round1(sqrt(pow(r,2) - pow((k-j),2))), k, c);
+// draws circle centered at (i,j) of radius r of colour c (midpoint algorithm)
+void Shapes::circle(int16_t i, int16_t j, uint8_t r, uint32_t c) {
+	int16_t x = r, y = 0, err = 1 - r;
+
+	while (x >= y) {
+		plot(i + y, j + x, c);
+		plot(i + y, j - x, c);
+		plot(i - y, j + x, c);
+		plot(i - y, j - x, c);
+		plot(i + x, j + y, c);
+		plot(i + x, j - y, c);
+		plot(i - x, j + y, c);
+		plot(i - x, j - y, c);
+		y++;
+		if (err < 0) {
+			err += 2 * y + 1;
+		}
+		else {
+			x--;
+			err += 2 * (y - x) + 1;
+		}
 	}
-}
\ No newline at end of file
+}
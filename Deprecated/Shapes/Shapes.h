@@ -11,6 +11,9 @@
 
 // A class (essentially a library) that draws various shapes to the screen. Unlike Drawable, it will not store the shapes in memory, so they cannot be called on after they are drawn.
 // We are using matrix notation, so its not x,y coordinates, by i,j indices.
+// Everything is drawn with integer arithmetic only (Bresenham lines, midpoint circles), and filled shapes are
+// written a row at a time through the strip's fillRow. Coordinates may lie off the wall: shapes are clipped to it.
+// Line endpoints must be within 16383 of each other in each direction.
 class Shapes {
 	
 	public:
@@ -21,25 +24,22 @@ class Shapes {
 		
 		void
 			// draws line from (i1,j1) to (i2,j2) of colour c
-			line(uint8_t i1, uint8_t j1, uint8_t i2, uint8_t j2, uint32_t c),
+			line(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c),
 			// draws solid rectangle, defined corner (i1,j1) to corner (i2,j2) of colour c
-			rectangleFill(uint8_t i1, uint8_t j1, uint8_t i2, uint8_t j2, uint32_t c),
+			rectangleFill(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c),
 			// draws outline of rectangle, defined corner (i1,j1) to corner (i2,j2) of colour c
-			rectangleOutline(uint8_t i1, uint8_t j1, uint8_t i2, uint8_t j2, uint32_t c),
-			// draws a disk centered at (x,y) and with radius r of colour c
-			disk(uint8_t i, uint8_t j, uint8_t r, uint32_t c),
-			// draws circle centered at (x,y) and with radius r of colour c
-			circle(uint8_t i, uint8_t j, uint8_t r, uint32_t c);
+			rectangleOutline(int16_t i1, int16_t j1, int16_t i2, int16_t j2, uint32_t c),
+			// draws a disk centered at (i,j) and with radius r of colour c
+			disk(int16_t i, int16_t j, uint8_t r, uint32_t c),
+			// draws circle centered at (i,j) and with radius r of colour c
+			circle(int16_t i, int16_t j, uint8_t r, uint32_t c);
 			
 	private:
-		// The following functions have weird names to avoid name clashes
-		int
-			// rounds a number
-			round1(float n),
-			// returns minimum of two numbers
-			min2(int n1, int n2),
-			// returns maximum of two numbers
-			max2(int n1, int n2);
+		void
+			// sets pixel (i,j) if it is on the wall
+			plot(int16_t i, int16_t j, uint32_t c),
+			// draws rows i1..i2 (either order) of column j
+			column(int16_t j, int16_t i1, int16_t i2, uint32_t c);
 			
 		Adafruit_WS2801* strip;
 		
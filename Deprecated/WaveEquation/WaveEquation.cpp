@@ -0,0 +1,120 @@
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#include "WaveEquation.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************************************/
+
+WaveEquation::WaveEquation(uint16_t h, uint16_t w, float k, float dt) {
+	height = h;
+	width = w;
+	// Both levels share one allocation
+	cur = (int16_t*) calloc(2 * (size_t)height * width, sizeof(int16_t));
+	if (cur == NULL || height < 2 || width < 2) {
+		free(cur);
+		cur = NULL;
+		height = width = 0;
+	}
+	old = cur + (size_t)height * width;
+	coef = (uint16_t)(k * dt * dt * w * w * 65536.0 + 0.5);
+}
+
+WaveEquation::~WaveEquation(void) {
+	// cur and old get swapped, so free whichever holds the start of the allocation
+	free(cur < old ? cur : old);
+}
+
+uint16_t WaveEquation::h(void) {
+	return height;
+}
+
+uint16_t WaveEquation::w(void) {
+	return width;
+}
+
+int16_t WaveEquation::get(uint16_t i, uint16_t j) {
+	if (i >= height || j >= width) return 0;
+	return cur[i * width + j];
+}
+
+void WaveEquation::clear(void) {
+	memset(cur, 0, (size_t)height * width * sizeof(int16_t));
+	memset(old, 0, (size_t)height * width * sizeof(int16_t));
+}
+
+void WaveEquation::drop(float ci, float cj, float sharpness, float amplitude) {
+	uint16_t i, j;
+	for (i = 0; i < height; i++) {
+		for (j = 0; j < width; j++) {
+			// Cell (i,j) is at ((i + 1) / height, (j + 1) / width), as in the sketch
+			float u = (float)(i + 1) / height - ci, v = (float)(j + 1) / width - cj;
+			int32_t n = cur[i * width + j] + (int32_t)(amplitude * exp(-sharpness * (u * u + v * v)) * WAVE_ONE + 0.5);
+			if (n > 32767) n = 32767;
+			if (n < -32768) n = -32768;
+			cur[i * width + j] = old[i * width + j] = n;
+		}
+	}
+}
+
+void WaveEquation::step(uint8_t substeps) {
+	uint16_t i, j;
+	int16_t *t;
+	while (substeps--) {
+		for (i = 0; i < height; i++) {
+			// Reflecting edges: the row above the top one is the second one, and so on
+			const int16_t
+				*mid = cur + i * width,
+				*up = cur + (i > 0 ? i - 1 : 1) * width,
+				*down = cur + (i < height - 1 ? i + 1 : height - 2) * width;
+			int16_t *dst = old + i * width;
+			for (j = 0; j < width; j++) {
+				int16_t
+					left = mid[j > 0 ? j - 1 : 1],
+					right = mid[j < width - 1 ? j + 1 : width - 2];
+				int32_t
+					lap = (int32_t)left + right + up[j] + down[j] - 4 * (int32_t)mid[j],
+					n = 2 * (int32_t)mid[j] - dst[j] + ((lap * coef + 0x8000) >> 16);
+				if (n > 32767) n = 32767;
+				if (n < -32768) n = -32768;
+				dst[j] = n;
+			}
+		}
+		t = cur;
+		cur = old;
+		old = t;
+	}
+}
+
+void WaveEquation::draw(Adafruit_WS2801* strip, uint8_t phase) {
+	uint16_t i, j, t;
+	uint8_t neg[3], pos[3], col = phase % 255;
+
+	// The sketch's two colours for the phase: neg for values below zero, pos for the rest
+	if (col < 85) {
+		t = col * 3;
+		neg[0] = t;			neg[1] = 255 - t;	neg[2] = 0;
+		pos[0] = 0;			pos[1] = 255 - t;	pos[2] = t;
+	}
+	else if (col < 170) {
+		t = (col - 85) * 3;
+		neg[0] = 255 - t;	neg[1] = 0;			neg[2] = t;
+		pos[0] = t;			pos[1] = 0;			pos[2] = 255 - t;
+	}
+	else {
+		t = (col - 170) * 3;
+		neg[0] = 0;			neg[1] = t;			neg[2] = 255 - t;
+		pos[0] = 255 - t;	pos[1] = t;			pos[2] = 0;
+	}
+
+	for (i = 0; i < height && i < (*strip).h(); i++) {
+		for (j = 0; j < width && j < (*strip).w(); j++) {
+			int16_t v = cur[i * width + j];
+			const uint8_t* c = v < 0 ? neg : pos;
+			// Brightness |v| / 1.5, as 0..256: |v| * 2/3 in 8.8
+			uint16_t a = v < 0 ? -(int32_t)v : v;
+			uint16_t s = a >= 384 ? 256 : (uint16_t)(((uint32_t)a * 171) >> 8);
+			(*strip).spc(i, j, (uint32_t)((c[0] * s) >> 8) << 16 | (uint32_t)((c[1] * s) >> 8) << 8 | ((c[2] * s) >> 8));
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef __WAVEEQUATION_H_INCLUDED__
+#define __WAVEEQUATION_H_INCLUDED__
+
+#include "../Adafruit_WS2801/Adafruit_WS2801.h"
+#if (ARDUINO >= 100)
+ #include <Arduino.h>
+#else
+ #include <WProgram.h>
+ #include <pins_arduino.h>
+#endif
+
+// Fixed-point value of 1.0 (values are 8.8: 256 = 1.0)
+#define WAVE_ONE 256
+
+// The waveEquation Processing sketch's simulation, run on the board so the host doesn't have to stream it.
+// Values are 8.8 fixed point in 16 bits and the step coefficient is 0.16, so a step is integer adds and one
+// 32-bit multiply per cell. Only the current and previous levels are kept (the new level overwrites the old one in
+// place), and there are no ghost cells: the edges reflect by reading the cell one in from the edge instead.
+// That's 4 bytes per cell, 792 for the 18x11 wall. Host/Sim/WaveField is the same simulation in floating point.
+// Like the rest of the library, positions use matrix notation (i = row, j = column).
+class WaveEquation {
+
+	public:
+
+		// Board of height x width cells, flat and still. k and dt are the sketch's wave speed and time step,
+		// with a grid spacing of 1 / width; k dt^2 width^2 must be under 0.5 or the simulation blows up.
+		WaveEquation(uint16_t height, uint16_t width, float k = 0.1, float dt = 0.05);
+		~WaveEquation(void);
+
+		void
+			// Flatten and still the board
+			clear(void),
+			// Add a still bump amplitude * exp(-sharpness * r^2) centred on (ci, cj), in 0..1 board coordinates
+			// (as the sketch's starting condition, drop(0.5, 0.5, 50, 1))
+			drop(float ci, float cj, float sharpness, float amplitude),
+			// Advance substeps time steps
+			step(uint8_t substeps = 1),
+			// Paint the board onto the wall in the sketch's colours: phase (0-254) picks a pair, one for negative
+			// values and one for positive, shown at a brightness of |value| / 1.5
+			draw(Adafruit_WS2801* strip, uint8_t phase);
+		int16_t
+			// Value of cell (i,j), 8.8 fixed point
+			get(uint16_t i, uint16_t j);
+		uint16_t
+			h(void),
+			w(void);
+
+	private:
+
+		uint16_t
+			height,
+			width,
+			coef;			// k dt^2 / dx^2, 0.16 fixed point
+		int16_t
+			*cur,			// This step, row after row
+			*old;			// The step before; the next step is built over it, then the two are swapped
+};
+
+#endif
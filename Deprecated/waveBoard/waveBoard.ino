@@ -0,0 +1,35 @@
+#include "SPI.h"
+#include "Adafruit_WS2801.h"
+#include "WaveEquation.h"
+
+#define SUBSTEPS 1 // Time steps per frame; more makes the waves move faster
+#define WAIT 20 // delay between frames
+
+int dataPin  = 2;    // Yellow wire on Adafruit Pixels
+int clockPin = 3;    // Green wire on Adafruit Pixels
+
+Adafruit_WS2801 strip = Adafruit_WS2801(200, dataPin, clockPin, WS2801_RGB, 18, 11);
+
+// The waveEquation Processing sketch, run here instead of streamed from the host. Same constants (k = 0.1,
+// dt = 0.05) and the same start: one bump in the middle of the board.
+WaveEquation wave(11, 18);
+
+unsigned long frame = 0;
+
+void setup() {
+
+  strip.begin();
+
+  wave.drop(0.5, 0.5, 50, 1);
+}
+
+void loop() {
+
+  wave.step(SUBSTEPS);
+  // The colours cycle every 510 frames, as in the sketch
+  wave.draw(&strip, (frame / 2) % 255);
+  strip.show();
+  frame++;
+
+  delay(WAIT);
+}
@@ -0,0 +1,63 @@
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+// Host implementations of the Arduino core functions declared in Arduino.h.
+// Time is measured from the first call, like millis()/micros() on a board
+// that has just been reset.
+
+static std::chrono::steady_clock::time_point startTime(void) {
+  static const std::chrono::steady_clock::time_point t0 =
+    std::chrono::steady_clock::now();
+  return t0;
+}
+
+unsigned long millis(void) {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - startTime()).count();
+}
+
+unsigned long micros(void) {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - startTime()).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// There are no pins on the host; these exist so library code links.
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  (void)pin;
+  (void)val;
+}
+
+int analogRead(uint8_t pin) {
+  (void)pin;
+  return 0;
+}
+
+// Same contract as the Arduino core: random(max) is in [0, max),
+// random(min, max) is in [min, max).
+void randomSeed(unsigned long seed) {
+  if(seed != 0) srandom((unsigned int)seed);
+}
+
+long random(long howbig) {
+  if(howbig == 0) return 0;
+  return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if(howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
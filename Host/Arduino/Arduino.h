@@ -0,0 +1,57 @@
+#ifndef __HOST_ARDUINO_INCLUDED__
+#define __HOST_ARDUINO_INCLUDED__
+
+// Minimal stand-in for the Arduino core, so that the LED wall libraries
+// can be compiled and profiled on a Linux host.  Only what the libraries
+// actually use is provided: integer types, timing, pin stubs, random
+// numbers and the PROGMEM accessors.  Anything that touches AVR registers
+// (SPDR, PORTx, ...) is deliberately absent; code that needs it must be
+// guarded with #ifndef LEDWALL_HOST.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH   0x1
+#define LOW    0x0
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define PROGMEM
+#define pgm_read_byte(addr)  (*(const uint8_t  *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+// The Arduino core provides these as macros; templates are used here so
+// they don't clash with the C++ standard library on the host.
+template<class T, class U>
+inline auto min(const T& a, const U& b) -> decltype(a < b ? a : b) {
+  return (a < b) ? a : b;
+}
+
+template<class T, class U>
+inline auto max(const T& a, const U& b) -> decltype(a < b ? b : a) {
+  return (a < b) ? b : a;
+}
+
+void
+  delay(unsigned long ms),
+  delayMicroseconds(unsigned int us),
+  pinMode(uint8_t pin, uint8_t mode),
+  digitalWrite(uint8_t pin, uint8_t val),
+  randomSeed(unsigned long seed);
+unsigned long
+  millis(void),
+  micros(void);
+int
+  analogRead(uint8_t pin);
+long
+  random(long howbig),
+  random(long howsmall, long howbig);
+
+#endif
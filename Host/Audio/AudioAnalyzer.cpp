@@ -0,0 +1,200 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "AudioAnalyzer.h"
+
+RealFFT::RealFFT(uint16_t size) :
+  n(size), m(size / 2), rev(m), twRe(m), twIm(m), re(m), im(m) {
+  int bits = 0;
+  while((1 << bits) < m) bits++;
+  for(uint16_t i = 0; i < m; i++) {
+    uint16_t r = 0;
+    for(int b = 0; b < bits; b++) if(i & (1 << b)) r |= 1 << (bits - 1 - b);
+    rev[i]  = r;
+    twRe[i] = cos(2 * M_PI * i / n);
+    twIm[i] = -sin(2 * M_PI * i / n);
+  }
+}
+
+void RealFFT::magnitudes(const float *x, float *mag) {
+  // Pack even samples as real parts, odd as imaginary, in bit-reversed
+  // order, then an in-place radix-2 FFT of the m complex values
+  for(uint16_t i = 0; i < m; i++) {
+    re[rev[i]] = x[2 * i];
+    im[rev[i]] = x[2 * i + 1];
+  }
+  for(uint16_t len = 2; len <= m; len <<= 1) {
+    uint16_t half = len / 2, step = n / len;
+    for(uint16_t i = 0; i < m; i += len) {
+      for(uint16_t j = 0; j < half; j++) {
+        float    wr = twRe[j * step], wi = twIm[j * step];
+        uint16_t a  = i + j, b = a + half;
+        float    tr = re[b] * wr - im[b] * wi, ti = re[b] * wi + im[b] * wr;
+        re[b]  = re[a] - tr;
+        im[b]  = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+  // Split into the spectra of the even and odd samples, and combine:
+  // X[k] = E[k] + exp(-2 pi i k / n) O[k]
+  for(uint16_t k = 0; k <= m; k++) {
+    uint16_t a  = k % m, b = (m - k) % m;
+    float    er = (re[a] + re[b]) * 0.5f, ei = (im[a] - im[b]) * 0.5f;
+    float    or_ = (im[a] + im[b]) * 0.5f, oi = (re[b] - re[a]) * 0.5f;
+    float    wr = (k < m) ? twRe[k] : -1.0f, wi = (k < m) ? twIm[k] : 0.0f;
+    float    xr = er + or_ * wr - oi * wi, xi = ei + or_ * wi + oi * wr;
+    mag[k] = sqrtf(xr * xr + xi * xi);
+  }
+}
+
+/*****************************************************************************/
+
+AudioAnalyzer::AudioAnalyzer(uint32_t sampleRate, uint16_t bands, uint16_t fftSize,
+  float minHz, float maxHz) :
+  rate(sampleRate), fft(fftSize), window(fftSize), hann(fftSize),
+  windowed(fftSize), mag(fftSize / 2 + 1), logMag(fftSize / 2 + 1),
+  prevLog(fftSize / 2 + 1, 0), prevMag(fftSize / 2 + 1, 0), filled(0), samples(0), count(0),
+  sensitivity(2.0f) {
+  const float binHz = (float)rate / fftSize;
+  const int   bins  = fftSize / 2;
+
+  for(int k = 0; k < fftSize; k++) hann[k] = 0.5f - 0.5f * cos(2 * M_PI * k / fftSize);
+  if(bands > AUDIO_MAX_BANDS) bands = AUDIO_MAX_BANDS;
+  if(maxHz > rate / 2) maxHz = rate / 2;
+
+  // Log-spaced band edges.  Bands narrower than a bin at the bottom end
+  // share that bin, so every column shows something.
+  for(int b = 0; b < bands; b++) {
+    float lo = minHz * powf(maxHz / minHz, (float)b / bands),
+          hi = minHz * powf(maxHz / minHz, (float)(b + 1) / bands);
+    int   l  = (int)(lo / binHz + 0.5f), h = (int)(hi / binHz + 0.5f);
+    if(l < 1)    l = 1;
+    if(l > bins) l = bins;
+    if(h <= l)   h = l + 1;
+    if(h > bins + 1) h = bins + 1;
+    bandLo.push_back(l);
+    bandHi.push_back(h);
+  }
+  kickBins = (uint16_t)(150.0f / binHz) + 1;
+  if(kickBins < 2) kickBins = 2;
+
+  memset(&frame, 0, sizeof(frame));
+  frame.numBands = bands;
+  onsets.history.assign(43, 0); // About half a second of flux at 44.1 kHz
+  onsets.floor = 2.0f;
+  kicks.history.assign(43, 0);
+  kicks.floor  = 0.05f;
+}
+
+// Onset when flux stands well above its recent median (so one loud hit
+// doesn't mask the quieter ones after it), and the last onset was long
+// enough ago.
+bool AudioAnalyzer::Detector::detect(float flux, uint32_t f, float sensitivity,
+  uint32_t refractory) {
+  sorted = history;
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  float median = sorted[sorted.size() / 2];
+  history[next] = flux;
+  next = (next + 1) % history.size();
+
+  if((flux > median * sensitivity + floor) &&
+     ((lastOnset == 0) || (f - lastOnset >= refractory))) {
+    lastOnset = f;
+    return true;
+  }
+  return false;
+}
+
+void AudioAnalyzer::analyse(void) {
+  const int   bins  = fft.size() / 2;
+  const float scale = 4.0f / fft.size(); // Hann window gain, and both halves
+  float       sum   = 0, flux = 0, kickFlux = 0;
+
+  for(size_t k = 0; k < window.size(); k++) {
+    windowed[k] = window[k] * hann[k];
+    sum        += window[k] * window[k];
+  }
+  fft.magnitudes(&windowed[0], &mag[0]);
+
+  // Flux: how much each bin rose since the last frame, on a log scale so
+  // quiet and loud passages count alike.  Kicks go by the plain magnitude
+  // instead, or the little a hi-hat leaks into the bass would count too.
+  for(int k = 0; k <= bins; k++) {
+    mag[k]   *= scale;
+    logMag[k] = logf(1.0f + 1000.0f * mag[k]);
+    float d   = logMag[k] - prevLog[k];
+    if((k > 0) && (d > 0)) flux += d;
+    if((k > 0) && (k < kickBins) && (mag[k] > prevMag[k])) kickFlux += mag[k] - prevMag[k];
+    prevMag[k] = mag[k];
+  }
+  prevLog.swap(logMag);
+
+  for(int b = 0; b < frame.numBands; b++) {
+    float peak = 0;
+    for(int k = bandLo[b]; k < bandHi[b]; k++) if(mag[k] > peak) peak = mag[k];
+    frame.bands[b] = peak;
+  }
+
+  uint32_t refractory = (uint32_t)(0.15f * rate / hop()) + 1; // 150 ms
+  frame.sample   = samples;
+  frame.level    = sqrtf(sum / window.size());
+  frame.flux     = flux;
+  frame.sequence = count++;
+  frame.onset    = onsets.detect(flux, count, sensitivity, refractory);
+  frame.kick     = kicks.detect(kickFlux, count, sensitivity, refractory);
+}
+
+/*****************************************************************************/
+
+AudioEngine::AudioEngine(AudioAnalyzer &a) :
+  analyzer(a), stopping(false), busy(false), dropped(0) {
+}
+
+AudioEngine::~AudioEngine(void) {
+  stop();
+}
+
+bool AudioEngine::start(WavReader &wav, bool realtime) {
+  if(busy || (wav.sampleRate() != analyzer.sampleRate())) return false;
+  if(worker.joinable()) worker.join();
+  stopping = false;
+  busy     = true;
+  worker   = std::thread(&AudioEngine::run, this, &wav, realtime);
+  return true;
+}
+
+void AudioEngine::stop(void) {
+  stopping = true;
+  if(worker.joinable()) worker.join();
+}
+
+void AudioEngine::run(WavReader *wav, bool realtime) {
+  typedef std::chrono::steady_clock clock;
+  std::vector<float> block(analyzer.hop());
+  clock::time_point  start = clock::now();
+  uint64_t           done  = 0;
+  size_t             n;
+
+  while(!stopping && ((n = wav->read(&block[0], block.size())) > 0)) {
+    analyzer.feed(&block[0], n, [&](const AudioFrame &f) {
+      // In real time a stalled renderer loses frames; flat out, there's
+      // no hurry, so wait for it instead
+      while(!ring.push(f)) {
+        if(realtime || stopping) {
+          dropped++;
+          break;
+        }
+        std::this_thread::yield();
+      }
+    });
+    done += n;
+    if(realtime) {
+      std::this_thread::sleep_until(start +
+        std::chrono::microseconds(done * 1000000 / analyzer.sampleRate()));
+    }
+  }
+  busy = false;
+}
@@ -0,0 +1,146 @@
+// Native audio analysis for the music sketches (equalizer, pulse,
+// pulseWaveWaveform), which run Minim's FFT and BeatDetect inside draw()
+// so that analysis and drawing hold each other up.
+//
+// AudioAnalyzer turns a stream of samples into AudioFrames: one per hop
+// (half a window), holding the level, one value per wall column from
+// log-spaced frequency bands, and onset/kick flags from spectral flux.
+// AudioEngine runs it on its own thread, reading a WAV file (in real
+// time, or as fast as possible), and hands the frames to the renderer
+// through a lock-free ring: drawing never waits for analysis, nor the
+// other way round.
+
+#ifndef LEDWALL_AUDIOANALYZER_H
+#define LEDWALL_AUDIOANALYZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "SpscRing.h"
+#include "WavReader.h"
+
+#define AUDIO_MAX_BANDS 64
+
+// FFT of n real samples (n a power of two, 4 or more), done as an n/2
+// point complex FFT plus a final split pass.
+class RealFFT {
+ public:
+  RealFFT(uint16_t n);
+
+  uint16_t size(void) const { return n; }
+  // Magnitudes of bins 0 to n/2 (n/2 + 1 values) of x[0..n-1]
+  void     magnitudes(const float *x, float *mag);
+
+ private:
+  uint16_t              n, m;
+  std::vector<uint16_t> rev;          // Bit reversal, m entries
+  std::vector<float>    twRe, twIm;   // exp(-2 pi i k / n), k < m
+  std::vector<float>    re, im;
+};
+
+struct AudioFrame {
+  uint32_t sequence;               // Counts frames from 0
+  uint64_t sample;                 // Samples in up to the end of the window
+  float    level;                  // RMS of the window
+  uint16_t numBands;
+  float    bands[AUDIO_MAX_BANDS]; // Peak amplitude per band; a full-scale
+                                   // sine reads about 1.0
+  float    flux;                   // Spectral flux (how much louder it got)
+  bool     onset;                  // Something new started
+  bool     kick;                   // Same, in the bass
+};
+
+class AudioAnalyzer {
+ public:
+  // bands (up to AUDIO_MAX_BANDS) log-spaced from minHz to maxHz; usually
+  // the wall's width
+  AudioAnalyzer(uint32_t sampleRate, uint16_t bands, uint16_t fftSize = 1024,
+    float minHz = 40, float maxHz = 16000);
+
+  uint32_t sampleRate(void) const { return rate; }
+  uint16_t hop(void) const        { return fft.size() / 2; }
+  // Threshold for onsets, as a multiple of the median flux of the last
+  // half second (higher = fewer onsets)
+  void     setSensitivity(float s) { sensitivity = s; }
+
+  // Takes n more samples, calling emit(const AudioFrame &) for each frame
+  // completed.
+  template<class F>
+  void feed(const float *in, size_t n, F emit) {
+    while(n > 0) {
+      size_t take = window.size() - filled;
+      if(take > n) take = n;
+      for(size_t k = 0; k < take; k++) window[filled + k] = in[k];
+      filled += take;
+      in     += take;
+      n      -= take;
+      samples += take;
+      if(filled == window.size()) {
+        analyse();
+        emit(frame);
+        // Slide on by a hop
+        for(size_t k = hop(); k < window.size(); k++) window[k - hop()] = window[k];
+        filled -= hop();
+      }
+    }
+  }
+
+ private:
+  struct Detector {
+    std::vector<float> history;       // Recent flux values
+    std::vector<float> sorted;
+    size_t             next;
+    uint32_t           lastOnset;
+    float              floor;           // Least flux that counts, in silence
+    Detector() : next(0), lastOnset(0), floor(0) {}
+    bool detect(float flux, uint32_t frame, float sensitivity, uint32_t refractory);
+  };
+
+  void analyse(void);
+
+  uint32_t              rate;
+  RealFFT               fft;
+  std::vector<float>    window, hann, windowed, mag, logMag, prevLog, prevMag;
+  std::vector<uint16_t> bandLo, bandHi;   // Bin range of each band
+  uint16_t              kickBins;         // Bins below 150 Hz
+  size_t                filled;
+  uint64_t              samples;
+  uint32_t              count;            // Frames so far
+  float                 sensitivity;
+  Detector              onsets, kicks;
+  AudioFrame            frame;
+};
+
+class AudioEngine {
+ public:
+  AudioEngine(AudioAnalyzer &a);
+  ~AudioEngine(void);
+
+  // Analyses wav on a new thread; realtime paces it to the audio clock
+  // (as if it were playing), else it runs flat out, but never further
+  // ahead of the renderer than the ring holds.
+  bool start(WavReader &wav, bool realtime = true);
+  void stop(void);
+  // False once the file has been analysed to the end
+  bool running(void) const { return busy; }
+
+  // Renderer side: the next frame in order, or skip to the newest
+  bool next(AudioFrame &f)   { return ring.pop(f); }
+  bool latest(AudioFrame &f) { return ring.latest(f); }
+  // Frames dropped because the renderer fell 64 frames behind (in real
+  // time)
+  unsigned long overruns(void) const { return dropped; }
+
+ private:
+  void run(WavReader *wav, bool realtime);
+
+  AudioAnalyzer             &analyzer;
+  SpscRing<AudioFrame, 64>   ring;
+  std::thread                worker;
+  std::atomic<bool>          stopping, busy;
+  std::atomic<unsigned long> dropped;
+};
+
+#endif
@@ -0,0 +1,56 @@
+// Fixed-size ring for handing items from one thread to one other without
+// locks: the producer only ever moves head, the consumer only tail.  A
+// full ring refuses new items (the producer decides what to drop), so
+// neither side ever waits on the other.
+
+#ifndef LEDWALL_SPSCRING_H
+#define LEDWALL_SPSCRING_H
+
+#include <stddef.h>
+#include <atomic>
+
+template<class T, size_t Size>
+class SpscRing {
+
+  static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+ public:
+  SpscRing() : head(0), tail(0) {}
+
+  // Producer: false (and nothing stored) if full
+  bool push(const T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if(h - tail.load(std::memory_order_acquire) == Size) return false;
+    slots[h & (Size - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: false if empty
+  bool pop(T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if(head.load(std::memory_order_acquire) == t) return false;
+    item = slots[t & (Size - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: skips to the newest item; false if empty
+  bool latest(T &item) {
+    if(!pop(item)) return false;
+    while(pop(item));
+    return true;
+  }
+
+  size_t size(void) const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  // Each index on its own cache line, so the two threads don't contend
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+  T slots[Size];
+};
+
+#endif
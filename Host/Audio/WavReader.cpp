@@ -0,0 +1,129 @@
+#include <string.h>
+#include "WavReader.h"
+
+#define WAVE_PCM        1
+#define WAVE_FLOAT      3
+#define WAVE_EXTENSIBLE 0xfffe
+
+static uint32_t le32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t le16(const uint8_t *p) {
+  return p[0] | p[1] << 8;
+}
+
+WavReader::WavReader(void) :
+  file(NULL), rate(0), numChannels(0), bits(0), format(0),
+  totalFrames(0), framesLeft(0) {
+}
+
+WavReader::~WavReader(void) {
+  close();
+}
+
+void WavReader::close(void) {
+  if(file != NULL) fclose(file);
+  file = NULL;
+}
+
+bool WavReader::open(const char *path) {
+  uint8_t  h[12], c[8], fmt[40];
+  uint32_t size;
+  bool     haveFormat = false;
+
+  close();
+  if((file = fopen(path, "rb")) == NULL) return false;
+  if((fread(h, 1, 12, file) != 12) || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4)) {
+    close();
+    return false;
+  }
+  // Walk the chunks up to 'data'; 'fmt ' must come first
+  while(fread(c, 1, 8, file) == 8) {
+    size = le32(c + 4);
+    if(!memcmp(c, "fmt ", 4) && (size >= 16)) {
+      if(fread(fmt, 1, (size < sizeof(fmt)) ? size : sizeof(fmt), file) < 16) break;
+      if(size > sizeof(fmt)) fseek(file, size - sizeof(fmt), SEEK_CUR);
+      format      = le16(fmt);
+      numChannels = le16(fmt + 2);
+      rate        = le32(fmt + 4);
+      bits        = le16(fmt + 14);
+      if((format == WAVE_EXTENSIBLE) && (size >= 26)) format = le16(fmt + 24);
+      haveFormat  = true;
+    } else if(!memcmp(c, "data", 4) && haveFormat) {
+      bool ok = numChannels && rate &&
+        (((format == WAVE_PCM) && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) ||
+         ((format == WAVE_FLOAT) && (bits == 32)));
+      if(!ok) break;
+      totalFrames = framesLeft = size / (numChannels * (bits / 8));
+      return true;
+    } else {
+      fseek(file, size + (size & 1), SEEK_CUR); // Chunks are word-aligned
+    }
+  }
+  close();
+  return false;
+}
+
+size_t WavReader::read(float *out, size_t n) {
+  const size_t bytes = bits / 8, frame = bytes * numChannels;
+
+  if((file == NULL) || (framesLeft == 0)) return 0;
+  if(n > framesLeft) n = framesLeft;
+  raw.resize(n * frame);
+  n = fread(&raw[0], frame, n, file);
+  framesLeft -= n;
+
+  for(size_t i = 0; i < n; i++) {
+    const uint8_t *p   = &raw[i * frame];
+    float          sum = 0;
+    for(uint16_t ch = 0; ch < numChannels; ch++, p += bytes) {
+      switch(bits) {
+       case 8:  sum += (p[0] - 128) / 128.0f;       break;
+       case 16: sum += (int16_t)le16(p) / 32768.0f; break;
+       case 24: sum += (int32_t)(p[0] << 8 | p[1] << 16 | (uint32_t)p[2] << 24) / 2147483648.0f; break;
+       case 32:
+        if(format == WAVE_FLOAT) {
+          float f;
+          uint32_t u = le32(p);
+          memcpy(&f, &u, 4);
+          sum += f;
+        } else {
+          sum += (int32_t)le32(p) / 2147483648.0f;
+        }
+        break;
+      }
+    }
+    out[i] = sum / numChannels;
+  }
+  return n;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  for(int k = 0; k < 4; k++) p[k] = v >> (8 * k);
+}
+
+bool writeWav(const char *path, const float *samples, size_t n, uint32_t rate) {
+  FILE   *f = fopen(path, "wb");
+  uint8_t h[44];
+
+  if(f == NULL) return false;
+  memcpy(h, "RIFF", 4);
+  put32(h + 4, 36 + n * 2);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put32(h + 16, 16);             // Format chunk size
+  put32(h + 20, 0x00010001);     // PCM, 1 channel
+  put32(h + 24, rate);
+  put32(h + 28, rate * 2);       // Bytes per second
+  put32(h + 32, 0x00100002);     // 2 bytes per frame, 16 bits
+  memcpy(h + 36, "data", 4);
+  put32(h + 40, n * 2);
+  bool ok = fwrite(h, 1, 44, f) == 44;
+  for(size_t i = 0; ok && (i < n); i++) {
+    float   s = samples[i] * 32767.0f;
+    int16_t q = (s > 32767.0f) ? 32767 : (s < -32768.0f) ? -32768 : (int16_t)s;
+    uint8_t b[2] = { (uint8_t)q, (uint8_t)(q >> 8) };
+    ok = fwrite(b, 1, 2, f) == 2;
+  }
+  return (fclose(f) == 0) && ok;
+}
@@ -0,0 +1,41 @@
+// Reads PCM WAV files (8, 16, 24 or 32-bit integer, or 32-bit float, any
+// number of channels) as mono float samples in -1..1, for running the
+// audio analysis without a sound card.
+
+#ifndef LEDWALL_WAVREADER_H
+#define LEDWALL_WAVREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+class WavReader {
+ public:
+  WavReader(void);
+  ~WavReader(void);
+
+  // False if the file can't be read or isn't a supported WAV
+  bool open(const char *path);
+  void close(void);
+
+  uint32_t sampleRate(void) const { return rate; }
+  uint16_t channels(void) const   { return numChannels; }
+  uint64_t frames(void) const     { return totalFrames; }
+
+  // Up to n mono samples (channels mixed down) into out; returns how many,
+  // 0 at the end.
+  size_t read(float *out, size_t n);
+
+ private:
+  FILE                *file;
+  uint32_t             rate;
+  uint16_t             numChannels, bits, format;
+  uint64_t             totalFrames, framesLeft;
+  std::vector<uint8_t> raw;
+};
+
+// Writes 16-bit mono PCM; for tests.  False if it can't.
+bool writeWav(const char *path, const float *samples, size_t n, uint32_t rate);
+
+#endif
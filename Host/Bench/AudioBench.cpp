@@ -0,0 +1,164 @@
+// Host benchmark for the audio analysis engine.  Checks the FFT against a
+// plain DFT and the bands against test tones, then analyses a synthetic
+// WAV file (bass kicks, hi-hats and a tone underneath) through the
+// AudioEngine thread and ring, and checks the kicks and onsets found
+// against where they were put.  Reports FFTs/sec and how many times
+// faster than real time the analysis runs.
+//
+// Usage: audiobench [seconds per case]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "../Audio/AudioAnalyzer.h"
+#include "Bench.h"
+
+static const uint32_t RATE = 44100;
+static const uint16_t SIZE = 1024, BANDS = 18;
+
+static bool checkFFT(void) {
+  std::vector<float> x(SIZE), mag(SIZE / 2 + 1);
+  RealFFT            fft(SIZE);
+  double             worst = 0, peak = 0;
+
+  for(int k = 0; k < SIZE; k++) x[k] = (rand() / (float)RAND_MAX) * 2 - 1;
+  fft.magnitudes(&x[0], &mag[0]);
+  for(int k = 0; k <= SIZE / 2; k++) {
+    double re = 0, im = 0;
+    for(int t = 0; t < SIZE; t++) {
+      re += x[t] * cos(2 * M_PI * k * t / SIZE);
+      im -= x[t] * sin(2 * M_PI * k * t / SIZE);
+    }
+    double m = sqrt(re * re + im * im);
+    if(fabs(m - mag[k]) > worst) worst = fabs(m - mag[k]);
+    if(m > peak) peak = m;
+  }
+  printf("%-34s largest error %.2e of %.1f\n", "RealFFT vs DFT", worst, peak);
+  return worst < 1e-4 * peak;
+}
+
+// A tone should light the band its frequency falls in, at its amplitude.
+static bool checkBands(void) {
+  static const float tones[] = { 60, 250, 1000, 4000, 12000 };
+  bool ok = true;
+
+  for(size_t t = 0; t < sizeof(tones) / sizeof(tones[0]); t++) {
+    AudioAnalyzer      a(RATE, BANDS, SIZE);
+    std::vector<float> s(SIZE * 4);
+    AudioFrame         last;
+    for(size_t k = 0; k < s.size(); k++) s[k] = 0.5f * sin(2 * M_PI * tones[t] * k / RATE);
+    a.feed(&s[0], s.size(), [&](const AudioFrame &f) { last = f; });
+
+    int   want = (int)(BANDS * log(tones[t] / 40.0) / log(16000 / 40.0)), best = 0;
+    for(int b = 1; b < last.numBands; b++) if(last.bands[b] > last.bands[best]) best = b;
+    bool  good = (abs(best - want) <= 1) && (fabs(last.bands[best] - 0.5f) < 0.1f);
+    printf("%5.0f Hz tone: band %2d (expected %2d), amplitude %.2f%s\n",
+      tones[t], best, want, last.bands[best], good ? "" : "  <--");
+    ok = ok && good;
+  }
+  return ok;
+}
+
+static bool checkStream(void) {
+  const float        seconds = 10;
+  std::vector<float> s((size_t)(seconds * RATE));
+  std::vector<float> kicks, hats;
+
+  // A kick every half second, a hi-hat between them, a tone throughout
+  for(size_t k = 0; k < s.size(); k++) s[k] = 0.05f * sin(2 * M_PI * 440 * k / RATE);
+  for(float t = 0.25f; t < seconds - 0.5f; t += 0.5f) {
+    size_t at = (size_t)(t * RATE);
+    kicks.push_back(t);
+    for(size_t k = 0; k < RATE / 8; k++) {
+      float env = exp(-(float)k / (0.04f * RATE));
+      s[at + k] += 0.8f * env * sin(2 * M_PI * (50 + 60 * env) * k / RATE);
+    }
+    at += RATE / 4;
+    hats.push_back(t + 0.25f);
+    for(size_t k = 0; k < RATE / 20; k++) {
+      s[at + k] += 0.3f * exp(-(float)k / (0.01f * RATE)) * ((rand() / (float)RAND_MAX) * 2 - 1);
+    }
+  }
+
+  char path[] = "/tmp/audiobenchXXXXXX";
+  int  fd     = mkstemp(path);
+  close(fd);
+  WavReader wav;
+  bool ok = writeWav(path, &s[0], s.size(), RATE) && wav.open(path) &&
+            (wav.frames() == s.size()) && (wav.sampleRate() == RATE);
+  unlink(path);
+  if(!ok) {
+    printf("WAV round trip failed\n");
+    return false;
+  }
+
+  // Analysis on its own thread, frames taken here as they come
+  AudioAnalyzer           analyzer(RATE, BANDS, SIZE);
+  AudioEngine             engine(analyzer);
+  std::vector<AudioFrame> frames;
+  AudioFrame              f;
+  engine.start(wav, false);
+  for(;;) {
+    bool done = !engine.running(); // Before looking, so nothing's missed
+    if(engine.next(f))  frames.push_back(f);
+    else if(done)       break;
+    else                std::this_thread::yield();
+  }
+  for(size_t k = 0; k < frames.size(); k++) {
+    if(frames[k].sequence != k) {
+      printf("Frame %zu out of sequence (%u)\n", k, frames[k].sequence);
+      return false;
+    }
+  }
+
+  // Each flagged frame should be within a window of a kick (or hat)
+  const float tolerance = (float)SIZE / RATE;
+  int kickHits = 0, kickFalse = 0, onsetHits = 0, onsetFalse = 0;
+  for(size_t k = 0; k < frames.size(); k++) {
+    float t = (float)frames[k].sample / RATE, near = 1e9;
+    for(size_t j = 0; j < kicks.size(); j++) near = fmin(near, fabs(t - kicks[j]));
+    if(frames[k].kick) (near < tolerance) ? kickHits++ : kickFalse++;
+    for(size_t j = 0; j < hats.size(); j++) near = fmin(near, fabs(t - hats[j]));
+    if(frames[k].onset) (near < tolerance) ? onsetHits++ : onsetFalse++;
+  }
+  printf("%-34s %d of %zu found, %d false\n", "Kicks", kickHits, kicks.size(), kickFalse);
+  printf("%-34s %d of %zu found, %d false\n", "Onsets (kicks and hi-hats)", onsetHits,
+    kicks.size() + hats.size(), onsetFalse);
+  printf("%-34s %zu frames, %lu dropped\n", "Engine to renderer ring", frames.size(),
+    engine.overruns());
+  return (kickHits == (int)kicks.size()) && (kickFalse == 0) &&
+         (onsetHits >= (int)(kicks.size() + hats.size()) * 9 / 10) && (onsetFalse <= 1);
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("Audio analysis host benchmark: %u Hz, %u-point FFT, %u bands\n\n", RATE, SIZE, BANDS);
+  bool ok = checkFFT();
+  ok = checkBands() && ok;
+  ok = checkStream() && ok;
+  printf("\n");
+
+  std::vector<float> x(SIZE), mag(SIZE / 2 + 1);
+  for(int k = 0; k < SIZE; k++) x[k] = (rand() / (float)RAND_MAX) * 2 - 1;
+  RealFFT fft(SIZE);
+  printf("%-34s %14.0f /s\n", "RealFFT::magnitudes", callsPerSecond([&]() {
+    fft.magnitudes(&x[0], &mag[0]);
+    x[0] = mag[1];
+  }));
+
+  AudioAnalyzer      a(RATE, BANDS, SIZE);
+  std::vector<float> hop(a.hop());
+  for(size_t k = 0; k < hop.size(); k++) hop[k] = (rand() / (float)RAND_MAX) * 2 - 1;
+  float sink = 0;
+  double fps = callsPerSecond([&]() {
+    a.feed(&hop[0], hop.size(), [&](const AudioFrame &f) { sink += f.level; });
+  });
+  printf("%-34s %14.0f /s (%.0fx real time)%s\n", "AudioAnalyzer frames", fps,
+    fps * a.hop() / RATE, sink < 0 ? " " : "");
+
+  return ok ? 0 : 1;
+}
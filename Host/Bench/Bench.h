@@ -0,0 +1,29 @@
+// Timing helper shared by the host benchmarks.  Each benchmark is a single
+// translation unit that includes this once.
+
+#ifndef LEDWALL_BENCH_H
+#define LEDWALL_BENCH_H
+
+#include <chrono>
+
+static double secondsPerCase = 0.5;
+
+// Calls f repeatedly for roughly secondsPerCase; returns calls per second.
+template<class F>
+static double callsPerSecond(F f) {
+  typedef std::chrono::steady_clock clock;
+  unsigned long calls = 0, batch = 1;
+  clock::time_point start = clock::now();
+  double elapsed;
+
+  do {
+    for(unsigned long i = 0; i < batch; i++) f();
+    calls += batch;
+    if(batch < (1UL << 20)) batch <<= 1;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while(elapsed < secondsPerCase);
+
+  return calls / elapsed;
+}
+
+#endif
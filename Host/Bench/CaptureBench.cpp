@@ -0,0 +1,135 @@
+// Host benchmark for the screen-capture Downsampler.  Reports frames/sec
+// for a 4K screen onto a small (18x11) and a large (64x36) wall: one
+// thread with the sketch's scalar loop, one thread with AVX2 gathers, and
+// all cores.  Every variant is first checked against the scalar one, over
+// several frames (so fade and minimum brightness are covered), and the
+// screen is passed through a PPM file and shared memory on the way.
+//
+// Usage: capturebench [seconds per case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "../Capture/Downsampler.h"
+#include "../Capture/FrameSource.h"
+#include "Bench.h"
+
+static const uint32_t W = 3840, H = 2160;
+
+// Smooth colour gradients with noise, and a dark band for the minimum
+// brightness boost.
+static void makeScreen(std::vector<uint32_t> &s, int frame) {
+  s.resize(W * H);
+  for(uint32_t y = 0; y < H; y++) {
+    for(uint32_t x = 0; x < W; x++) {
+      uint32_t r = (x * 255 / W + frame * 7) & 0xff, g = y * 255 / H, b = rand() & 0xff;
+      if((y > H / 3) && (y < H / 2)) r = g = b = rand() & 7;
+      s[y * W + x] = r << 16 | g << 8 | b;
+    }
+  }
+}
+
+static std::vector<CaptureLed> grid(uint16_t w, uint16_t h) {
+  std::vector<CaptureLed> leds;
+  for(uint16_t y = 0; y < h; y++) {
+    for(uint16_t x = 0; x < w; x++) {
+      CaptureLed l = { (uint16_t)((y & 1) ? w - 1 - x : x), y }; // Serpentine
+      leds.push_back(l);
+    }
+  }
+  return leds;
+}
+
+static bool run(uint16_t gw, uint16_t gh, const std::vector<std::vector<uint32_t> > &screens) {
+  std::vector<CaptureLed> leds = grid(gw, gh);
+  int                     cores = std::thread::hardware_concurrency();
+  if(cores < 2) cores = 2; // Still exercise the worker threads
+  Downsampler             scalar(W, H, gw, gh, &leds[0], leds.size()),
+                          avx2(W, H, gw, gh, &leds[0], leds.size()),
+                          threaded(W, H, gw, gh, &leds[0], leds.size(), cores);
+  std::vector<uint8_t>    want(leds.size() * 3), got(leds.size() * 3);
+  bool                    ok = true;
+
+  scalar.setKernel(Downsampler::SCALAR);
+  for(size_t f = 0; f < screens.size() * 3; f++) {
+    const uint32_t *s = &screens[f % screens.size()][0];
+    scalar.process(s, &want[0]);
+    avx2.process(s, &got[0]);
+    if(got != want) ok = false;
+    threaded.process(s, &got[0]);
+    if(got != want) ok = false;
+  }
+  if(!ok) {
+    printf("%ux%u wall: results differ from the scalar loop\n", gw, gh);
+    return false;
+  }
+
+  char name[64];
+  const uint32_t *s = &screens[0][0];
+  snprintf(name, sizeof(name), "%ux%u, scalar", gw, gh);
+  double fps = callsPerSecond([&]() { scalar.process(s, &got[0]); });
+  printf("%-28s %10.0f frames/s %12.0f LEDs/s\n", name, fps, fps * leds.size());
+  if(avx2.usingAVX2()) {
+    snprintf(name, sizeof(name), "%ux%u, AVX2", gw, gh);
+    fps = callsPerSecond([&]() { avx2.process(s, &got[0]); });
+    printf("%-28s %10.0f frames/s %12.0f LEDs/s\n", name, fps, fps * leds.size());
+  }
+  snprintf(name, sizeof(name), "%ux%u, %d threads", gw, gh, cores);
+  fps = callsPerSecond([&]() { threaded.process(s, &got[0]); });
+  printf("%-28s %10.0f frames/s %12.0f LEDs/s\n", name, fps, fps * leds.size());
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("Screen capture downsampling host benchmark: %ux%u screen\n\n", W, H);
+
+  std::vector<std::vector<uint32_t> > screens(3);
+  for(size_t f = 0; f < screens.size(); f++) makeScreen(screens[f], f);
+
+  // First screen goes through a PPM file...
+  char path[] = "/tmp/capturebenchXXXXXX";
+  int  fd     = mkstemp(path);
+  FILE *f     = fdopen(fd, "wb");
+  fprintf(f, "P6\n# test\n%u %u\n255\n", W, H);
+  for(size_t i = 0; i < screens[0].size(); i++) {
+    uint32_t c = screens[0][i];
+    fputc(c >> 16, f);
+    fputc(c >> 8 & 0xff, f);
+    fputc(c & 0xff, f);
+  }
+  fclose(f);
+  uint32_t              w, h;
+  std::vector<uint32_t> read;
+  bool ok = readPPM(path, w, h, read) && (w == W) && (h == H) && (read == screens[0]);
+  unlink(path);
+  if(!ok) {
+    printf("PPM round trip failed\n");
+    return 1;
+  }
+
+  // ...and the second through shared memory
+  SharedFrame writer, reader;
+  char        name[32];
+  snprintf(name, sizeof(name), "capturebench.%d", (int)getpid());
+  if(!writer.create(name, W, H)) {
+    printf("Can't create shared frame\n");
+    return 1;
+  }
+  memcpy(writer.pixels(), &screens[1][0], W * H * 4);
+  writer.publish();
+  if(!reader.open(name) || (reader.width() != W) || (reader.height() != H) ||
+     (reader.sequence() != 1) || memcmp(reader.pixels(), &screens[1][0], W * H * 4)) {
+    printf("Shared memory round trip failed\n");
+    return 1;
+  }
+  screens[1].assign(reader.pixels(), reader.pixels() + W * H);
+
+  if(!run(18, 11, screens)) return 1;
+  if(!run(64, 36, screens)) return 1;
+  return 0;
+}
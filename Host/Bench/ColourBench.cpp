@@ -0,0 +1,85 @@
+// Host benchmark for colour correction.  Reports pixels/sec for the
+// sketches' per-LED gamma[][] lookup and for ColourPipeline on a whole
+// frame, rounded and dithered.  Then checks what dithering buys at the
+// dim end: how many input levels come out as off, and how far the
+// average over many frames is from the exact corrected level.
+//
+// Usage: colourbench [seconds per case]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../Stream/ColourPipeline.h"
+#include "Bench.h"
+
+static const size_t LEDS = 198;
+
+template<class F>
+static void report(const char *name, F f) {
+  double cps = callsPerSecond(f);
+  printf("%-32s %14.0f pixels/s\n", name, cps * LEDS);
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  static uint8_t in[LEDS * 3], out[LEDS * 3], gamma[256][3];
+  for(size_t k = 0; k < sizeof(in); k++) in[k] = rand();
+
+  printf("Colour correction host benchmark: %zu LEDs\n\n", LEDS);
+
+  // As the sketches do it
+  for(int i = 0; i < 256; i++) {
+    float f = powf(i / 255.0f, 2.8f);
+    gamma[i][0] = f * 255.0f;
+    gamma[i][1] = f * 240.0f;
+    gamma[i][2] = f * 220.0f;
+  }
+  report("gamma[][] per LED", [&]() {
+    for(size_t i = 0, j = 0; i < LEDS; i++, j += 3) {
+      out[j]     = gamma[in[j]][0];
+      out[j + 1] = gamma[in[j + 1]][1];
+      out[j + 2] = gamma[in[j + 2]][2];
+    }
+    in[0]++;
+  });
+
+  ColourPipeline rounded(ColourSettings(2.8, 255, 240, 220, 255, false));
+  report("ColourPipeline (rounded)", [&]() { rounded.apply(in, out, LEDS); in[0]++; });
+  ColourPipeline dithered;
+#ifdef __SSE2__
+  report("ColourPipeline (dithered, SSE2)", [&]() { dithered.apply(in, out, LEDS); in[0]++; });
+#else
+  report("ColourPipeline (dithered)", [&]() { dithered.apply(in, out, LEDS); in[0]++; });
+#endif
+
+  // Dim end, red channel: every input level 0-63 on its own LED, averaged
+  // over 256 frames
+  printf("\nInput levels 0-63, red, averaged over 256 frames\n\n");
+  const int      levels = 64, frames = 256;
+  uint8_t        dim[levels * 3] = { 0 }, dimOut[levels * 3];
+  unsigned long  sum[levels] = { 0 };
+  ColourPipeline dither;
+  for(int v = 0; v < levels; v++) dim[v * 3] = v;
+  for(int f = 0; f < frames; f++) {
+    dither.apply(dim, dimOut, levels);
+    for(int v = 0; v < levels; v++) sum[v] += dimOut[v * 3];
+  }
+  int    offRounded = 0, offDithered = 0;
+  double errRounded = 0, errDithered = 0;
+  for(int v = 1; v < levels; v++) {
+    double exact = dither.level(0, v) / 256.0;
+    double avg   = (double)sum[v] / frames;
+    uint8_t r    = gamma[v][0];
+    if(r == 0)        offRounded++;
+    if(sum[v] == 0)   offDithered++;
+    errRounded  += fabs(r - exact);
+    errDithered += fabs(avg - exact);
+  }
+  printf("%-32s %6d of %d off, mean error %.3f\n", "gamma[][] (truncated)",
+    offRounded, levels - 1, errRounded / (levels - 1));
+  printf("%-32s %6d of %d off, mean error %.3f\n", "ColourPipeline (dithered)",
+    offDithered, levels - 1, errDithered / (levels - 1));
+
+  return 0;
+}
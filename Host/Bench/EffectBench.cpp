@@ -0,0 +1,503 @@
+// Headless benchmark of whole effects, run the way the sketches run them,
+// from a fixed random seed so every run draws the same frames:
+//
+//   life         conwaysGame: Life on the wall, reseeded when it settles
+//   shapes       a line, rectangles, a disk and a circle per frame
+//   crawl        text crawling across the wall with Drawable::crawl
+//   colourwipe   BackgroundEngine's ColourWipe, one colour after another
+//   wave         the waveEquation sketch (WaveField)
+//   pulse        the pulse sketches' diffusion, bursts and rings (PulseField)
+//   equalizer    the equalizer sketch's bars and waveform, from a WAV file
+//
+// The first four draw on an Adafruit_WS2801 as the board would, and a
+// frame is what show() sends; the rest render frames for streaming.
+//
+// For each, reports frames/sec, bytes per frame (over SPI from show(),
+// and over the serial link as WallStream would send them, delta frames
+// and all) and heap allocations per frame, and checks a hash of every
+// frame against Bench/EffectGolden.txt, so a change that makes things
+// faster can't quietly change what's on the wall.  After a change that is
+// meant to change the pictures, run with -u to write new golden values.
+// The float effects (wave, equalizer) hash what this build computes; the
+// values were made with the x86-64 host build.
+//
+// Usage: effectbench [-n frames] [-s seed] [-t seconds] [-w file.wav]
+//                    [-g golden] [-u] [effect...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../../Deprecated/Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../../Deprecated/Alphanumeric/Alphanumeric.h"
+#include "../../Deprecated/BackgroundEngine/BackgroundEngine.h"
+#include "../../Deprecated/Life/Life.h"
+#include "../../Deprecated/Shapes/Shapes.h"
+#include "../Audio/AudioAnalyzer.h"
+#include "../Sim/PulseField.h"
+#include "../Sim/WaveField.h"
+#include "../Stream/WallStream.h"
+#include "Bench.h"
+
+// Every heap allocation in the program, C or C++ (new ends up here too).
+// glibc lets a program replace these four.
+static unsigned long allocations = 0;
+
+extern "C" {
+void *__libc_malloc(size_t n);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t n);
+void  __libc_free(void *p);
+
+void *malloc(size_t n) {
+  allocations++;
+  return __libc_malloc(n);
+}
+void *calloc(size_t n, size_t size) {
+  allocations++;
+  return __libc_calloc(n, size);
+}
+void *realloc(void *p, size_t n) {
+  allocations++;
+  return __libc_realloc(p, n);
+}
+void free(void *p) {
+  __libc_free(p);
+}
+}
+
+static const uint8_t W = 18, H = 11;
+static const size_t  FRAME = (size_t)W * H * 3;
+
+// Where every frame ends up: hashed, kept for working out link bytes, and
+// counted.  Nothing here allocates once set up.
+struct FrameLog {
+  unsigned long         frames, spiBytes, keep;
+  std::vector<uint64_t> hashes;
+  std::vector<uint8_t>  kept;
+
+  FrameLog() : frames(0), spiBytes(0), keep(0) {}
+  void start(unsigned long n) {
+    frames = spiBytes = 0;
+    keep   = n;
+    hashes.assign(n, 0);
+    kept.assign(n * FRAME, 0);
+  }
+  void add(const uint8_t *rgb, size_t len) {
+    if(frames < keep) {
+      // FNV-1a, 64 bits
+      uint64_t h = 14695981039346656037ULL;
+      for(size_t k = 0; k < len; k++) h = (h ^ rgb[k]) * 1099511628211ULL;
+      hashes[frames] = h;
+      memcpy(&kept[frames * FRAME], rgb, len);
+    }
+    frames++;
+  }
+};
+
+static FrameLog frameLog;
+
+// The board's pixels: holds the strand as latched, and logs a frame at
+// every latch (show() sends nothing, and so latches nothing, when no
+// pixel changed).
+class BenchOutput : public WS2801Output {
+ public:
+  uint8_t  pixels[FRAME];
+  uint32_t pos;
+  BenchOutput() : pos(0) { memset(pixels, 0, sizeof(pixels)); }
+  void write(const uint8_t *data, uint32_t len) {
+    if(pos < FRAME) memcpy(&pixels[pos], data, (len < FRAME - pos) ? len : FRAME - pos);
+    pos += len;
+    frameLog.spiBytes += len;
+  }
+  void latch(void) {
+    frameLog.add(pixels, FRAME);
+    pos = 0;
+  }
+};
+
+static Adafruit_WS2801 strip(W * H, 2, 3, WS2801_RGB, W, H);
+static BenchOutput     output;
+
+struct BenchEffect {
+  const char *name;
+  bool        onBoard;           // Drawn on the strip, rather than streamed
+  BenchEffect(const char *n, bool board) : name(n), onBoard(board) {}
+  virtual ~BenchEffect() {}
+  // Back to the first frame (random numbers are seeded before this)
+  virtual void reset(void) = 0;
+  // Draws the next frame, or for crawl a few; logs them
+  virtual void step(void) = 0;
+};
+
+// Host effects log their frames themselves; LEDstream shifts every frame
+// out whole.
+static void stream(const uint8_t *rgb) {
+  frameLog.spiBytes += FRAME;
+  frameLog.add(rgb, FRAME);
+}
+
+static void clearStrip(uint32_t c) {
+  strip.fillRect(0, 0, H - 1, W - 1, c);
+  strip.show();
+}
+
+/*****************************************************************************/
+
+// conwaysGame's loop(): a generation per frame; once the board repeats,
+// ten more, then new cells
+struct LifeEffect : BenchEffect {
+  Life game;
+  int  settled;
+  LifeEffect() : BenchEffect("life", true), game(H, W, "B3/S23"), settled(0) {}
+  void reset(void) {
+    game.clear();
+    game.randomize(random(10, 100));
+    settled = 0;
+  }
+  void step(void) {
+    game.step();
+    game.draw(&strip, 25, 1638400);   // The sketch's ALIVE and DEAD
+    strip.show();
+    if(game.isSteady() && (++settled > 10)) {
+      game.randomize(random(10, 100));
+      settled = 0;
+    }
+  }
+};
+
+struct ShapesEffect : BenchEffect {
+  Shapes shapes;
+  ShapesEffect() : BenchEffect("shapes", true), shapes(&strip) {}
+  void reset(void) {}
+  void step(void) {
+    strip.fillRect(0, 0, H - 1, W - 1, 0);
+    shapes.line(random(-4, H + 4), random(-4, W + 4), random(-4, H + 4), random(-4, W + 4),
+      random(0x1000000));
+    shapes.rectangleFill(random(H), random(W), random(H), random(W), random(0x1000000));
+    shapes.rectangleOutline(random(H), random(W), random(H), random(W), random(0x1000000));
+    shapes.disk(random(H), random(W), random(1, 6), random(0x1000000));
+    shapes.circle(random(H), random(W), random(1, 8), random(0x1000000));
+    strip.show();
+  }
+};
+
+// Text crawling right to left, eight frames per crawl() as a sketch would
+// call it, coming round again once it has gone
+struct CrawlEffect : BenchEffect {
+  static const char *text(void) { return "HELLO WALL 0123"; }
+  Drawable         **letters;
+  int                count;
+  CrawlEffect() : BenchEffect("crawl", true), letters(NULL), count(strlen(text())) {}
+  ~CrawlEffect() { release(); }
+  void release(void) {
+    for(int k = 0; letters && (k < count); k++) delete letters[k];
+    free(letters);
+    letters = NULL;
+  }
+  void reset(void) {
+    release();
+    letters = Alphanumeric::alphanumericString(&strip, text(), 3, W, random(0x1000000));
+  }
+  void step(void) {
+    Drawable *last = letters[count - 1];
+    if(last->getBasePointX() + last->w() <= 0) {
+      int back = W - letters[0]->getBasePointX();
+      for(int k = 0; k < count; k++) letters[k]->translate(0, back);
+    }
+    // crawl() needs the letters off the wall; its first frame shows this
+    strip.fillRect(0, 0, H - 1, W - 1, 0x000010);
+    Drawable::crawl(&strip, letters, count, 0, -1, 8, 0);
+  }
+};
+
+struct WipeEffect : BenchEffect {
+  ColourWipe wipe;
+  WipeEffect() : BenchEffect("colourwipe", true), wipe(&strip, 0, 0) {}
+  void reset(void) {
+    clearStrip(0);
+    wipe.setColour(random(1, 0x1000000));
+    wipe.reset();
+  }
+  void step(void) {
+    if(!wipe.step(0)) {
+      wipe.setColour(random(1, 0x1000000));
+      wipe.reset();
+      wipe.step(0);
+    }
+    strip.show();
+  }
+};
+
+// The sketch's draw(): a step, then writeSerial()
+struct WaveEffect : BenchEffect {
+  WaveField field;
+  uint8_t   rgb[FRAME];
+  int       iterCnt;
+  WaveEffect() : BenchEffect("wave", false), field(W, H), iterCnt(0) {}
+  void reset(void) {
+    field.clear();
+    field.drop(0.5f, 0.5f);
+    iterCnt = 0;
+  }
+  void step(void) {
+    field.step();
+    field.render(rgb, (iterCnt / 2) % 255);
+    iterCnt++;
+    stream(rgb);
+  }
+};
+
+// The pulse sketch's burst every third frame, and a ring every fifth
+struct PulseEffect : BenchEffect {
+  PulseField field;
+  uint8_t    rgb[FRAME];
+  int        n;
+  PulseEffect() : BenchEffect("pulse", false), field(W, H), n(0) {}
+  void reset(void) {
+    memset(field.pixels(), 0, FRAME);
+    while(field.rings()) field.step();
+    memset(field.pixels(), 0, FRAME);
+    n = 0;
+  }
+  void step(void) {
+    if(n % 3 == 0) field.pulse(random(W), random(H), random(0x1000000));
+    if(n % 5 == 0) field.addRing(random(W), random(H), random(0x1000000) & 0x3f3f3f);
+    field.step();
+    field.render(rgb);
+    n++;
+    stream(rgb);
+  }
+};
+
+// The equalizer sketch: a bar per column from its band, and the samples
+// as red dots over them.  One frame per analysis hop; back to the start
+// at the end of the file.
+struct EqualizerEffect : BenchEffect {
+  const char        *path;
+  WavReader          wav;
+  AudioAnalyzer     *analyzer;
+  std::vector<float> block;
+  WallFrame          frame;
+  EqualizerEffect(const char *p) :
+    BenchEffect("equalizer", false), path(p), analyzer(NULL), frame(W, H) {}
+  ~EqualizerEffect() { delete analyzer; }
+  void reset(void) {
+    delete analyzer;
+    wav.open(path);
+    analyzer = new AudioAnalyzer(wav.sampleRate(), W);
+    block.assign(analyzer->hop(), 0);
+  }
+  void step(void) {
+    bool drawn = false;
+    while(!drawn) {
+      size_t got = wav.read(&block[0], block.size());
+      if(got == 0) {
+        wav.open(path);
+        continue;
+      }
+      analyzer->feed(&block[0], got, [&](const AudioFrame &f) {
+        frame.fill(0);
+        for(int x = 0; x < W; x++) {
+          float v = f.bands[x] * 2;
+          int   y = (int)(powf(v < 1 ? v : 1, 0.75f) * H);
+          for(int i = 0; i <= y; i++) frame.spc(x, H - 1 - i, 255);
+        }
+        for(int x = 0; x < W; x++) frame.spc(x, (int)(block[x] * 10 + 5), 255 << 16);
+        stream(frame.data());
+        drawn = true;
+      });
+    }
+  }
+};
+
+/*****************************************************************************/
+
+// Ten seconds of music-like sound: a bass line, chords and a kick drum
+// on every beat, from a fixed generator so the file is the same on every
+// run.
+static bool makeWav(const char *path) {
+  const uint32_t     rate = 44100;
+  std::vector<float> s(rate * 10);
+  static const float bass[] = { 55, 65.4f, 49, 73.4f };
+  uint32_t           noise = 12345;
+
+  for(size_t k = 0; k < s.size(); k++) {
+    float  t    = (float)k / rate;
+    int    bar  = (int)(t / 2) % 4;
+    size_t beat = k % (rate / 2);
+    noise = noise * 1664525 + 1013904223;
+    s[k]  = 0.25f * sinf(2 * (float)M_PI * bass[bar] * t)
+          + 0.1f * sinf(2 * (float)M_PI * bass[bar] * 4 * t)
+          + 0.08f * sinf(2 * (float)M_PI * bass[bar] * 6 * t)
+          + 0.5f * expf(-(float)beat / 2000) * sinf(2 * (float)M_PI * 60 * beat / rate)
+          + 0.02f * ((int32_t)noise / 2147483648.0f);
+  }
+  return writeWav(path, &s[0], s.size(), rate);
+}
+
+typedef std::map<std::string, std::vector<uint64_t> > Golden;
+
+static bool readGolden(const char *path, Golden &golden) {
+  FILE         *f = fopen(path, "r");
+  char          line[256], name[64];
+  unsigned long n;
+  unsigned long long h;
+
+  if(!f) return false;
+  while(fgets(line, sizeof(line), f)) {
+    if((line[0] == '#') || (sscanf(line, "%63s %lu %llx", name, &n, &h) != 3)) continue;
+    std::vector<uint64_t> &v = golden[name];
+    if(v.size() <= n) v.resize(n + 1, 0);
+    v[n] = h;
+  }
+  fclose(f);
+  return true;
+}
+
+static bool writeGolden(const char *path, const Golden &golden, unsigned seed) {
+  FILE *f = fopen(path, "w");
+  if(!f) return false;
+  fprintf(f, "# Frame hashes (FNV-1a) for effectbench, seed %u; regenerate with effectbench -u\n", seed);
+  for(Golden::const_iterator g = golden.begin(); g != golden.end(); ++g) {
+    for(size_t n = 0; n < g->second.size(); n++) {
+      fprintf(f, "%s %zu %016llx\n", g->first.c_str(), n, (unsigned long long)g->second[n]);
+    }
+  }
+  return fclose(f) == 0;
+}
+
+// Bytes the frames would take over the serial link, sent as WallStream
+// sends them (room in the queue for all, so none are dropped)
+static double linkBytes(unsigned long frames) {
+  WallStream stream(W * H, frames + 1);
+  if(!stream.open("/dev/null")) return 0;
+  for(unsigned long n = 0; n < frames; n++) stream.show(&frameLog.kept[n * FRAME], FRAME);
+  stream.close(false);
+  WallStream::Stats s = stream.stats();
+  return s.sent ? (double)s.bytes / s.sent : 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned long frames = 200;
+  unsigned      seed   = 1;
+  const char   *golden = "Bench/EffectGolden.txt", *wavPath = NULL;
+  bool          update = false;
+  int           c;
+
+  while((c = getopt(argc, argv, "n:s:t:w:g:u")) != -1) {
+    switch(c) {
+     case 'n': frames         = atol(optarg); break;
+     case 's': seed           = atoi(optarg); break;
+     case 't': secondsPerCase = atof(optarg); break;
+     case 'w': wavPath        = optarg;       break;
+     case 'g': golden         = optarg;       break;
+     case 'u': update         = true;         break;
+     default:  return 2;
+    }
+  }
+  if(!frames || !seed) {
+    fprintf(stderr, "usage: %s [-n frames] [-s seed] [-t seconds] [-w file.wav] [-g golden] [-u] [effect...]\n", argv[0]);
+    return 2;
+  }
+
+  char tmpWav[] = "/tmp/effectbench-XXXXXX";
+  if(!wavPath) {
+    int fd = mkstemp(tmpWav);
+    if((fd < 0) || (close(fd), !makeWav(tmpWav))) {
+      perror(tmpWav);
+      return 1;
+    }
+    wavPath = tmpWav;
+  }
+  WavReader probe;
+  if(!probe.open(wavPath)) {
+    fprintf(stderr, "Can't read %s\n", wavPath);
+    return 1;
+  }
+  probe.close();
+
+  Golden expected, made;
+  bool   haveGolden = readGolden(golden, expected);
+  if(!haveGolden && !update) printf("No golden values in %s (make them with -u)\n", golden);
+
+  strip.begin();
+  strip.setOutput(&output);
+  LifeEffect      life;
+  ShapesEffect    shapes;
+  CrawlEffect     crawl;
+  WipeEffect      wipe;
+  WaveEffect      wave;
+  PulseEffect     pulse;
+  EqualizerEffect equalizer(wavPath);
+  BenchEffect    *effects[] = { &life, &shapes, &crawl, &wipe, &wave, &pulse, &equalizer };
+
+  printf("Effect host benchmark: %ux%u wall, %lu frames, seed %u\n\n", W, H, frames, seed);
+  printf("%-11s %12s %10s %10s %12s   %s\n", "", "frames/s", "SPI B/f", "link B/f", "allocs/f", "golden");
+  int failed = 0;
+  for(size_t e = 0; e < sizeof(effects) / sizeof(effects[0]); e++) {
+    BenchEffect *fx = effects[e];
+    bool         chosen = (optind == argc);
+    for(int a = optind; a < argc; a++) chosen = chosen || !strcmp(argv[a], fx->name);
+    if(!chosen) continue;
+
+    // The frames, hashed, with the allocations made drawing them
+    randomSeed(seed);
+    srand(seed);
+    if(fx->onBoard) clearStrip(0);
+    fx->reset();
+    frameLog.start(frames);
+    unsigned long allocs = 0;
+    while(frameLog.frames < frames) {
+      unsigned long before = allocations;
+      fx->step();
+      allocs += allocations - before;
+    }
+    double spi  = (double)frameLog.spiBytes / frameLog.frames;
+    double link = linkBytes(frames);
+    double per  = (double)allocs / frameLog.frames;
+
+    const char *verdict = "";
+    const std::vector<uint64_t> &want = expected[fx->name];
+    made[fx->name] = frameLog.hashes;
+    if(!update && haveGolden) {
+      unsigned long n;
+      for(n = 0; (n < frames) && (n < want.size()) && (want[n] == frameLog.hashes[n]); n++);
+      if(want.empty()) {
+        verdict = "no golden values  <--";
+        failed++;
+      } else if(n < frames && n < want.size()) {
+        static char where[64];
+        snprintf(where, sizeof(where), "DIFFERENT from frame %lu  <--", n);
+        verdict = where;
+        failed++;
+      } else {
+        verdict = "as golden";
+      }
+    }
+
+    // Then as fast as it goes
+    randomSeed(seed);
+    fx->reset();
+    unsigned long calls = 0, before = frameLog.frames;
+    double cps = callsPerSecond([&]() { fx->step(); calls++; });
+    double fps = cps * (frameLog.frames - before) / calls;
+    printf("%-11s %12.0f %10.1f %10.1f %12.2f   %s\n", fx->name, fps, spi, link, per, verdict);
+  }
+
+  if(update) {
+    // Effects not run keep their old values
+    for(Golden::iterator g = made.begin(); g != made.end(); ++g) expected[g->first] = g->second;
+    if(!writeGolden(golden, expected, seed)) {
+      perror(golden);
+      failed++;
+    } else {
+      printf("\nGolden values written to %s\n", golden);
+    }
+  }
+  if(wavPath == tmpWav) unlink(tmpWav);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+// Host benchmark for the LEDstream framing state machine.
+//
+// First, the state machine alone: serial input comes from memory, SPI
+// output is discarded, and the clock jumps ahead on every reading so
+// latch and underrun pauses end at once.  This gives the sustained serial
+// bytes/sec it could keep up with.
+//
+// Then a simulated controller, where time passes only as the board does
+// work: USB data arrives in 64-byte packets, each serial read and each
+// pass of the state machine costs a little, and SPI takes a fixed time
+// per byte.  This gives the frames/sec a real board could reach, for a
+// few buffer sizes.
+//
+// Usage: ledstreambench [seconds per case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../../LEDstream/LEDstreamCore.h"
+#include "Bench.h"
+
+// Plays a prepared stream over and over.
+class LoopSource {
+ public:
+  std::vector<uint8_t> in;
+  size_t               pos;
+  unsigned long        taken;
+  LoopSource() : pos(0), taken(0) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    for(uint16_t k = 0; k < len; k++) {
+      buf[k] = in[pos];
+      if(++pos == in.size()) pos = 0;
+    }
+    taken += len;
+    return len;
+  }
+  void write(const uint8_t *, uint8_t) { }
+};
+
+class NullSink {
+ public:
+  uint8_t sum;
+  NullSink() : sum(0) {}
+  bool ready(void) { return true; }
+  void write(uint8_t b) { sum ^= b; }
+  void indicator(bool) { }
+};
+
+class JumpClock {
+ public:
+  unsigned long us;
+  JumpClock() : us(0) {}
+  unsigned long micros(void) { return us += 1000; }
+  unsigned long millis(void) { return us / 1000; }
+};
+
+typedef LEDstreamCore<LoopSource, NullSink, JumpClock> Core;
+
+static void header(std::vector<uint8_t> &s, uint8_t type, uint16_t count) {
+  uint8_t hi = count >> 8, lo = count;
+  s.push_back(magic[0]);
+  s.push_back(magic[1]);
+  s.push_back(type);
+  s.push_back(hi);
+  s.push_back(lo);
+  s.push_back(hi ^ lo ^ 0x55);
+}
+
+static void report(const char *name, std::vector<uint8_t> &stream, int frames) {
+  LoopSource source;
+  NullSink   sink;
+  JumpClock  clock;
+  Core      *core = new Core(source, sink, clock);
+
+  source.in = stream;
+  core->begin();
+  // Reads take all the buffer has room for, so the rate bytes are taken
+  // in is, in the long run, the rate they are dealt with
+  unsigned long before = source.taken;
+  double        polls  = 0;
+  double        pps    = callsPerSecond([&]() { core->poll(); polls++; });
+  double        bps    = pps * (source.taken - before) / polls;
+
+  printf("%-28s %14.0f bytes/s %10.0f frames/s\n", name, bps,
+    bps * frames / stream.size());
+  delete core;
+}
+
+// ---- Simulated controller ----
+
+// Board timing, in nanoseconds.
+struct Timing {
+  const char   *name;
+  unsigned long poll;       // One pass of the state machine
+  unsigned long readCall;   // Serial read call, plus...
+  unsigned long readByte;   // ...this per byte copied
+  unsigned long spiByte;    // Shifting one byte out
+};
+
+class SimClock {
+ public:
+  unsigned long ns;
+  SimClock() : ns(0) {}
+  unsigned long micros(void) { return ns / 1000; }
+  unsigned long millis(void) { return ns / 1000000; }
+};
+
+// USB full speed: a 64-byte packet every 64 us (about 1 MB/s).
+class UsbSource {
+ public:
+  const std::vector<uint8_t> &in;
+  SimClock                   &clock;
+  const Timing               &timing;
+  unsigned long               taken;
+  UsbSource(const std::vector<uint8_t> &in, SimClock &c, const Timing &t) :
+    in(in), clock(c), timing(t), taken(0) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    unsigned long arrived = clock.ns / 64000 * 64;
+    uint16_t      n       = (arrived - taken < len) ? arrived - taken : len;
+    for(uint16_t k = 0; k < n; k++) buf[k] = in[(taken + k) % in.size()];
+    taken    += n;
+    clock.ns += timing.readCall + n * timing.readByte;
+    return n;
+  }
+  void write(const uint8_t *, uint8_t) { }
+};
+
+class SpiSink {
+ public:
+  SimClock     &clock;
+  const Timing &timing;
+  unsigned long busyUntil, frames;
+  SpiSink(SimClock &c, const Timing &t) : clock(c), timing(t), busyUntil(0), frames(0) {}
+  bool ready(void) {
+    if(clock.ns >= busyUntil) return true;
+    clock.ns += 100; // Spinning on the status register
+    return false;
+  }
+  void write(uint8_t) { busyUntil = clock.ns + timing.spiByte; }
+  void indicator(bool on) { if(on) frames++; }
+};
+
+template<uint16_t RingSize>
+static void simulate(const Timing &timing, const std::vector<uint8_t> &stream) {
+  typedef LEDstreamCore<UsbSource, SpiSink, SimClock, RingSize> Core;
+  SimClock  clock;
+  UsbSource source(stream, clock, timing);
+  SpiSink   sink(clock, timing);
+  Core     *core = new Core(source, sink, clock);
+
+  core->begin();
+  while(clock.ns < 1000000000UL) { // One simulated second
+    core->poll();
+    clock.ns += timing.poll;
+  }
+  printf("%-22s %5u-byte ring %8lu frames/s\n", timing.name, RingSize, sink.frames);
+  delete core;
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("LEDstream host benchmark (state machine only)\n\n");
+
+  std::vector<uint8_t> plain;
+  for(int f = 0; f < 16; f++) {
+    header(plain, magic[2], MAXLEDS - 1);
+    for(int k = 0; k < FRAMESIZE; k++) plain.push_back(rand());
+  }
+  report("plain frames", plain, 16);
+
+  std::vector<uint8_t> delta;
+  header(delta, magic[2], MAXLEDS - 1);
+  for(int k = 0; k < FRAMESIZE; k++) delta.push_back(rand());
+  for(int f = 0; f < 15; f++) {
+    // 10 runs of 4 LEDs changed
+    header(delta, deltaMagic, 10 * (3 + 12));
+    for(int r = 0; r < 10; r++) {
+      uint16_t start = r * 20 + f;
+      delta.push_back(start >> 8);
+      delta.push_back(start);
+      delta.push_back(3);
+      for(int k = 0; k < 12; k++) delta.push_back(rand());
+    }
+  }
+  report("delta frames (10% changed)", delta, 16);
+
+  std::vector<uint8_t> noise;
+  for(int k = 0; k < 4096; k++) noise.push_back(rand() % ('A' - 1));
+  report("header search (noise)", noise, 0);
+
+  // 200-LED frames as LEDstream's host software sends them
+  printf("\nSimulated controller, 200-LED frames\n\n");
+  std::vector<uint8_t> frames;
+  for(int f = 0; f < 4; f++) {
+    header(frames, magic[2], MAXLEDS - 1);
+    for(int k = 0; k < FRAMESIZE; k++) frames.push_back(rand());
+  }
+  static const Timing timings[] = {
+    { "32u4, SPI at 1 MHz",   1000, 2000, 250, 8000 },
+    { "32u4, SPI at 4 MHz",   1000, 2000, 250, 2000 },
+    { "Teensy 3, SPI 8 MHz",   150,  500,  30, 1000 },
+  };
+  for(size_t t = 0; t < sizeof(timings) / sizeof(timings[0]); t++) {
+    simulate<256>(timings[t], frames);
+    simulate<2048>(timings[t], frames);
+  }
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Host benchmark for the bitboard Life engine.  For a few board sizes and
+// rules, checks the engine against a plain cell-by-cell implementation (the
+// way conwaysGame used to do it) and reports generations/sec for both.
+//
+// Usage: lifebench [seconds per case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../../Deprecated/Life/Life.h"
+#include "Bench.h"
+
+// Cell-by-cell reference: one byte per cell, eight wrapped lookups per cell.
+struct NaiveLife {
+  int h, w, birth, survive;
+  std::vector<uint8_t> cells, next;
+
+  NaiveLife(int h, int w, int birth, int survive)
+    : h(h), w(w), birth(birth), survive(survive), cells(h * w), next(h * w) {}
+
+  void step(void) {
+    for(int i = 0; i < h; i++) {
+      for(int j = 0; j < w; j++) {
+        int n = 0;
+        for(int di = -1; di <= 1; di++) {
+          for(int dj = -1; dj <= 1; dj++) {
+            if(di || dj) n += cells[((i + di + h) % h) * w + (j + dj + w) % w];
+          }
+        }
+        next[i * w + j] = ((cells[i * w + j] ? survive : birth) >> n) & 1;
+      }
+    }
+    cells.swap(next);
+  }
+};
+
+static bool same(Life &life, NaiveLife &ref) {
+  for(int i = 0; i < ref.h; i++) {
+    for(int j = 0; j < ref.w; j++) {
+      if(life.get(i, j) != (ref.cells[i * ref.w + j] != 0)) return false;
+    }
+  }
+  return true;
+}
+
+static int run(int h, int w, const char *rule, int birth, int survive) {
+  Life      life(h, w, rule);
+  NaiveLife ref(h, w, birth, survive);
+  int       g;
+
+  srand(h * 1000 + w);
+  for(int k = 0; k < h * w / 3; k++) {
+    int i = rand() % h, j = rand() % w;
+    life.set(i, j, true);
+    ref.cells[i * w + j] = 1;
+  }
+  for(g = 0; g < 64 && same(life, ref); g++) {
+    life.step();
+    ref.step();
+  }
+  if(g < 64 || !same(life, ref)) {
+    printf("%4dx%-4d %-8s MISMATCH at generation %d\n", h, w, rule, g);
+    return 1;
+  }
+
+  double fast  = callsPerSecond([&]() { life.step(); });
+  double naive = callsPerSecond([&]() { ref.step(); });
+  printf("%4dx%-4d %-8s %12.0f gen/s %14.0f cells/s   naive %10.0f gen/s  x%.1f\n",
+    h, w, rule, fast, fast * h * w, naive, fast / naive);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int failed = 0;
+
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("Life host benchmark\n\n");
+  failed += run(11,   18,   "B3/S23",  1 << 3,              (1 << 2) | (1 << 3));
+  failed += run(64,   64,   "B3/S23",  1 << 3,              (1 << 2) | (1 << 3));
+  failed += run(37,   1000, "B3/S23",  1 << 3,              (1 << 2) | (1 << 3));
+  failed += run(256,  256,  "B36/S23", (1 << 3) | (1 << 6), (1 << 2) | (1 << 3));
+  failed += run(100,  100,  "B2/S",    1 << 2,              0);
+  failed += run(100,  100,  "23/3",    1 << 3,              (1 << 2) | (1 << 3));
+
+  // Cycle detection: a blinker has period 2, a block is still
+  Life blinker(11, 18);
+  blinker.set(5, 4, true); blinker.set(5, 5, true); blinker.set(5, 6, true);
+  blinker.step(); blinker.step(); blinker.step();
+  Life block(11, 18);
+  block.set(2, 2, true); block.set(2, 3, true); block.set(3, 2, true); block.set(3, 3, true);
+  block.step(); block.step();
+  if(blinker.cycleLength() != 2 || block.cycleLength() != 1) {
+    printf("cycle detection: blinker %d, block %d\n", blinker.cycleLength(), block.cycleLength());
+    failed++;
+  }
+
+  return failed ? 1 : 0;
+}
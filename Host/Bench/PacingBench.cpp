@@ -0,0 +1,200 @@
+// Host benchmark for WallStream's frame pacing, over a simulated
+// 115200-baud board.  A sketch draws at 60 frames/sec, as Processing's
+// draw() would, far more than the link carries; the board end reads a
+// FIFO (with a 4 KB buffer, like a serial port's) at 11520 bytes/sec and
+// runs LEDstream's state machine on what it reads.  Each frame carries
+// its number in its first pixel, so the board knows which frame it
+// latched and when, and the latency reported is measured, show() to
+// latch -- alongside WallStream's own estimate.
+//
+//   unpaced     every frame taken from the queue is written at once, and
+//               waits in the port's buffer
+//   paced       held until the link is nearly ready (the default)
+//   paced+skip  as paced, and the sketch skips drawing when ready() says
+//               the frame would only wait
+//
+// Usage: pacingbench [seconds per case]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../../LEDstream/LEDstreamCore.h"
+#include "../Stream/WallStream.h"
+#include "Bench.h"
+
+typedef std::chrono::steady_clock Time;
+
+static const uint16_t W = 18, H = 11;
+static const double   LINK = 11520;      // Bytes/sec: 115200 baud, 10 bits a byte
+static const double   FPS  = 60;         // The sketch's frame rate
+
+static Time::time_point epoch = Time::now();
+
+static double now(void) {
+  return std::chrono::duration<double>(Time::now() - epoch).count();
+}
+
+// When each frame was shown, by number
+static std::mutex          shownLock;
+static std::vector<double> shownAt;
+
+class BoardClock {
+ public:
+  unsigned long micros(void) { return (unsigned long)(now() * 1e6); }
+  unsigned long millis(void) { return (unsigned long)(now() * 1e3); }
+};
+
+// Bytes from the FIFO, handed over no faster than the link would
+class LinkSource {
+ public:
+  int                  fd;
+  double               start, taken;
+  std::vector<uint8_t> pending;
+  LinkSource() : fd(-1), start(0), taken(0) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    double allowed = (now() - start) * LINK - taken;
+    if(allowed < 1) return 0;
+    if(len > allowed) len = allowed;
+    ssize_t n = ::read(fd, buf, len);
+    if(n <= 0) {
+      start = now();         // Idle link: no credit saved up
+      taken = 0;
+      return 0;
+    }
+    taken += n;
+    return n;
+  }
+  void write(const uint8_t *, uint8_t) { }
+};
+
+// SPI output: notes which frame latched, and how long after it was shown
+class LatchSink {
+ public:
+  std::vector<uint8_t> current;
+  std::vector<double>  latencies;
+  bool ready(void) { return true; }
+  void write(uint8_t b) { current.push_back(b); }
+  void indicator(bool on) {
+    if(!on || (current.size() < 3)) return;
+    uint32_t n = ((uint32_t)current[0] << 16) | ((uint32_t)current[1] << 8) | current[2];
+    current.clear();
+    std::lock_guard<std::mutex> hold(shownLock);
+    if(n < shownAt.size()) latencies.push_back(now() - shownAt[n]);
+  }
+};
+
+struct Result {
+  double drawn, latched, latency, p95, estimate, linkRate;
+  unsigned long dropped, late;
+};
+
+static Result runCase(const char *fifo, double pacing, bool skip) {
+  LinkSource          source;
+  LatchSink           sink;
+  BoardClock          clock;
+  LEDstreamCore<LinkSource, LatchSink, BoardClock> core(source, sink, clock);
+  std::atomic<bool>   done(false);
+  Result              r;
+
+  shownAt.clear();
+  shownAt.reserve((size_t)(FPS * secondsPerCase * 2) + 10);
+  source.fd = open(fifo, O_RDONLY | O_NONBLOCK);
+  fcntl(source.fd, F_SETPIPE_SZ, 4096);
+  source.start = now();
+  core.begin();
+  std::thread board([&]() {
+    while(!done) {
+      for(int k = 0; k < 64; k++) core.poll();
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+
+  WallStream stream(W * H);
+  WallFrame  frame(W, H);
+  stream.setPacing(pacing);
+  // Full frames: palette frames of these few colours would fit the link
+  // with room to spare, and there'd be nothing to pace
+  stream.setIndexedFrames(false);
+  stream.open(fifo);
+
+  // Equalizer-like frames: every column's bar moves every frame
+  double   start = now(), next = start;
+  uint32_t drawn = 0;
+  while(now() - start < secondsPerCase) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(std::max(0.0, next - now())));
+    next += 1 / FPS;
+    if(skip && !stream.ready()) continue;
+    for(uint16_t x = 0; x < W; x++) {
+      int bar = rand() % (H + 1);
+      for(uint16_t y = 0; y < H; y++) frame.spc(x, y, (H - 1 - y < bar) ? 0x0000ff : 0);
+    }
+    frame.setPixelColor(0, drawn);
+    {
+      std::lock_guard<std::mutex> hold(shownLock);
+      shownAt.push_back(now());
+    }
+    stream.show(frame);
+    drawn++;
+  }
+  double elapsed = now() - start;
+  WallStream::Stats s = stream.stats();
+  stream.close(false);
+  done = true;
+  board.join();
+  close(source.fd);
+
+  std::vector<double> &l = sink.latencies;
+  std::sort(l.begin(), l.end());
+  r.drawn    = drawn / elapsed;
+  r.latched  = l.size() / elapsed;
+  r.latency  = 0;
+  for(size_t k = 0; k < l.size(); k++) r.latency += l[k] / l.size();
+  r.p95      = l.empty() ? 0 : l[l.size() * 95 / 100];
+  r.estimate = s.latency;
+  r.linkRate = s.linkRate;
+  r.dropped  = s.dropped;
+  r.late     = s.late;
+  return r;
+}
+
+int main(int argc, char **argv) {
+  char fifo[] = "/tmp/pacingbench-XXXXXX";
+
+  secondsPerCase = (argc > 1) ? atof(argv[1]) : 4;
+  if(!mkdtemp(fifo)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string path = std::string(fifo) + "/wall";
+  if(mkfifo(path.c_str(), 0600)) {
+    perror("mkfifo");
+    return 1;
+  }
+
+  printf("Frame pacing: %ux%u wall, sketch at %.0f frames/s, link at %.0f bytes/s\n\n",
+    W, H, FPS, LINK);
+  printf("              drawn/s  latched/s   latency   p95    estimated   link est  dropped (late)\n");
+  static const struct { const char *name; double pacing; bool skip; } cases[] = {
+    { "unpaced",    0,    false },
+    { "paced",      0.15, false },
+    { "paced+skip", 0.15, true  },
+  };
+  for(size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    Result r = runCase(path.c_str(), cases[c].pacing, cases[c].skip);
+    printf("%-12s %8.1f %10.1f %8.0f ms %5.0f ms %8.0f ms %10.0f %8lu (%lu)\n", cases[c].name,
+      r.drawn, r.latched, r.latency * 1000, r.p95 * 1000, r.estimate * 1000, r.linkRate,
+      r.dropped, r.late);
+  }
+  unlink(path.c_str());
+  rmdir(fifo);
+  return 0;
+}
@@ -0,0 +1,279 @@
+// Host benchmark for the pulse effects.  Checks PulseField against the
+// pulse and pulseWaveWaveform sketches' iterate() (a Colour and an
+// ArrayList per pixel) and pulseWave() rings, frame by frame, and its
+// table-driven bursts against the sketch's pow() falloff.  Then reports
+// frames/sec and allocations per frame for each on the wall, and frames/sec
+// with many rings and bursts at once on a bigger wall.
+//
+// Usage: pulsebench [seconds per case]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <deque>
+#include <new>
+#include <vector>
+#include "../Sim/PulseField.h"
+#include "Bench.h"
+
+// Every allocation in the program, to show what a frame costs
+static unsigned long allocations = 0;
+
+void *operator new(size_t n) {
+  allocations++;
+  void *p = malloc(n ? n : 1);
+  if(p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+// As the sketches do it: serpentine byte buffers through gpc()/spc(), and
+// objects for everything.
+struct SketchPulse {
+  int                  w, h;
+  float                bright, mid;
+  std::vector<uint8_t> data, copy;
+  std::deque<int>      pulses;
+
+  struct Colour {
+    int r, g, b;
+    Colour(int c) : r((c >> 16) & 255), g((c >> 8) & 255), b(c & 255) {}
+    void add(const Colour &o) { r += 0.8f * o.r; g += 0.8f * o.g; b += 0.8f * o.b; }
+    void add(const std::vector<Colour *> &loc) {
+      for(int i = 0; i < (int)loc.size(); i++) {
+        r = (i + 1) * r / (i + 2) + loc[i]->r / (i + 2);
+        g = (i + 1) * g / (i + 2) + loc[i]->g / (i + 2);
+        b = (i + 1) * b / (i + 2) + loc[i]->b / (i + 2);
+      }
+    }
+    int  norm(void) const { return std::max(r, std::max(g, b)); }
+    void scale(float s) { r *= s; g *= s; b *= s; }
+    int  toInt(void) const { return (r << 16) + (g << 8) + b; }
+  };
+
+  SketchPulse(int w, int h, float bright, float mid) :
+    w(w), h(h), bright(bright), mid(mid), data(w * h * 3), copy(w * h * 3) {}
+
+  int index(int x, int y) { return 3 * ((y % 2 == 0) ? w * y + x : w * y + (w - 1 - x)); }
+  void spc(int x, int y, int c, std::vector<uint8_t> &to) {
+    int n = index(x, y);
+    to[n] = (c >> 16) & 255; to[n + 1] = (c >> 8) & 255; to[n + 2] = c & 255;
+  }
+  int gpc(int x, int y, std::vector<uint8_t> &from) {
+    int n = index(x, y);
+    return (from[n] << 16) + (from[n + 1] << 8) + from[n + 2];
+  }
+
+  void iterate(void) {
+    static const int dir[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    data.swap(copy);
+    for(int x = 0; x < w; x++) {
+      for(int y = 0; y < h; y++) {
+        Colour                *c   = new Colour(gpc(x, y, copy));
+        std::vector<Colour *> *loc = new std::vector<Colour *>();
+        for(int k = 0; k < 4; k++) {
+          int i = x + dir[k][0], j = y + dir[k][1];
+          if(i >= w || j >= h || i < 0 || j < 0) continue;
+          loc->push_back(new Colour(gpc(i, j, copy)));
+        }
+        c->add(*loc);
+        if(c->norm() > 200)     c->scale(bright);
+        else if(c->norm() > 50) c->scale(mid);
+        else                    c->scale(1.05f);
+        spc(x, y, c->toInt(), data);
+        for(size_t k = 0; k < loc->size(); k++) delete (*loc)[k];
+        delete loc;
+        delete c;
+      }
+    }
+  }
+
+  // pulseWaveWaveform: rings first, then iterate()
+  void pulseWave(void) {
+    std::deque<int> next;
+    while(!pulses.empty()) {
+      int x = pulses[0], y = pulses[1], r = pulses[2], colour = pulses[3];
+      pulses.erase(pulses.begin(), pulses.begin() + 4);
+      Colour c(colour);
+      for(int i = 0; i < w; i++) {
+        for(int j = 0; j < h; j++) {
+          if((x - i) * (x - i) + (y - j) * (y - j) <= r * r) {
+            Colour *o = new Colour(gpc(i, j, data));
+            o->scale(0.8f);
+            Colour *cc = new Colour(c.toInt());
+            o->add(*cc);
+            spc(i, j, o->toInt(), data);
+            delete cc;
+            delete o;
+          }
+        }
+      }
+      if(r < 5) {
+        next.push_back(x); next.push_back(y); next.push_back(r + 1); next.push_back(colour);
+      }
+    }
+    pulses.swap(next);
+    iterate();
+  }
+
+  // The pulse sketch's burst, BFS and all (reading and writing the same
+  // frame, where the sketch reads the one before)
+  void pulse(int x, int y, int colour) {
+    static const int dir[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    std::vector<uint8_t> *m = new std::vector<uint8_t>(w * h, 0);
+    std::deque<int>      *q = new std::deque<int>();
+    Colour                c(colour);
+    q->push_back(x);
+    q->push_back(y);
+    spc(x, y, colour, data);
+    while(!q->empty()) {
+      int i = q->front(); q->pop_front();
+      int j = q->front(); q->pop_front();
+      (*m)[j * w + i] = 1;
+      for(int k = 0; k < 4; k++) {
+        int ni = i + dir[k][0], nj = j + dir[k][1];
+        if(ni >= w || nj >= h || ni < 0 || nj < 0 || (*m)[nj * w + ni]) continue;
+        Colour *o  = new Colour(gpc(ni, nj, data));
+        Colour *cc = new Colour(c.toInt());
+        cc->scale(1 / powf((x - ni) * (x - ni) + (y - nj) * (y - nj), 0.75f));
+        o->add(*cc);
+        // Saturating, where the sketch wraps into the next channel
+        spc(ni, nj, std::min(o->r, 255) << 16 | std::min(o->g, 255) << 8 | std::min(o->b, 255), data);
+        q->push_back(ni);
+        q->push_back(nj);
+        (*m)[nj * w + ni] = 1;
+        delete cc;
+        delete o;
+      }
+    }
+    delete q;
+    delete m;
+  }
+};
+
+static void randomise(PulseField &field, SketchPulse &sketch) {
+  for(int y = 0; y < sketch.h; y++) {
+    for(int x = 0; x < sketch.w; x++) {
+      int c = rand() & 0xffffff;
+      field.set(x, y, c);
+      sketch.spc(x, y, c, sketch.data);
+    }
+  }
+}
+
+// Diffusion alone (the pulse sketch), then rings and diffusion
+// (pulseWaveWaveform), frame by frame.
+static bool checkFrames(int w, int h) {
+  std::vector<uint8_t> out(w * h * 3);
+  int                  frames = 0;
+  bool                 ok;
+
+  PulseField  field(w, h);
+  SketchPulse sketch(w, h, 0.8f, 0.9f);
+  randomise(field, sketch);
+  for(ok = true; ok && (frames < 300); frames++) {
+    field.diffuse();
+    sketch.iterate();
+    field.render(&out[0]);
+    ok = (out == sketch.data);
+  }
+  printf("%3dx%-3d diffusion, %3d frames: %s\n", w, h, frames, ok ? "identical" : "DIFFERENT  <--");
+  bool all = ok;
+
+  // Ring colours up to 64 per channel can't push a channel past 255, so
+  // the sketch's overflow doesn't come into it
+  PulseField  rings(w, h);
+  SketchPulse sketch2(w, h, 0.7f, 0.8f);
+  rings.setFades(0.7f, 0.8f, 1.05f);
+  randomise(rings, sketch2);
+  for(ok = true, frames = 0; ok && (frames < 300); frames++) {
+    if(frames % 3 == 0) {
+      int x = rand() % w, y = rand() % h, c = rand() & 0x3f3f3f;
+      rings.addRing(x, y, c);
+      sketch2.pulses.push_back(x); sketch2.pulses.push_back(y);
+      sketch2.pulses.push_back(1); sketch2.pulses.push_back(c);
+    }
+    rings.step();
+    sketch2.pulseWave();
+    rings.render(&out[0]);
+    ok = (out == sketch2.data);
+  }
+  printf("%3dx%-3d rings and diffusion, %3d frames: %s\n", w, h, frames, ok ? "identical" : "DIFFERENT  <--");
+  return all && ok;
+}
+
+// Bursts go by table, in 0.16 rather than float: within one of the
+// sketch's levels.
+static bool checkPulse(int w, int h) {
+  std::vector<uint8_t> out(w * h * 3);
+  int                  worst = 0;
+
+  for(int n = 0; n < 50; n++) {
+    PulseField  field(w, h);
+    SketchPulse sketch(w, h, 0.8f, 0.9f);
+    randomise(field, sketch);
+    int x = rand() % w, y = rand() % h, c = rand() & 0xffffff;
+    field.pulse(x, y, c);
+    sketch.pulse(x, y, c);
+    field.render(&out[0]);
+    for(size_t k = 0; k < out.size(); k++) worst = std::max(worst, abs(out[k] - sketch.data[k]));
+  }
+  printf("%3dx%-3d bursts: largest difference %d\n", w, h, worst);
+  return worst <= 1;
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("Pulse effects host benchmark\n\n");
+  bool ok = checkFrames(18, 11);
+  ok = checkFrames(61, 37) && ok;
+  ok = checkPulse(18, 11) && ok;
+  ok = checkPulse(61, 37) && ok;
+  printf("\n");
+
+  PulseField  field(18, 11);
+  SketchPulse sketch(18, 11, 0.8f, 0.9f);
+  randomise(field, sketch);
+  std::vector<uint8_t> out(18 * 11 * 3);
+  unsigned long        before;
+  int                  frame = 0;
+
+  // The pulse sketch's draw(): iterate(), and a burst every third frame
+  before = allocations;
+  double fps = callsPerSecond([&]() {
+    sketch.iterate();
+    if(frame++ % 3 == 0) sketch.pulse(rand() % 18, rand() % 11, rand() & 0xffffff);
+  });
+  printf("%-36s %12.0f frames/s %8.1f allocations/frame\n", "18x11 sketch iterate + pulse", fps,
+    (allocations - before) / (fps * secondsPerCase));
+  before = allocations;
+  fps    = callsPerSecond([&]() {
+    field.diffuse();
+    if(frame++ % 3 == 0) field.pulse(rand() % 18, rand() % 11, rand() & 0xffffff);
+    field.render(&out[0]);
+  });
+  printf("%-36s %12.0f frames/s %8.1f allocations/frame\n", "18x11 PulseField diffuse + pulse", fps,
+    (allocations - before) / (fps * secondsPerCase));
+
+  // Plenty going on at once on a bigger wall
+  const int  W = 192, H = 108;
+  PulseField big(W, H);
+  big.setFades(0.7f, 0.8f, 1.05f);
+  out.resize(W * H * 3);
+  before = allocations;
+  fps    = callsPerSecond([&]() {
+    while(big.addRing(rand() % W, rand() % H, rand() & 0xffffff)) {}
+    for(int k = 0; k < 16; k++) big.pulse(rand() % W, rand() % H, rand() & 0xffffff);
+    big.step();
+    big.render(&out[0]);
+  });
+  printf("%-36s %12.0f frames/s %8.1f allocations/frame\n", "192x108, 64 rings + 16 bursts", fps,
+    (allocations - before) / (fps * secondsPerCase));
+
+  return ok ? 0 : 1;
+}
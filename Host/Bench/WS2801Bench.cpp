@@ -0,0 +1,189 @@
+// Host benchmark for the WS2801 drawing stack.  Reports pixels/sec for the
+// strip's pixel setters, show(), and each Shapes primitive.  Output goes to
+// an in-memory capture, so the numbers measure the drawing code alone.
+// Streaming mode (show() from a generator, no pixel buffer) is checked
+// against the same picture drawn into a buffered strip first.
+//
+// Usage: ws2801bench [seconds per case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../Deprecated/Adafruit_WS2801/Adafruit_WS2801.h"
+#include "../../Deprecated/Shapes/Shapes.h"
+#include "../../Deprecated/Alphanumeric/Alphanumeric.h"
+#include "../../Deprecated/Compositor/Compositor.h"
+#include "Bench.h"
+
+static Adafruit_WS2801 strip(198, 2, 3, WS2801_RGB, 18, 11);
+static Shapes          shapes(&strip);
+
+// Generators for streaming mode
+static uint32_t gradient(uint32_t n, void *) {
+  return (n * 0x030507) & 0xffffff;
+}
+
+static void rowGradient(uint8_t i, uint32_t *colours, void *arg) {
+  uint8_t w = *(uint8_t *)arg;
+  for(uint8_t j = 0; j < w; j++) colours[j] = ((uint32_t)i << 16) | (j << 8) | (i ^ j);
+}
+
+// Whether two strips' outputs have the same bytes latched
+static bool sameOutput(Adafruit_WS2801 &a, Adafruit_WS2801 &b) {
+  WS2801Capture *x = (WS2801Capture *)a.getOutput(), *y = (WS2801Capture *)b.getOutput();
+  return (x->length() == y->length()) && !memcmp(x->frame(), y->frame(), x->length());
+}
+
+static void clear(void) {
+  for(uint16_t n = 0; n < strip.numPixels(); n++) strip.setPixelColor(n, 0);
+}
+
+// Number of pixels lit by one call of f on a cleared strip.
+template<class F>
+static unsigned long pixelsTouched(F f) {
+  unsigned long lit = 0;
+  clear();
+  f();
+  for(uint16_t n = 0; n < strip.numPixels(); n++) {
+    if(strip.getPixelColor(n) != 0) lit++;
+  }
+  return lit;
+}
+
+template<class F>
+static void report(const char *name, unsigned long pixelsPerCall, F f) {
+  double cps = callsPerSecond(f);
+  printf("%-26s %14.0f pixels/s %14.0f calls/s\n",
+    name, cps * pixelsPerCall, cps);
+}
+
+template<class F>
+static void reportShape(const char *name, F f) {
+  report(name, pixelsTouched(f), f);
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  strip.begin();
+
+  const uint16_t n = strip.numPixels();
+  const uint8_t  w = strip.w(), h = strip.h();
+  uint32_t       c = 0x123456;
+
+  printf("WS2801 host benchmark: %u pixels, %ux%u wall\n\n", n, w, h);
+
+  report("setPixelColor(n,c)", n, [&]() {
+    for(uint16_t i = 0; i < n; i++) strip.setPixelColor(i, c);
+    c++;
+  });
+  report("setPixelColor(n,r,g,b)", n, [&]() {
+    for(uint16_t i = 0; i < n; i++) strip.setPixelColor(i, 1, 2, (uint8_t)c);
+    c++;
+  });
+  report("spc", w * h, [&]() {
+    for(uint8_t i = 0; i < h; i++) {
+      for(uint8_t j = 0; j < w; j++) strip.spc(i, j, c);
+    }
+    c++;
+  });
+  report("gpc", w * h, [&]() {
+    for(uint8_t i = 0; i < h; i++) {
+      for(uint8_t j = 0; j < w; j++) c ^= strip.gpc(i, j);
+    }
+  });
+  report("show (all dirty)", n, [&]() { strip.invalidate(); strip.show(); });
+  report("show (first pixel dirty)", 1, [&]() { strip.setPixelColor(0, c++); strip.show(); });
+  report("show (clean)", 0, [&]() { strip.show(); });
+
+  // Bulk operations, through the grid-to-strand table:
+  static uint32_t frame[256 * 256];
+  static uint8_t  rgb[256 * 256 * 3];
+  report("fillRect (whole wall)", w * h, [&]() { strip.fillRect(0, 0, h - 1, w - 1, c++); });
+  report("setRow", w, [&]() { strip.setRow(c++ % h, frame); });
+  report("blit (whole wall)", w * h, [&]() { strip.blit(frame, 0, 0, w, h); });
+  report("grab (whole wall)", w * h, [&]() { strip.grab(frame, 0, 0, w, h); });
+  report("blitRGB", w * h, [&]() { strip.blitRGB(rgb); });
+  strip.setIndexMap(WS2801SerpentineMap<18, 11>::table);
+  report("blit (fixed map)", w * h, [&]() { strip.blit(frame, 0, 0, w, h); });
+
+  printf("\n");
+  reportShape("Shapes::line",             [&]() { shapes.line(0, 0, h - 1, w - 1, c); });
+  reportShape("Shapes::rectangleFill",    [&]() { shapes.rectangleFill(0, 0, h - 1, w - 1, c); });
+  reportShape("Shapes::rectangleOutline", [&]() { shapes.rectangleOutline(0, 0, h - 1, w - 1, c); });
+  reportShape("Shapes::disk",             [&]() { shapes.disk(h / 2, w / 2, 5, c); });
+  reportShape("Shapes::circle",           [&]() { shapes.circle(h / 2, w / 2, 5, c); });
+  reportShape("Shapes::line (steep)",     [&]() { shapes.line(0, 2, h - 1, 5, c); });
+  reportShape("Shapes::line (clipped)",   [&]() { shapes.line(-20, -10, h + 20, w + 10, c); });
+  reportShape("Shapes::disk (clipped)",   [&]() { shapes.disk(0, 0, 12, c); });
+  reportShape("Shapes::circle (clipped)", [&]() { shapes.circle(h, w / 2, 9, c); });
+
+  // One step of scrolling a glyph across the wall: the old crawl() way
+  // (restore the whole background, redraw), then with a Compositor.
+  printf("\n");
+  Alphanumeric glyph(&strip, (char *)"A", 3, 0, 0x00ff00);
+  static uint32_t background[256 * 256];
+  strip.fillRect(0, 0, h - 1, w - 1, 0x000010);
+  strip.grab(background, 0, 0, w, h);
+  report("Drawable::draw (glyph)", 10, [&]() { glyph.draw(); });
+  report("Drawable::setColour", 10, [&]() { glyph.setColour(c++); });
+  report("crawl step (full redraw)", w * h, [&]() {
+    strip.blit(background, 0, 0, w, h);
+    glyph.draw();
+    glyph.setPosition(3, (glyph.getBasePointX() + 1) % w);
+  });
+  Compositor layers(&strip, 4);
+  layers.captureBackground();
+  layers.addLayer(&glyph);
+  report("Compositor step", 2 * glyph.w() * glyph.h(), [&]() {
+    layers.render();
+    glyph.setPosition(3, (glyph.getBasePointX() + 1) % w);
+  });
+
+  // Streaming mode, per pixel and per row, and on a strand longer than
+  // 16-bit indices reach
+  printf("\n");
+  Adafruit_WS2801 buffered(n, 2, 3, WS2801_RGB, w, h), streamed;
+  uint8_t         width = w;
+  buffered.begin();
+  streamed.begin();
+  for(uint16_t i = 0; i < n; i++) buffered.setPixelColor(i, gradient(i, NULL));
+  buffered.show();
+  streamed.setGenerator(gradient);
+  streamed.updateLength(n);
+  streamed.show();
+  if(!sameOutput(buffered, streamed)) {
+    printf("streamed (pixels): output differs from buffered\n");
+    return 1;
+  }
+  report("show (streamed pixels)", n, [&]() { streamed.show(); });
+
+  for(uint8_t i = 0; i < h; i++) { // The buffered strip drawn a row at a time too
+    rowGradient(i, frame, &width);
+    buffered.setRow(i, frame);
+  }
+  buffered.show();
+  streamed.setRowGenerator(rowGradient, &width);
+  streamed.show();
+  if(!sameOutput(buffered, streamed)) {
+    printf("streamed (rows): output differs from buffered\n");
+    return 1;
+  }
+  report("show (streamed rows)", n, [&]() { streamed.show(); });
+
+  const uint32_t longStrand = 100000;
+  streamed.setGenerator(gradient);
+  streamed.updateLength(longStrand);
+  streamed.show();
+  WS2801Capture *out = (WS2801Capture *)streamed.getOutput();
+  const uint8_t *last = out->frame() + (longStrand - 1) * 3;
+  uint32_t       c1   = gradient(longStrand - 1, NULL);
+  if((out->length() != longStrand * 3) || (last[0] != (uint8_t)(c1 >> 16)) ||
+     (last[1] != (uint8_t)(c1 >> 8)) || (last[2] != (uint8_t)c1)) {
+    printf("streamed (%u pixels): wrong length or last pixel\n", longStrand);
+    return 1;
+  }
+  report("show (streamed, 100k LEDs)", longStrand, [&]() { streamed.show(); });
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+// Host benchmark for the wave equation.  Checks WaveField against the
+// waveEquation sketch's iterate() and writeSerial() (three rotated
+// float[][] boards, one Colour allocated per pixel), both for single
+// steps and for several steps per sweep, and checks the board's 8.8
+// fixed-point WaveEquation stays close to it.  Then reports frames/sec
+// for each on the wall, and cells/sec on a large board, a step per sweep
+// and several.
+//
+// Usage: wavebench [seconds per case]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../../Deprecated/WaveEquation/WaveEquation.h"
+#include "../Sim/WaveField.h"
+#include "Bench.h"
+
+// As the sketch does it, ghost cells and all.
+struct SketchWave {
+  int                              w, h;
+  float                            coef;
+  float                            level;
+  std::vector<std::vector<float> > b0, b1, b2, src;
+  std::vector<std::vector<float> > *wb, *wbc, *wbcp;
+
+  SketchWave(int w, int h, float dt = 0.05f) : w(w), h(h), level(0),
+    b0(w + 2, std::vector<float>(h + 2)), b1(b0), b2(b0), src(b0), wb(&b0), wbc(&b1), wbcp(&b2) {
+    float k = 0.1f, dx = 1.0f / w;
+    coef = k * dt * dt / (dx * dx);
+  }
+
+  void mirror(std::vector<std::vector<float> > &a) {
+    for(int j = 0; j < h + 2; j++) {
+      a[0][j]     = a[2][j];
+      a[w + 1][j] = a[w - 1][j];
+    }
+    for(int i = 0; i < w + 2; i++) {
+      a[i][0]     = a[i][2];
+      a[i][h + 1] = a[i][h - 1];
+    }
+  }
+
+  void drop(float cx, float cy, float sharpness) {
+    float dx = 1.0f / w, dy = 1.0f / h;
+    for(int i = 1; i < w + 1; i++) {
+      for(int j = 1; j < h + 1; j++) {
+        float u = i * dx - cx, v = j * dy - cy;
+        (*wb)[i][j] += expf(-sharpness * (u * u + v * v));
+        (*wbc)[i][j] = (*wb)[i][j];
+      }
+    }
+    mirror(*wb);
+    mirror(*wbc);
+  }
+
+  void iterate(void) {
+    std::vector<std::vector<float> > *t = wbc;
+    wbc  = wbcp;
+    wbcp = t;
+    t    = wb;
+    wb   = wbc;
+    wbc  = t;
+    std::vector<std::vector<float> > &n = *wb, &c = *wbc, &p = *wbcp;
+    for(int i = 1; i < w + 1; i++) {
+      for(int j = 1; j < h + 1; j++) {
+        n[i][j] = 2 * c[i][j] - p[i][j] +
+                  coef * (c[i + 1][j] - 2 * c[i][j] + c[i - 1][j] + c[i][j + 1] - 2 * c[i][j] + c[i][j - 1])
+                  - level * src[i][j];
+      }
+    }
+    mirror(n);
+  }
+
+  struct Colour {
+    int r, g, b;
+    Colour(int r, int g, int b) : r(r), g(g), b(b) {}
+    void scale(float s) { r *= s; g *= s; b *= s; }
+  };
+
+  void writeSerial(uint8_t *rgb, int col) {
+    Colour *c1, *c2;
+    if(col < 85) {
+      c1 = new Colour(col * 3, 255 - col * 3, 0);
+      c2 = new Colour(0, 255 - col * 3, col * 3);
+    } else if(col < 170) {
+      col -= 85;
+      c1 = new Colour(255 - col * 3, 0, col * 3);
+      c2 = new Colour(col * 3, 0, 255 - col * 3);
+    } else {
+      col -= 170;
+      c1 = new Colour(0, col * 3, 255 - col * 3);
+      c2 = new Colour(255 - col * 3, col * 3, 0);
+    }
+    for(int i = 1; i < w + 1; i++) {
+      for(int j = 1; j < h + 1; j++) {
+        float   v = (*wb)[i][j];
+        Colour *c = new Colour(*((v < 0) ? c1 : c2));
+        c->scale(fminf(1.0f, fabsf(v) / 1.5f));
+        int x = i - 1, y = j - 1, n = (y % 2 == 0) ? w * y + x : w * y + (w - 1 - x);
+        rgb[n * 3]     = c->r;
+        rgb[n * 3 + 1] = c->g;
+        rgb[n * 3 + 2] = c->b;
+        delete c;
+      }
+    }
+    delete c1;
+    delete c2;
+  }
+};
+
+static bool same(WaveField &f, SketchWave &s) {
+  for(int y = 0; y < s.h; y++) {
+    for(int x = 0; x < s.w; x++) {
+      if(f.at(x, y) != (*s.wb)[x + 1][y + 1]) return false;
+    }
+  }
+  return true;
+}
+
+// The sketch's dt is only stable up to about 25 columns, so it's scaled
+// down for wider boards.
+static float stableDt(int w) {
+  return (w > 18) ? 0.05f * 18 / w : 0.05f;
+}
+
+// Single steps, then several per sweep, against the sketch; then the
+// rendered frames.
+static bool check(int w, int h, int substeps) {
+  WaveField          field(w, h, 0.1f, stableDt(w));
+  SketchWave         sketch(w, h, stableDt(w));
+  std::vector<float> src(w * h);
+  int                n;
+
+  // A bump, and a source in one corner driven on and off
+  field.drop(0.3f, 0.6f, 50, 1);
+  sketch.drop(0.3f, 0.6f, 50);
+  for(int y = 0; y < h / 4; y++) {
+    for(int x = 0; x < w / 4; x++) src[y * w + x] = sketch.src[x + 1][y + 1] = 1;
+  }
+  field.setSource(&src[0]);
+  for(n = 0; n < 200 && same(field, sketch); n += substeps) {
+    sketch.level = ((n / 20) & 1) ? 0.01f : 0;
+    field.step(substeps, sketch.level);
+    for(int k = 0; k < substeps; k++) sketch.iterate();
+  }
+  bool ok = same(field, sketch);
+
+  std::vector<uint8_t> a(w * h * 3), b(w * h * 3);
+  for(int col = 0; ok && (col < 255); col += 5) {
+    field.render(&a[0], col);
+    sketch.writeSerial(&b[0], col);
+    ok = (a == b);
+  }
+  printf("%3dx%-3d %d step%s per sweep, %3d steps: %s\n", w, h, substeps,
+    substeps > 1 ? "s" : " ", n, ok ? "identical" : "DIFFERENT  <--");
+  return ok;
+}
+
+// The board's fixed-point version should track the floating-point one.
+// Rounding to 8.8 every step adds up (nothing in the scheme damps it),
+// so it drifts slowly; a real mistake shows up within a few steps.
+static bool checkFixed(void) {
+  WaveField    field(18, 11);
+  WaveEquation board(11, 18);
+  float        worst = 0, early = 0;
+
+  field.drop(0.5f, 0.5f, 50, 1);
+  board.drop(0.5f, 0.5f, 50, 1);
+  for(int n = 1; n <= 500; n++) {
+    field.step();
+    board.step();
+    for(int i = 0; i < 11; i++) {
+      for(int j = 0; j < 18; j++) {
+        worst = fmaxf(worst, fabsf(board.get(i, j) / (float)WAVE_ONE - field.at(j, i)));
+      }
+    }
+    if(n == 50) early = worst;
+  }
+  printf("WaveEquation (8.8) vs WaveField: largest error %.3f in 50 steps, %.3f in 500\n",
+    early, worst);
+  return early < 0.1f;
+}
+
+int main(int argc, char **argv) {
+  if(argc > 1) secondsPerCase = atof(argv[1]);
+
+  printf("Wave equation host benchmark\n\n");
+  bool ok = check(18, 11, 1);
+  ok = check(18, 11, 4) && ok;
+  ok = check(97, 61, 3) && ok;
+  ok = check(256, 256, 8) && ok;
+  ok = check(1100, 1000, 5) && ok; // Too big for CACHED_BYTES: one sweep
+  ok = checkFixed() && ok;
+  printf("\n");
+
+  std::vector<uint8_t> rgb(18 * 11 * 3);
+  SketchWave   sketch(18, 11);
+  WaveField    field(18, 11);
+  WaveEquation board(11, 18);
+  int          frame = 0;
+  sketch.drop(0.5f, 0.5f, 50);
+  field.drop(0.5f, 0.5f, 50, 1);
+  board.drop(0.5f, 0.5f, 50, 1);
+  printf("%-40s %12.0f frames/s\n", "18x11 sketch iterate + writeSerial", callsPerSecond([&]() {
+    sketch.iterate();
+    sketch.writeSerial(&rgb[0], (frame++ / 2) % 255);
+  }));
+  printf("%-40s %12.0f frames/s\n", "18x11 WaveField step + render", callsPerSecond([&]() {
+    field.step();
+    field.render(&rgb[0], (frame++ / 2) % 255);
+  }));
+  printf("%-40s %12.0f frames/s\n", "18x11 WaveEquation (8.8) step", callsPerSecond([&]() {
+    board.step();
+  }));
+
+  // Big enough that the two levels don't fit in cache
+  const int W = 4096, H = 4096, S = 8;
+  WaveField big(W, H, 0.1f, stableDt(W));
+  big.drop(0.5f, 0.5f, 50, 1);
+  printf("%-40s %12.0f cells/s\n", "4096x4096, one step per sweep", callsPerSecond([&]() {
+    for(int s = 0; s < S; s++) big.step(1);
+  }) * W * H * S);
+  printf("%-40s %12.0f cells/s\n", "4096x4096, 8 steps per sweep", callsPerSecond([&]() {
+    big.step(S);
+  }) * W * H * S);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#if defined(__x86_64__) || defined(__i386__)
+ #include <immintrin.h>
+ #define HAVE_AVX2_KERNEL
+#endif
+#include "Downsampler.h"
+
+// Sum of 256 pixels, as the sketch does it: R and B accumulate together
+// in one word, G in another.  With exactly 256 samples each sum fits its
+// 16 bits, and the top byte of each is the average.  Returns 0x00RRGGBB.
+static uint32_t sampleScalar(const uint32_t *screen, const int32_t *offs) {
+  uint32_t rb = 0, g = 0, c;
+
+  for(int o = 0; o < 256; o++) {
+    c   = screen[offs[o]];
+    rb += c & 0x00ff00ff;
+    g  += c & 0x0000ff00;
+  }
+  return (rb & 0xff000000) >> 8 | ((g >> 16) & 0xff) << 8 | ((rb >> 8) & 0xff);
+}
+
+#ifdef HAVE_AVX2_KERNEL
+// Same, eight samples per gather.  Each lane sums 32 samples; the lanes
+// are then added up, which still fits every field in its 16 bits.
+__attribute__((target("avx2")))
+static uint32_t sampleAVX2(const uint32_t *screen, const int32_t *offs) {
+  const __m256i rbMask = _mm256_set1_epi32(0x00ff00ff),
+                gMask  = _mm256_set1_epi32(0x0000ff00);
+  __m256i       rb     = _mm256_setzero_si256(),
+                g      = _mm256_setzero_si256();
+
+  for(int o = 0; o < 256; o += 8) {
+    __m256i c = _mm256_i32gather_epi32((const int *)screen,
+      _mm256_loadu_si256((const __m256i *)&offs[o]), 4);
+    rb = _mm256_add_epi32(rb, _mm256_and_si256(c, rbMask));
+    g  = _mm256_add_epi32(g,  _mm256_and_si256(c, gMask));
+  }
+  // Lanes 0-7 of rb, then of g
+  __m128i s = _mm_hadd_epi32(
+    _mm_add_epi32(_mm256_castsi256_si128(rb), _mm256_extracti128_si256(rb, 1)),
+    _mm_add_epi32(_mm256_castsi256_si128(g),  _mm256_extracti128_si256(g, 1)));
+  s = _mm_hadd_epi32(s, s);
+  uint32_t rbSum = _mm_cvtsi128_si32(s), gSum = _mm_extract_epi32(s, 1);
+  return (rbSum & 0xff000000) >> 8 | ((gSum >> 16) & 0xff) << 8 | ((rbSum >> 8) & 0xff);
+}
+#endif
+
+Downsampler::Downsampler(uint32_t screenW, uint32_t screenH, uint16_t gridW,
+  uint16_t gridH, const CaptureLed *l, uint32_t numLEDs, int threads) :
+  leds(numLEDs), offsets(numLEDs * 256), prev(numLEDs * 3, 0),
+  fade(75), minBrightness(120), avx2(false), slices(threads > 1 ? threads : 1),
+  screen(NULL), out(NULL),
+  generation(0), pending(0), stopping(false) {
+  int   x[16], y[16];
+  float range, step, start;
+
+  // Precompute locations of every pixel to read, as the sketch does
+  for(uint32_t i = 0; i < leds; i++) {
+    range = (float)screenW / gridW;
+    step  = range / 16.0f;
+    start = range * l[i].x + step * 0.5f;
+    for(int col = 0; col < 16; col++) x[col] = (int)(start + step * col);
+    range = (float)screenH / gridH;
+    step  = range / 16.0f;
+    start = range * l[i].y + step * 0.5f;
+    for(int row = 0; row < 16; row++) y[row] = (int)(start + step * row);
+    for(int row = 0; row < 16; row++) {
+      for(int col = 0; col < 16; col++) {
+        offsets[i * 256 + row * 16 + col] = y[row] * screenW + x[col];
+      }
+    }
+  }
+
+  setKernel(AUTO);
+  for(uint32_t t = 1; t < slices; t++) workers.push_back(std::thread(&Downsampler::worker, this, t));
+}
+
+Downsampler::~Downsampler(void) {
+  {
+    std::lock_guard<std::mutex> hold(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for(size_t t = 0; t < workers.size(); t++) workers[t].join();
+}
+
+void Downsampler::setKernel(Kernel k) {
+#ifdef HAVE_AVX2_KERNEL
+  avx2 = (k != SCALAR) && __builtin_cpu_supports("avx2");
+#else
+  avx2 = false;
+#endif
+}
+
+void Downsampler::process(const uint32_t *s, uint8_t *rgb) {
+  screen = s;
+  out    = rgb;
+  if(slices > 1) {
+    {
+      std::lock_guard<std::mutex> hold(lock);
+      generation++;
+      pending = workers.size();
+    }
+    wake.notify_all();
+  }
+  run(0, leds / slices); // This thread takes the first slice
+  if(slices > 1) {
+    std::unique_lock<std::mutex> hold(lock);
+    finished.wait(hold, [this]() { return pending == 0; });
+  }
+}
+
+void Downsampler::worker(int slice) {
+  unsigned long seen = 0;
+
+  for(;;) {
+    {
+      std::unique_lock<std::mutex> hold(lock);
+      wake.wait(hold, [&]() { return stopping || (generation != seen); });
+      if(stopping) return;
+      seen = generation;
+    }
+    run((uint64_t)leds * slice / slices, (uint64_t)leds * (slice + 1) / slices);
+    std::lock_guard<std::mutex> hold(lock);
+    if(--pending == 0) finished.notify_one();
+  }
+}
+
+// Sample, blend and boost LEDs first to end - 1.
+void Downsampler::run(uint32_t first, uint32_t end) {
+  const int weight = 257 - fade; // 'Weighting factor' for new frame vs. old
+  int       c[3], sum, deficit, s2;
+
+  for(uint32_t i = first; i < end; i++) {
+    uint32_t avg;
+#ifdef HAVE_AVX2_KERNEL
+    if(avx2) avg = sampleAVX2(screen, &offsets[i * 256]);
+    else
+#endif
+    avg = sampleScalar(screen, &offsets[i * 256]);
+
+    // Blend new pixel value with the value from the prior frame
+    uint8_t *p = &prev[i * 3];
+    c[0] = ((avg >> 16)        * weight + p[0] * fade) >> 8;
+    c[1] = (((avg >> 8) & 0xff) * weight + p[1] * fade) >> 8;
+    c[2] = ((avg & 0xff)       * weight + p[2] * fade) >> 8;
+
+    // Boost pixels that fall below the minimum brightness, spreading the
+    // deficit in proportion to each channel's share of it, so saturated
+    // colours stay saturated
+    sum = c[0] + c[1] + c[2];
+    if(sum < minBrightness) {
+      if(sum == 0) {
+        deficit = minBrightness / 3;
+        c[0] += deficit;
+        c[1] += deficit;
+        c[2] += deficit;
+      } else {
+        deficit = minBrightness - sum;
+        s2      = sum * 2;
+        c[0] += deficit * (sum - c[0]) / s2;
+        c[1] += deficit * (sum - c[1]) / s2;
+        c[2] += deficit * (sum - c[2]) / s2;
+      }
+    }
+
+    for(int k = 0; k < 3; k++) {
+      p[k] = out[i * 3 + k] = (c[k] > 255) ? 255 : c[k];
+    }
+  }
+}
@@ -0,0 +1,73 @@
+// Native version of ModifiedAdalight's downsampling: each LED's colour is
+// the average of 256 points (a 16x16 grid) spread over its cell of the
+// screen, blended with its previous colour (fade) and lifted to a minimum
+// brightness, exactly as draw() does it.
+//
+// Sampling offsets are worked out once, as in the sketch's setup().  Per
+// frame, the 256 reads per LED are done eight at a time with AVX2 gathers
+// where the CPU has them (else one at a time, with the sketch's packed
+// R+B accumulator), and the LEDs are split between worker threads.
+//
+// Screens are 32-bit 0x00RRGGBB pixels, row after row -- what Java's
+// DataBufferInt holds, and what FrameSource.h reads from image files or
+// shared memory.
+
+#ifndef LEDWALL_DOWNSAMPLER_H
+#define LEDWALL_DOWNSAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Grid cell an LED shows, as in ModifiedAdalight's leds[] (one screen).
+struct CaptureLed {
+  uint16_t x, y;
+};
+
+class Downsampler {
+ public:
+  enum Kernel { AUTO, SCALAR, AVX2 };
+
+  // threads includes the caller's own; 1 = no worker threads.
+  Downsampler(uint32_t screenW, uint32_t screenH, uint16_t gridW, uint16_t gridH,
+    const CaptureLed *leds, uint32_t numLEDs, int threads = 1);
+  ~Downsampler(void);
+
+  // Same meaning and defaults as the sketch's settings
+  void setFade(uint8_t f)               { fade = f; }
+  void setMinBrightness(uint16_t m)     { minBrightness = m; }
+  // For benchmarks: force a kernel (AVX2 falls back if unsupported)
+  void setKernel(Kernel k);
+  bool usingAVX2(void) const            { return avx2; }
+
+  // Samples one screenW x screenH frame into rgb (3 bytes per LED, in
+  // leds order).  Returns when all LEDs are done.
+  void process(const uint32_t *screen, uint8_t *rgb);
+
+ private:
+  void run(uint32_t first, uint32_t end);
+  void worker(int slice);
+
+  uint32_t              leds;
+  std::vector<int32_t>  offsets;      // 256 per LED
+  std::vector<uint8_t>  prev;         // Last colours, 3 per LED
+  uint8_t               fade;
+  uint16_t              minBrightness;
+  bool                  avx2;
+  uint32_t              slices;       // Threads sharing each frame
+
+  // Current frame, and the worker threads that share it
+  const uint32_t          *screen;
+  uint8_t                 *out;
+  std::vector<std::thread> workers;
+  std::mutex               lock;
+  std::condition_variable  wake, finished;
+  unsigned long            generation;
+  int                      pending;
+  bool                     stopping;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include "FrameSource.h"
+
+// Skips whitespace and comments between PPM header fields.
+static int ppmField(FILE *f) {
+  int c, v = 0;
+
+  while((c = fgetc(f)) != EOF) {
+    if(c == '#') {
+      while((c = fgetc(f)) != EOF && c != '\n');
+    } else if(c > ' ') {
+      break;
+    }
+  }
+  if((c < '0') || (c > '9')) return -1;
+  while((c >= '0') && (c <= '9')) {
+    v = v * 10 + c - '0';
+    c = fgetc(f);
+  }
+  // c is the single whitespace byte that ends the field
+  return v;
+}
+
+bool readPPM(const char *path, uint32_t &w, uint32_t &h, std::vector<uint32_t> &pixels) {
+  FILE *f = fopen(path, "rb");
+  int   width, height, max;
+  bool  ok = false;
+
+  if(f == NULL) return false;
+  if((fgetc(f) == 'P') && (fgetc(f) == '6') && ((width = ppmField(f)) > 0) &&
+     ((height = ppmField(f)) > 0) && ((max = ppmField(f)) == 255)) {
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    if(fread(&rgb[0], 1, rgb.size(), f) == rgb.size()) {
+      w = width;
+      h = height;
+      pixels.resize((size_t)width * height);
+      for(size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = (uint32_t)rgb[i * 3] << 16 | (uint32_t)rgb[i * 3 + 1] << 8 | rgb[i * 3 + 2];
+      }
+      ok = true;
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+/*****************************************************************************/
+
+struct SharedFrame::Header {
+  char                  magic[4];    // "LWSF"
+  uint32_t              width, height;
+  std::atomic<uint32_t> sequence;
+};
+
+static const char sharedMagic[4] = { 'L', 'W', 'S', 'F' };
+
+SharedFrame::SharedFrame(void) : header(NULL), length(0) {
+  path[0] = 0;
+}
+
+SharedFrame::~SharedFrame(void) {
+  if(header != NULL) munmap(header, length);
+  if(path[0]) shm_unlink(path);
+}
+
+bool SharedFrame::map(int fd, size_t len) {
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED) return false;
+  header = (Header *)p;
+  length = len;
+  return true;
+}
+
+bool SharedFrame::create(const char *name, uint32_t w, uint32_t h) {
+  size_t len = sizeof(Header) + (size_t)w * h * 4;
+  int    fd;
+
+  if(header != NULL) return false;
+  snprintf(path, sizeof(path), "/%s", name);
+  if((fd = shm_open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+    path[0] = 0;
+    return false;
+  }
+  if(ftruncate(fd, len) < 0) {
+    close(fd);
+    fd = -1;
+  }
+  if((fd < 0) || !map(fd, len)) { // map() closes fd either way
+    shm_unlink(path);
+    path[0] = 0;
+    return false;
+  }
+  memcpy(header->magic, sharedMagic, 4);
+  header->width  = w;
+  header->height = h;
+  header->sequence.store(0);
+  return true;
+}
+
+bool SharedFrame::open(const char *name) {
+  char  p[64];
+  int   fd;
+  off_t len;
+
+  if(header != NULL) return false;
+  snprintf(p, sizeof(p), "/%s", name);
+  if((fd = shm_open(p, O_RDWR, 0)) < 0) return false;
+  len = lseek(fd, 0, SEEK_END);
+  if(len < (off_t)sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  if(!map(fd, len)) return false;
+  if((memcmp(header->magic, sharedMagic, 4) != 0) ||
+     (sizeof(Header) + (size_t)header->width * header->height * 4 > length)) {
+    munmap(header, length);
+    header = NULL;
+    return false;
+  }
+  return true;
+}
+
+uint32_t SharedFrame::width(void) const {
+  return header ? header->width : 0;
+}
+
+uint32_t SharedFrame::height(void) const {
+  return header ? header->height : 0;
+}
+
+uint32_t *SharedFrame::pixels(void) {
+  return header ? (uint32_t *)(header + 1) : NULL;
+}
+
+uint32_t SharedFrame::sequence(void) const {
+  return header ? header->sequence.load(std::memory_order_acquire) : 0;
+}
+
+void SharedFrame::publish(void) {
+  if(header) header->sequence.fetch_add(1, std::memory_order_release);
+}
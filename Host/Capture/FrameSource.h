@@ -0,0 +1,49 @@
+// Screens for the Downsampler from somewhere other than a live screen
+// capture, so it can run (and be tested) headless: image files, or a
+// frame buffer in shared memory that another process -- a capture tool,
+// a video player, a test -- draws into.
+//
+// Pixels are 32-bit 0x00RRGGBB, row after row.
+
+#ifndef LEDWALL_FRAMESOURCE_H
+#define LEDWALL_FRAMESOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Reads a binary PPM (P6, 8 bits per channel).  False if it can't.
+bool readPPM(const char *path, uint32_t &w, uint32_t &h, std::vector<uint32_t> &pixels);
+
+// Frame buffer in POSIX shared memory (/dev/shm/<name> on Linux): a small
+// header then the pixels.  The writer draws straight into pixels() and
+// calls publish() after each frame; readers poll sequence() to see when
+// there's a new one.  Readers don't lock: a frame may be read while the
+// next is being drawn, which for ambient lighting is harmless.
+class SharedFrame {
+ public:
+  SharedFrame(void);
+  ~SharedFrame(void);
+
+  // Writer side: makes (or resizes) the buffer; removed again on exit
+  bool create(const char *name, uint32_t w, uint32_t h);
+  // Reader side
+  bool open(const char *name);
+
+  uint32_t  width(void) const;
+  uint32_t  height(void) const;
+  uint32_t *pixels(void);
+  uint32_t  sequence(void) const;
+  void      publish(void);
+
+ private:
+  struct Header;
+
+  bool map(int fd, size_t len);
+
+  Header *header;
+  size_t  length;
+  char    path[64];      // Set if this end created the buffer
+};
+
+#endif
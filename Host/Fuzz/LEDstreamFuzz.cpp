@@ -0,0 +1,401 @@
+// Randomised test of the LEDstream framing state machine.  Feeds it
+// streams of plain, delta, staged and palette frames and latch commands, mixed
+// with the things a real serial line produces -- bad checksums, partial
+// magic words, stray bytes and input that stalls in mid-frame -- and
+// checks that exactly the intact frames come out over "SPI", in order,
+// with the right contents.  Telemetry requests come in among the frames;
+// every packet sent back must be well formed, and the counters must
+// account for every frame latched, bad checksum and byte skipped.
+//
+// Usage: ledstreamfuzz [streams]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../../LEDstream/LEDstreamCore.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+// Simulated time: every call moves the clock on a microsecond, so waits
+// inside the state machine end.
+class FakeClock {
+ public:
+  unsigned long us;
+  FakeClock() : us(0) {}
+  unsigned long micros(void) { return us++; }
+  unsigned long millis(void) { return us / 1000; }
+};
+
+// Serial input that comes in bursts and runs dry now and then.
+class FuzzSource {
+ public:
+  Bytes       in;
+  size_t      pos;
+  int         stall;
+  std::string out;
+  FuzzSource() : pos(0), stall(0) {}
+  // Hands over a random part of what was asked for, as serial data
+  // arrives in packets of any size
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    if(stall > 0) { stall--; return 0; }
+    if(pos >= in.size()) return 0;
+    if(rand() % 16 == 0) stall = rand() % 400; // Underrun
+    uint16_t n = 1 + rand() % ((rand() % 4 == 0) ? len : (len < 8 ? len : 8));
+    if(n > in.size() - pos) n = in.size() - pos;
+    memcpy(buf, &in[pos], n);
+    pos += n;
+    return n;
+  }
+  void write(const uint8_t *data, uint8_t len) { out.append((const char *)data, len); }
+};
+
+// SPI output, split into frames at each latch.
+class FuzzSink {
+ public:
+  Bytes              current;
+  std::vector<Bytes> frames;
+  bool ready(void) { return rand() % 4 != 0; }
+  void write(uint8_t b) { current.push_back(b); }
+  void indicator(bool on) {
+    if(on) {
+      frames.push_back(current);
+      current.clear();
+    }
+  }
+};
+
+// A byte that can't start a magic word, for filler that must not sync.
+static uint8_t junk(void) {
+  uint8_t b;
+  do b = rand(); while(b == magic[0]);
+  return b;
+}
+
+static void header(Bytes &s, uint8_t type, uint16_t count) {
+  uint8_t hi = count >> 8, lo = count;
+  s.push_back(magic[0]);
+  s.push_back(magic[1]);
+  s.push_back(type);
+  s.push_back(hi);
+  s.push_back(lo);
+  s.push_back(hi ^ lo ^ 0x55);
+}
+
+// Builds one random stream and the frames it should produce, and what
+// the telemetry counters should say about it.
+struct Scenario {
+  Bytes              stream;
+  std::vector<Bytes> expected;
+  uint8_t            resident[FRAMESIZE];
+  uint16_t           residentBytes;
+  uint32_t           badChecksums, skipped;
+
+  Scenario() : residentBytes(0), badChecksums(0), skipped(0) {
+    memset(resident, 0, sizeof(resident));
+  }
+
+  void plainFrame(void) {
+    uint16_t leds = 1 + rand() % (MAXLEDS + 50);
+    Bytes    data(leds * 3);
+    for(size_t k = 0; k < data.size(); k++) data[k] = rand();
+    header(stream, magic[2], leds - 1);
+    stream.insert(stream.end(), data.begin(), data.end());
+    expected.push_back(data);
+    residentBytes = (data.size() < FRAMESIZE) ? data.size() : FRAMESIZE;
+    memcpy(resident, &data[0], residentBytes);
+  }
+
+  // Palette frame of up to 16 colours (4-bit indices) or up to 256
+  void paletteFrame(void) {
+    uint16_t leds    = 1 + rand() % (MAXLEDS + 50);
+    int      colours = 1 + ((rand() % 2) ? rand() % 16 : rand() % 256);
+    Bytes    palette(colours * 3), payload, data(leds * 3);
+    for(size_t k = 0; k < palette.size(); k++) palette[k] = rand();
+    payload.push_back((leds - 1) >> 8);
+    payload.push_back(leds - 1);
+    payload.push_back(colours - 1);
+    payload.insert(payload.end(), palette.begin(), palette.end());
+    for(uint16_t k = 0; k < leds; k++) {
+      int i = rand() % colours;
+      memcpy(&data[k * 3], &palette[i * 3], 3);
+      if(colours > 16)  payload.push_back(i);
+      else if(k & 1)    payload.back() |= i;
+      else              payload.push_back(i << 4);
+    }
+    header(stream, paletteMagic, payload.size());
+    stream.insert(stream.end(), payload.begin(), payload.end());
+    expected.push_back(data);
+    residentBytes = (data.size() < FRAMESIZE) ? data.size() : FRAMESIZE;
+    memcpy(resident, &data[0], residentBytes);
+  }
+
+  // Palette frame whose payload size is wrong: ignored, and all of it
+  // skipped
+  void badPaletteFrame(void) {
+    uint16_t leds    = 1 + rand() % 100;
+    int      colours = 1 + rand() % 40;
+    size_t   size    = 3 + colours * 3 + ((colours > 16) ? leds : (leds + 1) / 2);
+    size_t   wrong   = size + ((rand() % 2) ? 1 + rand() % 3 : -(1 + rand() % 3));
+    header(stream, paletteMagic, wrong);
+    stream.push_back((leds - 1) >> 8);
+    stream.push_back(leds - 1);
+    stream.push_back(colours - 1);
+    filler(size - 3);
+    skipped += 3;
+  }
+
+  // Delta frame, or (staged) the same but held until a latch command
+  void deltaFrame(bool staged) {
+    Bytes payload;
+    int   records = rand() % 6;
+    for(int r = 0; r < records; r++) {
+      uint16_t start = rand() % (MAXLEDS + 10);
+      uint8_t  count = rand() % 32;                 // LEDs - 1
+      uint16_t pos   = (start < MAXLEDS) ? start * 3 : FRAMESIZE;
+      payload.push_back(start >> 8);
+      payload.push_back(start);
+      payload.push_back(count);
+      for(int k = 0; k < 3 * (count + 1); k++) {
+        uint8_t b = rand();
+        payload.push_back(b);
+        if(pos < FRAMESIZE) {
+          resident[pos++] = b;
+          if(pos > residentBytes) residentBytes = pos;
+        } else {
+          skipped++;                                // Past the resident frame
+        }
+      }
+    }
+    // Sometimes a stub too short to be a record, which is ignored
+    if(rand() % 4 == 0) {
+      int extra = 1 + rand() % 2;
+      skipped += extra;                             // Searched for a header
+      while(extra--) payload.push_back(junk());
+    }
+    header(stream, staged ? stageMagic : deltaMagic, payload.size());
+    stream.insert(stream.end(), payload.begin(), payload.end());
+    if(!staged) latched();
+  }
+
+  void latch(void) {
+    header(stream, latchMagic, 0);
+    latched();
+  }
+
+  void latched(void) {
+    expected.push_back(Bytes(resident, resident + residentBytes));
+  }
+
+  // Magic word with a wrong checksum, then a little filler
+  void badChecksum(void) {
+    uint8_t hi = junk(), lo = junk(), chk;
+    do chk = junk(); while(chk == (hi ^ lo ^ 0x55));
+    stream.push_back(magic[0]);
+    stream.push_back(magic[1]);
+    static const uint8_t types[] = { magic[2], deltaMagic, stageMagic, latchMagic,
+      telemetryMagic, paletteMagic };
+    stream.push_back(types[rand() % 6]);
+    stream.push_back(hi);
+    stream.push_back(lo);
+    stream.push_back(chk);
+    badChecksums++;
+    skipped += HEADERSIZE;
+    filler(rand() % 20);
+  }
+
+  // The start of a magic word that goes wrong (and can't go right by
+  // chance, so the counts stay exact)
+  void partialMagic(void) {
+    int     n = 1 + rand() % (MAGICSIZE - 1);
+    uint8_t b;
+    for(int k = 0; k < n; k++) stream.push_back(magic[k]);
+    do b = junk(); while((b == magic[n]) || (b == deltaMagic) || (b == stageMagic) ||
+      (b == latchMagic) || (b == telemetryMagic) || (b == paletteMagic));
+    stream.push_back(b);
+    skipped += n + 1;
+    filler(rand() % 8);
+  }
+
+  // Asks for a report now, and maybe every few milliseconds after
+  void telemetryRequest(void) {
+    header(stream, telemetryMagic, (rand() % 3) ? 1 + rand() % 20 : 0);
+  }
+
+  void filler(int n) {
+    skipped += n;
+    while(n--) stream.push_back(junk());
+  }
+};
+
+static uint32_t get32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Splits what the core sent back into ACKs and telemetry packets; false
+// if anything else turns up, or a packet is damaged or goes backwards.
+static bool readReplies(const std::string &out, std::vector<LEDstreamCounters> &reports,
+  unsigned seed) {
+  const uint8_t *p = (const uint8_t *)out.data(), *end = p + out.size();
+  while(p < end) {
+    if((end - p >= 4) && !memcmp(p, "Ada\n", 4)) {
+      p += 4;
+      continue;
+    }
+    const size_t size = 4 * TELEMETRYSIZE;
+    if((end - p < (long)(size + 5)) || memcmp(p, telemetryReply, MAGICSIZE) || (p[3] != size)) {
+      printf("seed %u: stray bytes from the board\n", seed);
+      return false;
+    }
+    uint8_t chk = 0x55;
+    for(size_t k = 0; k < size; k++) chk ^= p[4 + k];
+    if(chk != p[4 + size]) {
+      printf("seed %u: telemetry checksum wrong\n", seed);
+      return false;
+    }
+    uint32_t c[TELEMETRYSIZE];
+    for(int k = 0; k < TELEMETRYSIZE; k++) c[k] = get32(p + 4 + 4 * k);
+    reports.push_back(LEDstreamCounters());
+    memcpy(&reports.back(), c, sizeof(c));
+    if(reports.size() > 1) {
+      for(int k = 0; k < TELEMETRYSIZE; k++) {
+        uint32_t before;
+        memcpy(&before, (const uint8_t *)&reports[reports.size() - 2] + 4 * k, 4);
+        if(c[k] < before) {
+          printf("seed %u: telemetry counter %d went backwards\n", seed, k);
+          return false;
+        }
+      }
+    }
+    p += size + 5;
+  }
+  return true;
+}
+
+template<uint16_t RingSize>
+static bool runStream(unsigned seed) {
+  typedef LEDstreamCore<FuzzSource, FuzzSink, FakeClock, RingSize> Core;
+  Scenario   sc;
+  FuzzSource source;
+  FuzzSink   sink;
+  FakeClock  clock;
+
+  srand(seed);
+  int events = 1 + rand() % 40;
+  for(int e = 0; e < events; e++) {
+    if(rand() % 16 == 0) sc.telemetryRequest();
+    switch(rand() % 10) {
+     case 0: case 1: sc.plainFrame();           break;
+     case 2:         sc.deltaFrame(false);      break;
+     case 3:         sc.deltaFrame(true);       break;
+     case 4:         sc.latch();                break;
+     case 5:         sc.badChecksum();          break;
+     case 6:         sc.partialMagic();         break;
+     case 7:         sc.filler(rand() % 300);   break;
+     case 8:         sc.paletteFrame();         break;
+     case 9:         sc.badPaletteFrame();      break;
+    }
+  }
+  source.in = sc.stream;
+
+  Core *core = new Core(source, sink, clock); // Buffers can be large; keep them off the stack
+  core->begin();
+  // Run until all input is taken and the last frame has had time to go out
+  unsigned long quiet = 0;
+  while(quiet < 20000) {
+    core->poll();
+    clock.us++;
+    quiet = (source.pos < source.in.size() || source.stall) ? 0 : quiet + 1;
+  }
+
+  bool ok = (sink.frames.size() == sc.expected.size());
+  for(size_t f = 0; ok && f < sink.frames.size(); f++) {
+    if(sink.frames[f] != sc.expected[f]) {
+      const Bytes &got = sink.frames[f], &want = sc.expected[f];
+      size_t k = 0, common = std::min(got.size(), want.size());
+      while((k < common) && (got[k] == want[k])) k++; // Or one is a prefix of the other
+      printf("seed %u: frame %zu differs at byte %zu (%zu bytes, expected %zu)\n",
+        seed, f, k, sink.frames[f].size(), sc.expected[f].size());
+      ok = false;
+    }
+  }
+  if(sink.frames.size() != sc.expected.size()) {
+    printf("seed %u: %zu frames, expected %zu\n",
+      seed, sink.frames.size(), sc.expected.size());
+  }
+  if(ok && !sink.current.empty()) {
+    printf("seed %u: %zu bytes sent after the last latch\n", seed, sink.current.size());
+    ok = false;
+  }
+  if(ok && source.out.compare(0, 4, "Ada\n") != 0) {
+    printf("seed %u: no ACK at start\n", seed);
+    ok = false;
+  }
+
+  // Ask for a last report (and no more after it): the counters must
+  // account for all of the stream
+  if(ok) {
+    size_t before = source.out.size();
+    header(source.in, telemetryMagic, 0);
+    for(int n = 0; n < 100; n++) {
+      core->poll();
+      if(source.pos < source.in.size() || source.stall) n = 0;
+    }
+    std::vector<LEDstreamCounters> reports;
+    ok = readReplies(source.out, reports, seed);
+    if(ok && ((source.out.size() == before) || reports.empty())) {
+      printf("seed %u: no telemetry on request\n", seed);
+      ok = false;
+    }
+    if(ok) {
+      const LEDstreamCounters &c = reports.back();
+      if((c.received != source.in.size()) || (c.latched != sc.expected.size()) ||
+         (c.badChecksums != sc.badChecksums) || (c.skipped != sc.skipped) ||
+         (c.holdMicros < 100UL * c.holds)) {
+        printf("seed %u: telemetry says %u bytes, %u latched, %u bad, %u skipped, %u holds"
+          " (%u us); expected %zu, %zu, %u, %u\n", seed, c.received, c.latched,
+          c.badChecksums, c.skipped, c.holds, c.holdMicros, source.in.size(),
+          sc.expected.size(), sc.badChecksums, sc.skipped);
+        ok = false;
+      }
+    }
+  }
+
+  // Fall silent: ACKs should keep coming, and after the timeout the
+  // LEDs are turned off
+  if(ok) {
+    size_t acks = source.out.size();
+    unsigned long until = clock.us + (serialTimeout + 500) * 1000;
+    while(clock.us < until) {
+      core->poll();
+      clock.us += 50;
+    }
+    if(source.out.size() - acks < 4 * (serialTimeout / 1000 - 1)) {
+      printf("seed %u: only %zu ACK bytes while idle\n", seed, source.out.size() - acks);
+      ok = false;
+    }
+    if(sink.current.size() != 32767 ||
+       memcmp(&sink.current[0], Bytes(32767, 0).data(), 32767) != 0) {
+      printf("seed %u: no blackout after timeout\n", seed);
+      ok = false;
+    }
+  }
+
+  delete core;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  unsigned streams = (argc > 1) ? atoi(argv[1]) : 200, failed = 0;
+
+  for(unsigned s = 1; s <= streams; s++) {
+    // Small, standard and large receive buffers
+    if(!runStream<64>(s))   { printf("  (64-byte ring)\n");   failed++; }
+    if(!runStream<256>(s))  { printf("  (256-byte ring)\n");  failed++; }
+    if(!runStream<2048>(s)) { printf("  (2048-byte ring)\n"); failed++; }
+  }
+  printf("LEDstream fuzz: %u streams x 3 buffer sizes, %u failed\n", streams, failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+// Randomised test of frame recordings.  Records streams of frames that
+// change the way a wall's do -- a few pixels, the whole frame, solid
+// fills, not at all -- raw and compressed, with keyframes near and far
+// apart, and checks that replay gives back every frame and its time,
+// in order and from anywhere.  Then:
+//
+//   - recordings cut short anywhere (the recorder killed mid-write, or
+//     the file truncated) must still give back every frame written in
+//     full before the cut, and nothing else;
+//   - a WallStream recording what it sends must record exactly the
+//     frames shown.
+//
+// Usage: recordingfuzz [recordings]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "../Stream/FrameRecording.h"
+#include "../Stream/WallStream.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static void nextFrame(Bytes &f) {
+  int    kind = rand() % 10;
+  size_t n    = f.size() / 3;
+
+  if(kind == 0) {                // Everything
+    for(size_t k = 0; k < f.size(); k++) f[k] = rand();
+  } else if(kind == 1) {         // One colour
+    uint32_t c = rand() & 0xffffff;
+    for(size_t k = 0; k < n; k++) {
+      f[k * 3] = c >> 16; f[k * 3 + 1] = c >> 8; f[k * 3 + 2] = c;
+    }
+  } else if(kind == 2) {         // Nothing
+  } else {                       // A few pixels, or a stretch of them
+    int changes = 1 + rand() % 12;
+    while(changes--) {
+      size_t at = rand() % n, len = (rand() % 4) ? 1 : 1 + rand() % 40;
+      for(size_t k = at; (k < at + len) && (k < n); k++) {
+        f[k * 3] = rand(); f[k * 3 + 1] = rand(); f[k * 3 + 2] = rand();
+      }
+    }
+  }
+}
+
+// Replays path and checks it holds the first count of frames and times
+static bool check(const char *path, const std::vector<Bytes> &frames,
+  const std::vector<uint64_t> &times, size_t count, const char *what) {
+  FrameReplay replay;
+
+  if(!replay.open(path)) {
+    printf("%s: won't open\n", what);
+    return false;
+  }
+  if(replay.frames() != count) {
+    printf("%s: %u frames, expected %zu\n", what, replay.frames(), count);
+    return false;
+  }
+  for(uint32_t n = 0; n < count; n++) {
+    const uint8_t *f = replay.frame(n);
+    if(!f || memcmp(f, &frames[n][0], frames[n].size()) || (replay.time(n) != times[n])) {
+      printf("%s: frame %u of %zu differs, in order\n", what, n, count);
+      return false;
+    }
+  }
+  for(int k = 0; (k < 200) && count; k++) {
+    uint32_t       n = rand() % count;
+    const uint8_t *f = replay.frame(n);
+    if(!f || memcmp(f, &frames[n][0], frames[n].size())) {
+      printf("%s: frame %u of %zu differs, out of order\n", what, n, count);
+      return false;
+    }
+  }
+  // play() hands them over in order, all of them
+  uint32_t next = 0;
+  bool     ok   = true;
+  replay.play([&](const uint8_t *rgb, size_t len, uint32_t n) {
+    ok = ok && (n == next++) && (len == frames[n].size()) && !memcmp(rgb, &frames[n][0], len);
+    return true;
+  }, 0);
+  if(!ok || (next != count)) {
+    printf("%s: play() differs\n", what);
+    return false;
+  }
+  return true;
+}
+
+static bool runRecording(unsigned seed, const char *path) {
+  srand(seed);
+  uint32_t              leds      = 1 + rand() % 400;
+  bool                  compress  = rand() % 4 != 0;
+  int                   keyframes = 1 + rand() % 100;
+  size_t                count     = rand() % 300;
+  std::vector<Bytes>    frames;
+  std::vector<uint64_t> times, ends;
+  Bytes                 f(leds * 3, 0);
+  uint64_t              t = 0;
+  FrameRecorder         rec;
+
+  if(!rec.create(path, leds, compress, keyframes)) {
+    perror(path);
+    return false;
+  }
+  for(size_t k = 0; k < count; k++) {
+    nextFrame(f);
+    t += rand() % 50000;
+    frames.push_back(f);
+    times.push_back(t);
+    rec.add(&f[0], f.size(), t);
+    ends.push_back(rec.bytes());
+  }
+  Bytes wrong(leds * 3 + 3, 0);
+  if(rec.add(&wrong[0], wrong.size(), t)) {
+    printf("Seed %u: frame of the wrong size recorded\n", seed);
+    return false;
+  }
+  if(!rec.close()) {
+    perror(path);
+    return false;
+  }
+  char what[64];
+  snprintf(what, sizeof(what), "Seed %u (%u LEDs, %s)", seed, leds, compress ? "compressed" : "raw");
+  if(!check(path, frames, times, count, what)) return false;
+
+  // Cut short: whole frames before the cut survive
+  FILE *in = fopen(path, "rb");
+  Bytes all;
+  int   b;
+  while((b = fgetc(in)) != EOF) all.push_back(b);
+  fclose(in);
+  for(int k = 0; k < 4; k++) {
+    Bytes  file = all;
+    size_t cut  = 32 + rand() % (all.size() - 31);
+    if(k == 0) memset(&file[12], 0, 12);  // As if never closed
+    FILE *out = fopen(path, "wb");
+    fwrite(&file[0], 1, cut, out);
+    fclose(out);
+    size_t whole = 0;
+    while((whole < count) && (ends[whole] <= cut)) whole++;
+    snprintf(what, sizeof(what), "Seed %u cut at %zu of %zu", seed, cut, all.size());
+    if(!check(path, frames, times, whole, what)) return false;
+  }
+  return true;
+}
+
+// WallStream's writer records what it sends; with room in the queue for
+// every frame, that's every frame shown.
+static bool runStream(const char *path) {
+  const uint16_t        W = 18, H = 11;
+  WallStream            stream(W * H, 400);
+  FrameRecorder         rec;
+  std::vector<Bytes>    frames;
+  Bytes                 f(W * H * 3, 0);
+
+  rec.create(path, W * H);
+  stream.record(&rec);
+  if(!stream.open("/dev/null")) {
+    perror("/dev/null");
+    return false;
+  }
+  for(int k = 0; k < 400; k++) {
+    nextFrame(f);
+    frames.push_back(f);
+    stream.show(&f[0], f.size());
+  }
+  stream.close(false);
+  rec.close();
+
+  FrameReplay replay;
+  bool        ok = replay.open(path) && (replay.frames() == frames.size());
+  for(uint32_t n = 0; ok && (n < replay.frames()); n++) {
+    ok = !memcmp(replay.frame(n), &frames[n][0], frames[n].size()) &&
+         ((n == 0) || (replay.time(n) >= replay.time(n - 1)));
+  }
+  printf("WallStream recording, %u of %zu frames: %s\n", replay.frames(), frames.size(),
+    ok ? "intact" : "WRONG  <--");
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int  recordings = (argc > 1) ? atoi(argv[1]) : 300;
+  char path[]     = "/tmp/recordingfuzz-XXXXXX";
+  int  fd         = mkstemp(path);
+  int  failed     = 0;
+
+  if(fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+  for(int s = 1; s <= recordings; s++) {
+    if(!runRecording(s, path) && (++failed >= 10)) break;
+  }
+  printf("%d recordings, %d failed\n", recordings, failed);
+  if(!runStream(path)) failed++;
+  unlink(path);
+  return failed ? 1 : 0;
+}
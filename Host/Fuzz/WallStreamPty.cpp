@@ -0,0 +1,409 @@
+// End-to-end test of WallStream through a pseudo-terminal.  The stream
+// writes to the pty's slave side as it would to a board's serial port; the
+// master side is read back and decoded by LEDstream's own state machine,
+// and the frames that come out over "SPI" are checked against those shown.
+//
+//   - reading as fast as frames are shown, every frame (full or delta)
+//     must come out intact and in order;
+//   - with the reader stalled, show() must not wait for the port, frames
+//     must be dropped rather than queued, and those that do come out must
+//     be in order and end with the newest;
+//   - closing the stream blanks the wall, even straight after a show(),
+//     without dropping the frame shown;
+//   - frames of a few colours go as palette frames (4- and 8-bit
+//     indices) and come out exactly as shown;
+//   - a wall longer than the board's resident frame gets no delta
+//     frames, so LEDs past it come out right too;
+//   - telemetry asked for through the stream comes back through the pty,
+//     and accounts for every byte and frame.
+//
+// Usage: wallstreampty [frames]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "../../LEDstream/LEDstreamCore.h"
+#include "../Stream/WallStream.h"
+
+typedef std::vector<uint8_t>         Bytes;
+typedef std::chrono::steady_clock    Time;
+
+// Real time, as LEDstream's latch and timeouts are checked against it.
+class WallClock {
+ public:
+  Time::time_point start;
+  WallClock() : start(Time::now()) {}
+  unsigned long micros(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Time::now() - start).count();
+  }
+  unsigned long millis(void) { return micros() / 1000; }
+};
+
+class PtySource {
+ public:
+  int fd;
+  PtySource() : fd(-1) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    ssize_t n = ::read(fd, buf, len);
+    return (n > 0) ? n : 0;
+  }
+  // ACKs and telemetry go back to the stream
+  void write(const uint8_t *data, uint8_t len) {
+    if(::write(fd, data, len) < 0) perror("pty");
+  }
+};
+
+// SPI output, split into frames at each latch.
+class FrameSink {
+ public:
+  Bytes              current;
+  std::vector<Bytes> frames;
+  bool ready(void) { return true; }
+  void write(uint8_t b) { current.push_back(b); }
+  void indicator(bool on) {
+    if(on) {
+      frames.push_back(current);
+      current.clear();
+    }
+  }
+};
+
+typedef LEDstreamCore<PtySource, FrameSink, WallClock> Core;
+
+// The board end of the pty.
+struct Board {
+  PtySource source;
+  FrameSink sink;
+  WallClock clock;
+  Core      core;
+  int       slave;             // Held open so the pty outlives the stream's end
+  char      path[64];
+
+  Board() : core(source, sink, clock) {
+    source.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if((source.fd < 0) || grantpt(source.fd) || unlockpt(source.fd)) {
+      perror("posix_openpt");
+      exit(1);
+    }
+    strncpy(path, ptsname(source.fd), sizeof(path) - 1);
+    path[sizeof(path) - 1] = 0;
+    slave = open(path, O_RDWR | O_NOCTTY);
+    // Raw from the start, or the first ACK is echoed back as data
+    struct termios tio;
+    if(tcgetattr(slave, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(slave, TCSANOW, &tio);
+    }
+    core.begin();
+  }
+  ~Board() {
+    close(slave);
+    close(source.fd);
+  }
+
+  // Run the state machine until n frames are out, or for at most ms.
+  bool runUntil(size_t n, unsigned long ms) {
+    unsigned long until = clock.millis() + ms;
+    while((sink.frames.size() < n) && (clock.millis() < until)) core.poll();
+    return sink.frames.size() >= n;
+  }
+  // Run the state machine until nothing has come out for ms.
+  void drain(unsigned long ms) {
+    size_t        seen  = sink.frames.size();
+    unsigned long quiet = clock.millis();
+    while(clock.millis() - quiet < ms) {
+      core.poll();
+      if(sink.frames.size() != seen) {
+        seen  = sink.frames.size();
+        quiet = clock.millis();
+      }
+    }
+  }
+};
+
+static const uint16_t W = 18, H = 11;
+
+// A frame that differs from the last in a few pixels, or now and then
+// everywhere.
+static void nextFrame(WallFrame &f) {
+  if(rand() % 8 == 0) {
+    for(uint32_t n = 0; n < f.numPixels(); n++) f.setPixelColor(n, rand() & 0xffffff);
+  } else {
+    int changes = 1 + rand() % 12;
+    while(changes--) f.spc(rand() % W, rand() % H, rand() & 0xffffff);
+  }
+}
+
+static bool same(const Bytes &got, const WallFrame &f) {
+  return (got.size() == f.size()) && (memcmp(&got[0], f.data(), f.size()) == 0);
+}
+
+static bool inStep(int frames) {
+  Board      board;
+  WallStream stream(W * H);
+  WallFrame  frame(W, H);
+
+  if(!stream.open(board.path)) {
+    printf("in step: can't open %s\n", board.path);
+    return false;
+  }
+  for(int i = 0; i < frames; i++) {
+    nextFrame(frame);
+    stream.show(frame);
+    if(!board.runUntil(i + 1, 2000)) {
+      printf("in step: frame %d never arrived\n", i);
+      return false;
+    }
+    if(!same(board.sink.frames[i], frame)) {
+      printf("in step: frame %d differs\n", i);
+      return false;
+    }
+  }
+  stream.close(true);
+  board.drain(100);
+
+  WallStream::Stats s = stream.stats();
+  bool ok = true;
+  if((s.dropped != 0) || (s.sent != (unsigned long)frames + 1) || (s.deltas == 0)) {
+    printf("in step: %lu shown, %lu sent, %lu dropped, %lu deltas\n",
+      s.shown, s.sent, s.dropped, s.deltas);
+    ok = false;
+  }
+  frame.fill(0);
+  if((board.sink.frames.size() != (size_t)frames + 1) || !same(board.sink.frames.back(), frame)) {
+    printf("in step: wall not blanked on close\n");
+    ok = false;
+  }
+  printf("in step: %d frames, %lu as deltas, %.0f bytes/frame\n",
+    frames, s.deltas, (double)s.bytes / s.sent);
+  return ok;
+}
+
+// As in step, but every frame drawn from a few colours, as Life or the
+// equalizer would, and changing all over often enough that palette frames
+// beat deltas.
+static bool fewColours(int frames, unsigned colours, unsigned maxColours) {
+  Board                 board;
+  WallStream            stream(W * H);
+  WallFrame             frame(W, H);
+  std::vector<uint32_t> pick(colours);
+  char                  name[32];
+
+  snprintf(name, sizeof(name), "%u colours", colours);
+  for(unsigned c = 0; c < colours; c++) pick[c] = rand() & 0xffffff;
+  stream.setIndexedFrames(true, maxColours);
+  if(!stream.open(board.path)) {
+    printf("%s: can't open %s\n", name, board.path);
+    return false;
+  }
+  for(int i = 0; i < frames; i++) {
+    int changes = (rand() % 3) ? W * H : 1 + rand() % 12;
+    while(changes--) frame.setPixelColor(rand() % (W * H), pick[rand() % colours]);
+    stream.show(frame);
+    if(!board.runUntil(i + 1, 2000)) {
+      printf("%s: frame %d never arrived\n", name, i);
+      return false;
+    }
+    if(!same(board.sink.frames[i], frame)) {
+      printf("%s: frame %d differs\n", name, i);
+      return false;
+    }
+  }
+  stream.close(false);
+
+  WallStream::Stats s = stream.stats();
+  bool ok = true;
+  if((s.dropped != 0) || (s.sent != (unsigned long)frames) || (s.indexed == 0)) {
+    printf("%s: %lu shown, %lu sent, %lu dropped, %lu as palette frames\n",
+      name, s.shown, s.sent, s.dropped, s.indexed);
+    ok = false;
+  }
+  printf("%s: %d frames, %lu as deltas, %lu as palette frames, %.0f bytes/frame\n",
+    name, frames, s.deltas, s.indexed, (double)s.bytes / s.sent);
+  return ok;
+}
+
+// A wall of more LEDs than the board keeps for delta frames (MAXLEDS),
+// changing a few LEDs at a time: every frame must still come out whole.
+static bool bigWall(int frames) {
+  const uint16_t w = 25, h = 12;
+  Board      board;
+  WallStream stream(w * h);
+  WallFrame  frame(w, h);
+
+  if(!stream.open(board.path)) {
+    printf("big wall: can't open %s\n", board.path);
+    return false;
+  }
+  for(int i = 0; i < frames; i++) {
+    int changes = 1 + rand() % 12;
+    while(changes--) frame.spc(rand() % w, rand() % h, rand() & 0xffffff);
+    stream.show(frame);
+    if(!board.runUntil(i + 1, 2000)) {
+      printf("big wall: frame %d never arrived\n", i);
+      return false;
+    }
+    if(!same(board.sink.frames[i], frame)) {
+      printf("big wall: frame %d differs\n", i);
+      return false;
+    }
+  }
+  stream.close(false);
+
+  WallStream::Stats s = stream.stats();
+  if((s.sent != (unsigned long)frames) || (s.deltas != 0)) {
+    printf("big wall: %lu sent, %lu deltas\n", s.sent, s.deltas);
+    return false;
+  }
+  printf("big wall: %d frames of %d LEDs, none as deltas\n", frames, w * h);
+  return true;
+}
+
+// Show a frame and close at once, over and over: the frame must still
+// go out, then the blank one.
+static bool closing(int times) {
+  WallFrame frame(W, H), off(W, H);
+
+  for(int t = 0; t < times; t++) {
+    Board      board;
+    WallStream stream(W * H);
+    if(!stream.open(board.path)) {
+      printf("closing: can't open %s\n", board.path);
+      return false;
+    }
+    nextFrame(frame);
+    stream.show(frame);
+    stream.close(true);
+    board.drain(50);
+    WallStream::Stats s = stream.stats();
+    if((board.sink.frames.size() != 2) || !same(board.sink.frames[0], frame) ||
+       !same(board.sink.frames[1], off) || (s.dropped != 0)) {
+      printf("closing: try %d, %zu frames out, %lu dropped\n",
+        t, board.sink.frames.size(), s.dropped);
+      return false;
+    }
+  }
+  printf("closing: %d times, last frame and blank both out\n", times);
+  return true;
+}
+
+static bool stalled(int frames) {
+  Board                  board;
+  WallStream             stream(W * H);
+  WallFrame              frame(W, H);
+  std::vector<WallFrame> shown;
+  double                 slowest = 0;
+
+  if(!stream.open(board.path)) {
+    printf("stalled: can't open %s\n", board.path);
+    return false;
+  }
+  // Show everything without reading: the pty fills and the writer blocks
+  for(int i = 0; i < frames; i++) {
+    nextFrame(frame);
+    Time::time_point t = Time::now();
+    stream.show(frame);
+    double us = std::chrono::duration<double, std::micro>(Time::now() - t).count();
+    if(us > slowest) slowest = us;
+    shown.push_back(frame);
+  }
+  board.drain(200);
+  stream.close(false);
+  board.drain(100);
+
+  WallStream::Stats s = stream.stats();
+  bool ok = true;
+  if((s.dropped == 0) || (s.sent + s.dropped != (unsigned long)frames) ||
+     (board.sink.frames.size() != s.sent)) {
+    printf("stalled: %lu shown, %lu sent, %lu dropped; %zu frames out\n",
+      s.shown, s.sent, s.dropped, board.sink.frames.size());
+    ok = false;
+  }
+  // Frames out must be in the order shown, ending with the newest
+  size_t k = 0;
+  for(size_t f = 0; ok && f < board.sink.frames.size(); f++) {
+    while((k < shown.size()) && !same(board.sink.frames[f], shown[k])) k++;
+    if(k == shown.size()) {
+      printf("stalled: frame %zu out was never shown, or out of order\n", f);
+      ok = false;
+    }
+  }
+  if(ok && (k != shown.size() - 1)) {
+    printf("stalled: last frame out isn't the newest\n");
+    ok = false;
+  }
+  printf("stalled: %d frames shown, %lu sent, %lu dropped, slowest show() %.0f us\n",
+    frames, s.sent, s.dropped, slowest);
+  return ok;
+}
+
+static bool telemetry(int frames) {
+  Board              board;
+  WallStream         stream(W * H);
+  WallFrame          frame(W, H);
+  BoardTelemetry     t;
+  TelemetryCollector collector;
+  int                reports = 0, rated = 0;
+
+  memset(&t, 0, sizeof(t));
+  if(!stream.open(board.path) || !stream.requestTelemetry(20)) {
+    printf("telemetry: can't open %s\n", board.path);
+    return false;
+  }
+  for(int i = 0; i < frames; i++) {
+    nextFrame(frame);
+    stream.show(frame);
+    board.runUntil(i + 1, 2000);
+    if(stream.telemetry(t)) {
+      WallStream::Stats now = stream.stats();
+      reports++;
+      if(collector.add(t, now.shown, now.dropped)) rated++;
+    }
+  }
+  // Until a report has everything
+  WallStream::Stats s = stream.stats();
+  unsigned long until = board.clock.millis() + 1000;
+  while((t.received != s.bytes) && (board.clock.millis() < until)) {
+    board.core.poll();
+    if(stream.telemetry(t)) {
+      WallStream::Stats now = stream.stats();
+      reports++;
+      if(collector.add(t, now.shown, now.dropped)) rated++;
+    }
+  }
+  stream.close(false);
+
+  bool ok = true;
+  if((t.received != s.bytes) || (t.latched != (uint32_t)frames) || t.badChecksums ||
+     t.skipped || (rated == 0)) {
+    printf("telemetry: %d reports; %u bytes (sent %lu), %u latched of %d, %u bad, %u skipped\n",
+      reports, t.received, s.bytes, t.latched, frames, t.badChecksums, t.skipped);
+    ok = false;
+  }
+  const TelemetryRates &r = collector.rates();
+  printf("telemetry: %d reports, last %.0f frames/s, %.0f bytes/s, %.1f%% holding; limit: %s\n",
+    reports, r.framesPerSec, r.bytesPerSec, r.holdShare * 100,
+    collector.limit());
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int frames = (argc > 1) ? atoi(argv[1]) : 300;
+  int failed = 0;
+
+  srand(1);
+  if(!inStep(frames))               failed++;
+  if(!fewColours(frames, 2, 16))   failed++;
+  if(!fewColours(frames, 40, 256)) failed++;
+  if(!bigWall(frames))             failed++;
+  if(!closing(20))                 failed++;
+  if(!stalled(frames * 4))         failed++;
+  if(!telemetry(frames))           failed++;
+  printf("WallStream pty test: %d failed\n", failed);
+  return failed ? 1 : 0;
+}
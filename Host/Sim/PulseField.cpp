@@ -0,0 +1,193 @@
+#include <math.h>
+#include <string.h>
+#include "PulseField.h"
+
+PulseField::PulseField(uint16_t width, uint16_t height) :
+  w(width ? width : 1), h(height ? height : 1), a((size_t)w * h * 3, 0), b(a) {
+  cur  = &a[0];
+  next = &b[0];
+  setFades(0.8f, 0.9f, 1.05f);
+  for(int v = 0; v < 256; v++) keep[v] = (int)(v * 0.8f);
+
+  // 0.8 / d^1.5 in 0.16, as the sketch's cc.colourScale(1 / pow(d^2, 0.75))
+  // then colourAdd(); anything too small to raise a full channel by one
+  // is left out.
+  falloff.assign((size_t)w * h, 0);
+  reachX = reachY = 0;
+  for(int dy = 0; dy < h; dy++) {
+    for(int dx = 0; dx < w; dx++) {
+      if(!dx && !dy) continue;
+      int f = (int)(0.8f * 65536 / powf(dx * dx + dy * dy, 0.75f) + 0.5f);
+      if((255 * f) >> 16) {
+        falloff[dy * w + dx] = f;
+        if(dx > reachX) reachX = dx;
+        if(dy > reachY) reachY = dy;
+      }
+    }
+  }
+  active.reserve(PULSE_MAX_RINGS);
+}
+
+void PulseField::setFades(float bright, float mid, float dim) {
+  const float s[3] = { bright, mid, dim };
+
+  // As the sketches' colourScale(), (int)(v * s), but saturating
+  for(int k = 0; k < 3; k++) {
+    for(int v = 0; v < 256; v++) {
+      int f      = (int)(v * s[k]);
+      fade[k][v] = (f > 255) ? 255 : f;
+    }
+  }
+}
+
+void PulseField::set(uint16_t x, uint16_t y, uint32_t colour) {
+  if((x >= w) || (y >= h)) return;
+  uint8_t *p = &cur[((size_t)y * w + x) * 3];
+  p[0] = colour >> 16;
+  p[1] = colour >> 8;
+  p[2] = colour;
+}
+
+uint32_t PulseField::get(uint16_t x, uint16_t y) const {
+  if((x >= w) || (y >= h)) return 0;
+  const uint8_t *p = &cur[((size_t)y * w + x) * 3];
+  return (uint32_t)p[0] << 16 | p[1] << 8 | p[2];
+}
+
+// The sketches' colourAdd(ArrayList): running average of v and the
+// neighbours, truncating at each step, r = (i+1) r / (i+2) + n_i / (i+2).
+// With all four neighbours the divisors are constants.
+static inline int average4(int v, int n0, int n1, int n2, int n3) {
+  v = v / 2 + n0 / 2;
+  v = 2 * v / 3 + n1 / 3;
+  v = 3 * v / 4 + n2 / 4;
+  return 4 * v / 5 + n3 / 5;
+}
+
+void PulseField::diffuse(void) {
+  const int row = w * 3;
+
+  for(int y = 0; y < h; y++) {
+    const uint8_t *src = cur + y * row;
+    uint8_t       *dst = next + y * row;
+    bool           edgeRow = (y == 0) || (y == h - 1);
+    for(int x = 0; x < w; x++, src += 3, dst += 3) {
+      int c[3];
+      if(!edgeRow && (x > 0) && (x < w - 1)) {
+        // Neighbours in the sketches' order: right, below, left, above
+        for(int k = 0; k < 3; k++) {
+          c[k] = average4(src[k], src[3 + k], src[row + k], src[k - 3], src[k - row]);
+        }
+      } else {
+        const uint8_t *n[4];
+        int            count = 0;
+        if(x < w - 1) n[count++] = src + 3;
+        if(y < h - 1) n[count++] = src + row;
+        if(x > 0)     n[count++] = src - 3;
+        if(y > 0)     n[count++] = src - row;
+        for(int k = 0; k < 3; k++) {
+          c[k] = src[k];
+          for(int i = 0; i < count; i++) c[k] = (i + 1) * c[k] / (i + 2) + n[i][k] / (i + 2);
+        }
+      }
+      int norm = c[0];
+      if(c[1] > norm) norm = c[1];
+      if(c[2] > norm) norm = c[2];
+      const uint8_t *f = fade[(norm > 200) ? 0 : (norm > 50) ? 1 : 2];
+      dst[0] = f[c[0]];
+      dst[1] = f[c[1]];
+      dst[2] = f[c[2]];
+    }
+  }
+  uint8_t *t = cur;
+  cur  = next;
+  next = t;
+}
+
+void PulseField::pulse(uint16_t x, uint16_t y, uint32_t colour) {
+  const uint8_t rgb[3] = { (uint8_t)(colour >> 16), (uint8_t)(colour >> 8), (uint8_t)colour };
+
+  if((x >= w) || (y >= h)) return;
+  int x0 = (x > reachX) ? x - reachX : 0, x1 = (x + reachX < w) ? x + reachX : w - 1;
+  int y0 = (y > reachY) ? y - reachY : 0, y1 = (y + reachY < h) ? y + reachY : h - 1;
+  for(int j = y0; j <= y1; j++) {
+    const uint16_t *f = &falloff[(size_t)((j > y) ? j - y : y - j) * w];
+    uint8_t        *p = &cur[((size_t)j * w + x0) * 3];
+    for(int i = x0; i <= x1; i++, p += 3) {
+      uint32_t s = f[(i > x) ? i - x : x - i];
+      if(!s) continue;
+      for(int k = 0; k < 3; k++) {
+        int v = p[k] + ((rgb[k] * s) >> 16);
+        p[k]  = (v > 255) ? 255 : v;
+      }
+    }
+  }
+  set(x, y, colour);
+}
+
+bool PulseField::addRing(uint16_t x, uint16_t y, uint32_t colour, uint8_t maxRadius) {
+  if((active.size() >= PULSE_MAX_RINGS) || (x >= w) || (y >= h)) return false;
+  Ring r;
+  r.x         = x;
+  r.y         = y;
+  // colourAdd() adds 0.8 of it
+  r.rgb[0]    = (int)((uint8_t)(colour >> 16) * 0.8f);
+  r.rgb[1]    = (int)((uint8_t)(colour >> 8) * 0.8f);
+  r.rgb[2]    = (int)((uint8_t)colour * 0.8f);
+  r.radius    = 1;
+  r.maxRadius = maxRadius;
+  active.push_back(r);
+  return true;
+}
+
+// Pixels within the radius: faded to 0.8, plus 0.8 of the ring's colour
+void PulseField::drawRing(const Ring &r) {
+  int rr = r.radius * r.radius;
+  int y0 = (r.y > r.radius) ? r.y - r.radius : 0, y1 = (r.y + r.radius < h) ? r.y + r.radius : h - 1;
+  int x0 = (r.x > r.radius) ? r.x - r.radius : 0, x1 = (r.x + r.radius < w) ? r.x + r.radius : w - 1;
+
+  for(int j = y0; j <= y1; j++) {
+    uint8_t *p = &cur[((size_t)j * w + x0) * 3];
+    for(int i = x0; i <= x1; i++, p += 3) {
+      if((i - r.x) * (i - r.x) + (j - r.y) * (j - r.y) > rr) continue;
+      for(int k = 0; k < 3; k++) {
+        int v = keep[p[k]] + r.rgb[k];
+        p[k]  = (v > 255) ? 255 : v;
+      }
+    }
+  }
+}
+
+void PulseField::step(void) {
+  size_t n = 0;
+
+  // Draw each ring, keep the ones still growing (in order)
+  for(size_t k = 0; k < active.size(); k++) {
+    drawRing(active[k]);
+    if(active[k].radius < active[k].maxRadius) {
+      active[n] = active[k];
+      active[n++].radius++;
+    }
+  }
+  active.resize(n);
+  diffuse();
+}
+
+void PulseField::render(uint8_t *rgb) const {
+  const int row = w * 3;
+
+  for(int y = 0; y < h; y++) {
+    const uint8_t *src = cur + y * row;
+    uint8_t       *dst = rgb + y * row;
+    if(!(y & 1)) {
+      memcpy(dst, src, row);
+      continue;
+    }
+    dst += row - 3;
+    for(int x = 0; x < w; x++, src += 3, dst -= 3) {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+    }
+  }
+}
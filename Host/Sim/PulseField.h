@@ -0,0 +1,81 @@
+// Native version of the pulse and pulseWaveWaveform sketches' effects:
+// colours spreading into their neighbours and fading (iterate()), bursts
+// of colour falling off with distance (pulse()), and expanding rings of
+// colour (pulseWave()).
+//
+// The sketches allocate a Colour for every pixel and an ArrayList of its
+// neighbours every frame, find every pixel of a burst with a BFS (an
+// ArrayBlockingQueue of Integers) and call pow() for each.  Here the
+// frame is two RGB buffers used in turn, diffusion is integer arithmetic
+// with the fades as 256-entry tables, and a burst's falloff comes from a
+// table of 0.8 / d^1.5 by offset, worked out once.  Nothing is allocated
+// after construction.
+//
+// Diffusion gives exactly the sketches' colours.  Adding colour saturates
+// at 255, where the sketches' ints overflow into the next channel.
+
+#ifndef LEDWALL_PULSEFIELD_H
+#define LEDWALL_PULSEFIELD_H
+
+#include <stdint.h>
+#include <vector>
+
+// Rings in flight at once; more are ignored until some finish
+#define PULSE_MAX_RINGS 64
+
+class PulseField {
+ public:
+  PulseField(uint16_t w, uint16_t h);
+
+  uint16_t width(void) const  { return w; }
+  uint16_t height(void) const { return h; }
+
+  // Diffusion scales pixels by bright when their brightest channel is
+  // over 200, else by mid when over 50, else by dim.  The defaults are the
+  // pulse sketch's; pulseWaveWaveform uses 0.7, 0.8, 1.05.
+  void     setFades(float bright, float mid, float dim);
+
+  // Pixels, row after row (not the wall's serpentine order), 3 bytes each
+  uint8_t       *pixels(void)       { return cur; }
+  const uint8_t *pixels(void) const { return cur; }
+  void           set(uint16_t x, uint16_t y, uint32_t colour);
+  uint32_t       get(uint16_t x, uint16_t y) const;
+
+  // Every pixel becomes the running average of itself and its neighbours
+  // (the sketches' colourAdd order), then is faded
+  void diffuse(void);
+  // The pulse sketch's burst: (x, y) takes colour, and every other pixel
+  // gains 0.8 / d^1.5 of it, out to where that rounds to nothing
+  void pulse(uint16_t x, uint16_t y, uint32_t colour);
+
+  // pulseWaveWaveform's rings: each step(), pixels within a ring's radius
+  // are faded to 0.8 and gain 0.8 of its colour; radius grows from 1 to
+  // maxRadius, then the ring is done.  False if PULSE_MAX_RINGS are
+  // already going.
+  bool addRing(uint16_t x, uint16_t y, uint32_t colour, uint8_t maxRadius = 5);
+  int  rings(void) const { return (int)active.size(); }
+  // The rings, then diffusion: pulseWaveWaveform's iterate()
+  void step(void);
+
+  // The frame in wall (serpentine) order: odd rows right to left
+  void render(uint8_t *rgb) const;
+
+ private:
+  struct Ring {
+    uint16_t x, y;
+    uint8_t  rgb[3], radius, maxRadius;
+  };
+
+  void drawRing(const Ring &r);
+
+  uint16_t             w, h;
+  std::vector<uint8_t> a, b;
+  uint8_t             *cur, *next;
+  uint8_t              fade[3][256];   // Bright, mid and dim, saturated
+  uint8_t              keep[256];      // Rings' 0.8
+  std::vector<uint16_t> falloff;       // 0.16, by |dy| * w + |dx|
+  uint16_t             reachX, reachY; // Offsets beyond which falloff is 0
+  std::vector<Ring>    active;
+};
+
+#endif
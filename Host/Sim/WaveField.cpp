@@ -0,0 +1,156 @@
+#include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+#include "WaveField.h"
+
+// Boards whose two levels fit in this much stay in cache between steps,
+// so they're stepped one whole step at a time; carrying a band through
+// several steps only pays when the board comes from memory.
+#define CACHED_BYTES (8 << 20)
+
+WaveField::WaveField(uint16_t width, uint16_t height, float k, float dt) :
+  w(width < 2 ? 2 : width), h(height < 2 ? 2 : height), sourced(false) {
+  float dx = 1.0f / w;
+
+  coef   = k * dt * dt / (dx * dx);
+  stride = (w + 2 + 3) & ~3;      // Rows start 16-byte aligned in the buffer
+  a.assign((size_t)stride * (h + 2), 0);
+  b.assign((size_t)stride * (h + 2), 0);
+  cur = &a[0];
+  old = &b[0];
+}
+
+void WaveField::clear(void) {
+  memset(cur, 0, a.size() * sizeof(float));
+  memset(old, 0, b.size() * sizeof(float));
+}
+
+void WaveField::drop(float cx, float cy, float sharpness, float amplitude) {
+  const float dx = 1.0f / w, dy = 1.0f / h;
+
+  for(int y = 1; y <= h; y++) {
+    for(int x = 1; x <= w; x++) {
+      float u = x * dx - cx, v = y * dy - cy;
+      float d = amplitude * expf(-sharpness * (u * u + v * v));
+      cur[y * stride + x] += d;
+      old[y * stride + x] += d;
+    }
+  }
+  mirror(cur);
+  mirror(old);
+}
+
+void WaveField::setSource(const float *field) {
+  sourced = (field != NULL);
+  if(sourced && source.empty()) source.assign(a.size(), 0);
+  for(int y = 0; sourced && (y < h); y++) {
+    memcpy(&source[(y + 1) * stride + 1], &field[y * w], w * sizeof(float));
+  }
+}
+
+// Ghost cells take the value of the cell one in from the edge
+void WaveField::mirror(float *buf) {
+  for(int y = 1; y <= h; y++) {
+    buf[y * stride]         = buf[y * stride + 2];
+    buf[y * stride + w + 1] = buf[y * stride + w - 1];
+  }
+  memcpy(buf, buf + 2 * stride, stride * sizeof(float));
+  memcpy(buf + (h + 1) * stride, buf + (h - 1) * stride, stride * sizeof(float));
+}
+
+// One row of one step: out holds the level before in, and gets the level
+// after it.  Same operations in the same order as the sketch's iterate(),
+// so the results match it exactly.
+void WaveField::row(const float *in, float *out, int y, float level) {
+  const float *up = in + (y - 1) * stride, *mid = in + y * stride,
+              *down = in + (y + 1) * stride, *src = sourced ? &source[y * stride] : NULL;
+  float       *dst = out + y * stride;
+  int          x   = 1;
+
+#ifdef __SSE2__
+  const __m128 two = _mm_set1_ps(2.0f), c = _mm_set1_ps(coef), l = _mm_set1_ps(level);
+  for(; x + 4 <= w + 1; x += 4) {
+    __m128 m   = _mm_loadu_ps(mid + x), twoM = _mm_mul_ps(two, m);
+    __m128 lap = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(mid + x + 1), twoM), _mm_loadu_ps(mid + x - 1));
+    lap        = _mm_add_ps(_mm_sub_ps(_mm_add_ps(lap, _mm_loadu_ps(down + x)), twoM),
+                            _mm_loadu_ps(up + x));
+    __m128 v   = _mm_add_ps(_mm_sub_ps(twoM, _mm_loadu_ps(dst + x)), _mm_mul_ps(c, lap));
+    if(sourced) v = _mm_sub_ps(v, _mm_mul_ps(l, _mm_loadu_ps(src + x)));
+    _mm_storeu_ps(dst + x, v);
+  }
+#endif
+  for(; x <= w; x++) {
+    float m   = mid[x];
+    float lap = mid[x + 1] - 2 * m + mid[x - 1] + down[x] - 2 * m + up[x];
+    float v   = 2 * m - dst[x] + coef * lap;
+    dst[x]    = sourced ? v - level * src[x] : v;
+  }
+  dst[0]     = dst[2];
+  dst[w + 1] = dst[w - 1];
+}
+
+void WaveField::step(int substeps, float sourceLevel) {
+  float *buf[2] = { cur, old }; // Step s reads buf[s & 1], overwrites the other
+
+  if(substeps < 1) return;
+  if((substeps > 1) && (2 * a.size() * sizeof(float) <= CACHED_BYTES)) {
+    while(substeps--) step(1, sourceLevel);
+    return;
+  }
+  // Step s does row r - 2s: far enough behind step s - 1 that the rows it
+  // reads are done, and the row it overwrites is no longer needed there.
+  for(int r = 1; r <= h + 2 * (substeps - 1); r++) {
+    for(int s = 0; s < substeps; s++) {
+      int y = r - 2 * s;
+      if((y < 1) || (y > h)) continue;
+      float *out = buf[(s + 1) & 1];
+      row(buf[s & 1], out, y, sourceLevel);
+      if(y == 2)     memcpy(out, out + 2 * stride, stride * sizeof(float));
+      if(y == h - 1) memcpy(out + (h + 1) * stride, out + (h - 1) * stride, stride * sizeof(float));
+    }
+  }
+  if(substeps & 1) {
+    cur = buf[1];
+    old = buf[0];
+  }
+}
+
+void WaveField::render(uint8_t *rgb, uint8_t phase, float range) const {
+  int     col = phase % 255, t;
+  uint8_t neg[3], pos[3];
+
+  // The sketch's c1 (for negative values) and c2
+  if(col < 85) {
+    t = col * 3;
+    neg[0] = t;       neg[1] = 255 - t; neg[2] = 0;
+    pos[0] = 0;       pos[1] = 255 - t; pos[2] = t;
+  } else if(col < 170) {
+    t = (col - 85) * 3;
+    neg[0] = 255 - t; neg[1] = 0;       neg[2] = t;
+    pos[0] = t;       pos[1] = 0;       pos[2] = 255 - t;
+  } else {
+    t = (col - 170) * 3;
+    neg[0] = 0;       neg[1] = t;       neg[2] = 255 - t;
+    pos[0] = 255 - t; pos[1] = t;       pos[2] = 0;
+  }
+
+  for(int y = 0; y < h; y++) {
+    const float *src = cur + (y + 1) * stride + 1;
+    uint8_t     *out = rgb + (size_t)y * w * 3;
+    int          dir = 3;
+    if(y & 1) {       // Odd rows run right to left
+      out += (w - 1) * 3;
+      dir  = -3;
+    }
+    for(int x = 0; x < w; x++, out += dir) {
+      float          v = src[x], s = fabsf(v) / range;
+      const uint8_t *c = (v < 0) ? neg : pos;
+      if(s > 1) s = 1;
+      out[0] = (int)(c[0] * s);
+      out[1] = (int)(c[1] * s);
+      out[2] = (int)(c[2] * s);
+    }
+  }
+}
@@ -0,0 +1,68 @@
+// Native version of the waveEquation sketch's simulation and colouring.
+//
+// The sketch keeps three float[][] boards (with ghost cells), rotates
+// them every step, works out the 5-point Laplacian one cell at a time and
+// then allocates a Colour for every pixel it draws.  Here the field is
+// two contiguous padded buffers: the new level can overwrite the one
+// before last in place, as each cell only reads its own old value.  Rows
+// are updated four cells at a time with SSE2.
+//
+// On boards too big for the cache, several steps per frame are done as
+// one sweep down the board: step s runs two rows behind step s - 1, so a
+// band of a few rows is carried through all the steps while it is in
+// cache, and the board is read from memory once per frame rather than
+// once per step.  The result is the same, bit for bit, as doing the
+// steps one after another.
+//
+// Edges reflect, as in the sketch (the ghost cells mirror the cells one
+// in from the edge).  Deprecated/WaveEquation is the same simulation in
+// 8.8 fixed point, for running on the board.
+
+#ifndef LEDWALL_WAVEFIELD_H
+#define LEDWALL_WAVEFIELD_H
+
+#include <stdint.h>
+#include <vector>
+
+class WaveField {
+ public:
+  // The sketch's constants: wave speed k, time step dt and a grid
+  // spacing of 1 / w (in both directions)
+  WaveField(uint16_t w, uint16_t h, float k = 0.1f, float dt = 0.05f);
+
+  uint16_t width(void) const  { return w; }
+  uint16_t height(void) const { return h; }
+  float    at(uint16_t x, uint16_t y) const { return cur[(y + 1) * stride + x + 1]; }
+
+  // Everything still and flat
+  void clear(void);
+  // Adds a still bump amplitude * exp(-sharpness * r^2), centred on
+  // (cx, cy) in the sketch's 0..1 board coordinates.  The sketch starts
+  // with drop(0.5, 0.5, 50, 1).
+  void drop(float cx, float cy, float sharpness = 50, float amplitude = 1);
+  // Source term, w x h values row after row (NULL for none), which step()
+  // subtracts from every cell at every step, scaled by its level
+  void setSource(const float *field);
+
+  // Advances substeps time steps
+  void step(int substeps = 1, float sourceLevel = 0);
+
+  // The sketch's writeSerial(): w x h pixels in wall (serpentine) order,
+  // each in one of two colours picked by phase (0-254, the sketch's
+  // (iterCnt / 2) % 255) according to its sign, at a brightness of
+  // |value| / range, in the same pass over the field.
+  void render(uint8_t *rgb, uint8_t phase, float range = 1.5f) const;
+
+ private:
+  void mirror(float *buf);
+  void row(const float *in, float *out, int y, float level);
+
+  uint16_t           w, h;
+  int                stride;       // Floats per row, ghost cells and all
+  float              coef;         // k dt^2 / dx^2
+  std::vector<float> a, b, source;
+  float             *cur, *old;    // This step and the one before
+  bool               sourced;
+};
+
+#endif
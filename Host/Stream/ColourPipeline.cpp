@@ -0,0 +1,92 @@
+#include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+#include "ColourPipeline.h"
+
+// Bytes corrected per pass; a multiple of 3 (whole pixels, so a chunk
+// always starts on red) and of 16 (whole SSE2 vectors).
+#define CHUNK 240
+
+ColourPipeline::ColourPipeline(const ColourSettings &s) {
+  set(s);
+}
+
+void ColourPipeline::set(const ColourSettings &s) {
+  const uint8_t white[3] = { s.red, s.green, s.blue };
+
+  cfg = s;
+  for(int c = 0; c < 3; c++) {
+    float scale = white[c] * (s.brightness / 255.0f) * 256.0f;
+    for(int v = 0; v < 256; v++) {
+      float f = powf(v / 255.0f, s.gamma) * scale + 0.5f;
+      lut[c][v]  = (f > 65280.0f) ? 65280 : (uint16_t)f;
+      lut8[c][v] = (lut[c][v] + 128) >> 8;
+    }
+  }
+}
+
+void ColourPipeline::table(uint8_t out[3 * 256]) const {
+  memcpy(out, lut8, sizeof(lut8));
+}
+
+void ColourPipeline::apply(const uint8_t *in, uint8_t *out, size_t pixels) {
+  size_t bytes = pixels * 3;
+
+  if(!cfg.dither) {
+    applyRounded(in, out, bytes);
+    return;
+  }
+  if(residual.size() != bytes) {
+    // New frame size: start every error at half a step, so levels round
+    // to nearest rather than down
+    residual.assign(bytes, 128);
+  }
+  applyDithered(in, out, bytes);
+}
+
+void ColourPipeline::applyRounded(const uint8_t *in, uint8_t *out, size_t bytes) {
+  for(size_t k = 0; k + 3 <= bytes; k += 3) {
+    out[k]     = lut8[0][in[k]];
+    out[k + 1] = lut8[1][in[k + 1]];
+    out[k + 2] = lut8[2][in[k + 2]];
+  }
+}
+
+// Table lookups go a chunk at a time into a 16-bit scratch buffer; adding
+// in the carried error and splitting each level into output byte and new
+// error is then plain arithmetic on whole vectors.
+void ColourPipeline::applyDithered(const uint8_t *in, uint8_t *out, size_t bytes) {
+  uint16_t level[CHUNK];
+  uint8_t *err = &residual[0];
+
+  for(size_t base = 0; base < bytes; base += CHUNK) {
+    size_t n = (bytes - base < CHUNK) ? bytes - base : CHUNK, k = 0;
+    for(size_t i = 0; i < n; i += 3) {
+      level[i]     = lut[0][in[base + i]];
+      level[i + 1] = lut[1][in[base + i + 1]];
+      level[i + 2] = lut[2][in[base + i + 2]];
+    }
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), low = _mm_set1_epi16(0xff);
+    for(; k + 16 <= n; k += 16) {
+      __m128i e  = _mm_loadu_si128((const __m128i *)&err[base + k]);
+      __m128i v0 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)&level[k]),
+                                 _mm_unpacklo_epi8(e, zero));
+      __m128i v1 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)&level[k + 8]),
+                                 _mm_unpackhi_epi8(e, zero));
+      _mm_storeu_si128((__m128i *)&out[base + k],
+        _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8)));
+      _mm_storeu_si128((__m128i *)&err[base + k],
+        _mm_packus_epi16(_mm_and_si128(v0, low), _mm_and_si128(v1, low)));
+    }
+#endif
+    for(; k < n; k++) {
+      // At most 65280 + 255, so this can't overflow
+      uint16_t v     = level[k] + err[base + k];
+      out[base + k]  = v >> 8;
+      err[base + k]  = v;
+    }
+  }
+}
@@ -0,0 +1,60 @@
+// Colour correction for whole frames: gamma, white balance and global
+// brightness, as the Processing sketches' gamma[][] table does per LED
+// (exponent 2.8, white point 255/240/220), but in one pass over the frame.
+//
+// Corrected levels are kept to 8.8 fixed point.  Sending only the top 8
+// bits crushes the whole bottom of the gamma curve -- inputs up to about
+// 35 come out as 0 -- so by default each byte carries its rounding error
+// over to the same LED's next frame (temporal dithering), and dim colours
+// average out to the right level across frames.
+//
+// The same levels, rounded to 8 bits, can be built into a table for the
+// board instead (see Tools/ColourTable.cpp), for hosts that send raw
+// colours.
+
+#ifndef LEDWALL_COLOURPIPELINE_H
+#define LEDWALL_COLOURPIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct ColourSettings {
+  float   gamma;
+  uint8_t red, green, blue;  // White balance: level of each at full input
+  uint8_t brightness;        // Scales everything; 255 = full
+  bool    dither;
+
+  ColourSettings(float gamma = 2.8, uint8_t red = 255, uint8_t green = 240,
+    uint8_t blue = 220, uint8_t brightness = 255, bool dither = true) :
+    gamma(gamma), red(red), green(green), blue(blue),
+    brightness(brightness), dither(dither) {}
+};
+
+class ColourPipeline {
+ public:
+  ColourPipeline(const ColourSettings &s = ColourSettings());
+
+  void                  set(const ColourSettings &s);
+  const ColourSettings &settings(void) const { return cfg; }
+
+  // Corrects pixels RGB triplets from in to out (which may be the same).
+  // With dithering, each call is taken to be the next frame.
+  void apply(const uint8_t *in, uint8_t *out, size_t pixels);
+
+  // Corrected level of value v on channel c (0-2), 8.8 fixed point
+  uint16_t level(int c, uint8_t v) const { return lut[c][v]; }
+  // Same, rounded to 8 bits: table[c * 256 + v], for the board
+  void     table(uint8_t out[3 * 256]) const;
+
+ private:
+  void applyRounded(const uint8_t *in, uint8_t *out, size_t bytes);
+  void applyDithered(const uint8_t *in, uint8_t *out, size_t bytes);
+
+  ColourSettings       cfg;
+  uint16_t             lut[3][256];
+  uint8_t              lut8[3][256];
+  std::vector<uint8_t> residual;      // Carried rounding error, per byte
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <string.h>
+#include "FramePalette.h"
+
+// Hash table size: a power of two, at least four times the most colours
+static const uint32_t TABLESIZE = 1024;
+
+FramePalette::FramePalette(unsigned maxColours) :
+  count(0), leds(0), generation(0), keys(TABLESIZE), marks(TABLESIZE, 0),
+  slots(TABLESIZE) {
+  setMaxColours(maxColours);
+}
+
+void FramePalette::setMaxColours(unsigned n) {
+  limit = (n < 1) ? 1 : (n > 256) ? 256 : n;
+}
+
+bool FramePalette::build(const uint8_t *p, uint32_t n) {
+  leds  = n;
+  count = 0;
+  if(index.size() < n) index.resize(n);
+  // A new generation empties the table without touching it
+  if(++generation == 0) {
+    std::fill(marks.begin(), marks.end(), 0);
+    generation = 1;
+  }
+
+  uint32_t last = 0xffffffff; // Runs of one colour skip the lookup
+  uint8_t  lastIndex = 0;
+  for(uint32_t i = 0; i < n; i++, p += 3) {
+    uint32_t c = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    if(c != last) {
+      uint32_t h = (c * 0x9e3779b1u) >> 22;
+      while((marks[h] == generation) && (keys[h] != c)) h = (h + 1) & (TABLESIZE - 1);
+      if(marks[h] != generation) {
+        if(count == limit) return false;
+        marks[h] = generation;
+        keys[h]  = c;
+        slots[h] = count;
+        memcpy(&rgb[count * 3], p, 3);
+        count++;
+      }
+      last      = c;
+      lastIndex = slots[h];
+    }
+    index[i] = lastIndex;
+  }
+  return count > 0;
+}
+
+size_t FramePalette::encode(uint8_t *out) const {
+  size_t   n    = packetSize(leds, count);
+  uint32_t size = n - 6, l = leds - 1;
+
+  out[0] = 'A';
+  out[1] = 'd';
+  out[2] = 'P';
+  out[3] = size >> 8;
+  out[4] = size;
+  out[5] = out[3] ^ out[4] ^ 0x55;
+  out[6] = l >> 8;
+  out[7] = l;
+  out[8] = count - 1;
+  memcpy(&out[9], rgb, count * 3);
+  uint8_t *o = &out[9 + count * 3];
+  if(count <= 16) {
+    // Two LEDs a byte, the first in the high half
+    uint32_t i;
+    for(i = 0; i + 1 < leds; i += 2) *o++ = (index[i] << 4) | index[i + 1];
+    if(i < leds) *o++ = index[i] << 4;
+  } else {
+    memcpy(o, &index[0], leds);
+  }
+  return n;
+}
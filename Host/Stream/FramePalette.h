@@ -0,0 +1,49 @@
+// Palette frames ('AdP', see LEDstream.pde) for frames with few colours:
+// Life's two, a Tetris well's handful, equalizer bars.  The colours go
+// once, then each LED is a 4-bit index (16 colours or fewer) or an 8-bit
+// one, so a two-colour wall of 198 LEDs takes 114 bytes instead of 600.
+//
+// Colours are kept exactly -- a frame with more than the limit isn't
+// turned into an approximation, it just isn't sent this way -- so a
+// palette frame always shows what a plain one would.  Building one is a
+// single pass over the frame with a small hash table of the colours seen.
+
+#ifndef LEDWALL_FRAMEPALETTE_H
+#define LEDWALL_FRAMEPALETTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class FramePalette {
+ public:
+  // maxColours is what the board takes: 16 on AVRs, up to 256 elsewhere.
+  FramePalette(unsigned maxColours = 16);
+
+  void     setMaxColours(unsigned n);
+  unsigned maxColours(void) const { return limit; }
+
+  // Finds the colours of leds RGB triplets, and each LED's index; false
+  // if there are more than maxColours.
+  bool     build(const uint8_t *rgb, uint32_t leds);
+  unsigned colours(void) const { return count; }
+
+  // Bytes a palette packet for leds LEDs and colours colours takes,
+  // header and all
+  static size_t packetSize(uint32_t leds, unsigned colours) {
+    return 9 + 3 * colours + ((colours <= 16) ? (leds + 1) / 2 : leds);
+  }
+  // Writes the packet for the last frame built to out; returns its length.
+  size_t   encode(uint8_t *out) const;
+
+ private:
+  unsigned              limit, count;
+  uint32_t              leds;
+  uint32_t              generation;      // Marks table entries as this frame's
+  std::vector<uint32_t> keys, marks;     // Hash table: colour, frame it's from
+  std::vector<uint8_t>  slots;           // and its index
+  uint8_t               rgb[3 * 256];
+  std::vector<uint8_t>  index;
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FrameRecording.h"
+
+#define HEADER_BYTES 32
+#define FRAME_BYTES  16
+#define VERSION      1
+
+static void putLE(uint8_t *p, uint64_t v, int bytes) {
+  for(int k = 0; k < bytes; k++, v >>= 8) p[k] = (uint8_t)v;
+}
+
+static uint64_t getLE(const uint8_t *p, int bytes) {
+  uint64_t v = 0;
+  for(int k = bytes - 1; k >= 0; k--) v = (v << 8) | p[k];
+  return v;
+}
+
+// PackBits: a header byte h, then h + 1 bytes as they are (h < 128), or
+// one byte repeated 257 - h times (h > 128).  Runs of three or more are
+// worth a repeat.  out needs room for n + n / 128 + 1 bytes.
+static size_t pack(const uint8_t *in, size_t n, uint8_t *out) {
+  size_t i = 0, o = 0;
+
+  while(i < n) {
+    size_t r = 1;
+    while((i + r < n) && (r < 128) && (in[i + r] == in[i])) r++;
+    if(r >= 3) {
+      out[o++] = (uint8_t)(257 - r);
+      out[o++] = in[i];
+      i += r;
+      continue;
+    }
+    // Literals, up to the next run
+    size_t start = i;
+    while((i < n) && (i - start < 128)) {
+      if((i + 2 < n) && (in[i] == in[i + 1]) && (in[i] == in[i + 2])) break;
+      i++;
+    }
+    out[o++] = (uint8_t)(i - start - 1);
+    memcpy(&out[o], &in[start], i - start);
+    o += i - start;
+  }
+  return o;
+}
+
+// Unpacks into out (len bytes exactly), or XORs into it for a delta.
+// False if the data doesn't come to len bytes.
+static bool unpack(const uint8_t *in, size_t n, uint8_t *out, size_t len, bool delta) {
+  size_t i = 0, o = 0;
+
+  while(i < n) {
+    uint8_t h = in[i++];
+    if(h < 128) {
+      size_t c = h + 1;
+      if((i + c > n) || (o + c > len)) return false;
+      if(delta) {
+        for(size_t k = 0; k < c; k++) out[o + k] ^= in[i + k];
+      } else {
+        memcpy(&out[o], &in[i], c);
+      }
+      i += c;
+      o += c;
+    } else if(h > 128) {
+      size_t c = 257 - h;
+      if((i >= n) || (o + c > len)) return false;
+      uint8_t v = in[i++];
+      if(!delta) {
+        memset(&out[o], v, c);
+      } else if(v) {          // Runs of 0 are pixels that didn't change
+        for(size_t k = 0; k < c; k++) out[o + k] ^= v;
+      }
+      o += c;
+    }
+  }
+  return o == len;
+}
+
+/*****************************************************************************/
+
+FrameRecorder::FrameRecorder(void) :
+  file(NULL), leds(0), packing(true), keyframes(60), sinceKeyframe(0), end(0) {
+}
+
+FrameRecorder::~FrameRecorder(void) {
+  close();
+}
+
+bool FrameRecorder::create(const char *path, uint32_t numLEDs, bool compress,
+  int keyframeInterval) {
+  uint8_t h[HEADER_BYTES] = { 'L', 'W', 'R', 'C' };
+
+  if(file || !numLEDs || !(file = fopen(path, "wb"))) return false;
+  leds          = numLEDs;
+  packing       = compress;
+  keyframes     = keyframeInterval;
+  sinceKeyframe = 0;
+  end           = 0;
+  index.clear();
+  last.clear();
+  diff.resize((size_t)leds * 3);
+  packed.resize(diff.size() + diff.size() / 128 + 1);
+  packedDiff.resize(packed.size());
+  putLE(&h[4], VERSION, 2);
+  putLE(&h[8], leds, 4);
+  start = std::chrono::steady_clock::now();
+  return put(h, sizeof(h));
+}
+
+bool FrameRecorder::put(const void *data, size_t len) {
+  if(fwrite(data, 1, len, file) != len) return false;
+  end += len;
+  return true;
+}
+
+bool FrameRecorder::add(const uint8_t *rgb, size_t len) {
+  return add(rgb, len, std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count());
+}
+
+bool FrameRecorder::add(const uint8_t *rgb, size_t len, uint64_t micros) {
+  const uint8_t *payload = rgb;
+  size_t         size    = len;
+  uint8_t        kind    = RECORDING_RAW, h[FRAME_BYTES] = { 0 };
+
+  if(!file || (len != (size_t)leds * 3)) return false;
+  if(packing) {
+    size_t n = pack(rgb, len, &packed[0]);
+    if(n < size) {
+      kind = RECORDING_PACKED;
+      size = n;
+    }
+    if((sinceKeyframe < keyframes) && (last.size() == len)) {
+      for(size_t k = 0; k < len; k++) diff[k] = rgb[k] ^ last[k];
+      n = pack(&diff[0], len, &packedDiff[0]);
+      if(n < size) {
+        kind = RECORDING_DELTA;
+        size = n;
+      }
+    }
+    if(kind == RECORDING_PACKED) payload = &packed[0];
+    if(kind == RECORDING_DELTA)  payload = &packedDiff[0];
+  }
+  sinceKeyframe = (kind == RECORDING_DELTA) ? sinceKeyframe + 1 : 0;
+
+  putLE(&h[0], size, 4);
+  h[4] = kind;
+  putLE(&h[8], micros, 8);
+  uint64_t at = end;
+  bool     ok = put(h, sizeof(h)) && put(payload, size);
+  if(packing) last.assign(rgb, rgb + len);
+  if(!ok) return false;
+  index.push_back(at);
+  return true;
+}
+
+bool FrameRecorder::close(void) {
+  uint8_t b[8];
+  bool    ok = true;
+
+  if(!file) return false;
+  uint64_t at = end;
+  uint8_t  h[FRAME_BYTES] = { 0 };
+  putLE(&h[0], index.size() * 8, 4);
+  h[4] = RECORDING_INDEX;
+  ok   = put(h, sizeof(h));
+  for(size_t k = 0; ok && (k < index.size()); k++) {
+    putLE(b, index[k], 8);
+    ok = put(b, 8);
+  }
+  // Count and index go in the header last, so a recording cut short
+  // anywhere before this still reads as one without an index
+  if(ok) {
+    ok = (fflush(file) == 0) && (fseek(file, 12, SEEK_SET) == 0);
+    putLE(b, index.size(), 4);
+    ok = ok && (fwrite(b, 1, 4, file) == 4);
+    putLE(b, at, 8);
+    ok = ok && (fwrite(b, 1, 8, file) == 8);
+  }
+  ok = (fclose(file) == 0) && ok;
+  file = NULL;
+  return ok;
+}
+
+/*****************************************************************************/
+
+FrameReplay::FrameReplay(void) : map(NULL), length(0), leds(0), decoded(-1) {
+}
+
+FrameReplay::~FrameReplay(void) {
+  close();
+}
+
+bool FrameReplay::open(const char *path) {
+  struct stat st;
+  int         fd;
+
+  close();
+  if((fd = ::open(path, O_RDONLY)) < 0) return false;
+  if((fstat(fd, &st) < 0) || (st.st_size < HEADER_BYTES)) {
+    ::close(fd);
+    return false;
+  }
+  void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(p == MAP_FAILED) return false;
+  map    = (const uint8_t *)p;
+  length = st.st_size;
+  // Mostly read front to back, once
+  madvise(p, length, MADV_SEQUENTIAL);
+
+  leds = getLE(&map[8], 4);
+  if(memcmp(map, "LWRC", 4) || (getLE(&map[4], 2) != VERSION) || !leds) {
+    close();
+    return false;
+  }
+  uint32_t count = getLE(&map[12], 4);
+  uint64_t at    = getLE(&map[16], 8);
+  if(at && (at <= length - FRAME_BYTES) && (map[at + 4] == RECORDING_INDEX) &&
+     ((length - at - FRAME_BYTES) / 8 >= count)) {
+    index.resize(count);
+    for(uint32_t k = 0; k < count; k++) {
+      index[k] = getLE(&map[at + FRAME_BYTES + k * 8], 8);
+      uint64_t e = index[k] + FRAME_BYTES;
+      if((index[k] < HEADER_BYTES) || (e > at) || (getLE(&map[index[k]], 4) > at - e)) {
+        index.clear();
+        break;
+      }
+    }
+    if(index.size() == count) return true;
+  }
+  // No index, or a damaged one
+  scan();
+  return true;
+}
+
+// Rebuilds the index by walking the frames, up to the index (if it was
+// written) or the first frame that runs past the end of the file.
+void FrameReplay::scan(void) {
+  uint64_t at = HEADER_BYTES;
+
+  index.clear();
+  while(at + FRAME_BYTES <= length) {
+    uint64_t size = getLE(&map[at], 4);
+    if((map[at + 4] > RECORDING_DELTA) || (size > length - at - FRAME_BYTES)) break;
+    index.push_back(at);
+    at += FRAME_BYTES + size;
+  }
+}
+
+void FrameReplay::close(void) {
+  if(map) munmap((void *)map, length);
+  map     = NULL;
+  length  = 0;
+  leds    = 0;
+  decoded = -1;
+  index.clear();
+}
+
+uint64_t FrameReplay::time(uint32_t n) const {
+  return (n < frames()) ? getLE(&map[index[n] + 8], 8) : 0;
+}
+
+const uint8_t *FrameReplay::frame(uint32_t n) {
+  if(n >= frames()) return NULL;
+  if((decoded != n) && !decode(n)) return NULL;
+  return &current[0];
+}
+
+bool FrameReplay::decode(uint32_t n) {
+  size_t   len = (size_t)leds * 3;
+  uint32_t from;
+
+  // Back to the keyframe, unless the frame already decoded is on the way
+  for(from = n; (from > 0) && (map[index[from] + 4] == RECORDING_DELTA); from--);
+  if((decoded >= from) && (decoded < n)) {
+    from = decoded + 1;
+  } else {
+    current.assign(len, 0);
+  }
+
+  for(decoded = -1; from <= n; from++) {
+    const uint8_t *p    = &map[index[from]];
+    size_t         size = getLE(p, 4);
+    bool           ok;
+    switch(p[4]) {
+     case RECORDING_RAW:
+      ok = (size == len);
+      if(ok) memcpy(&current[0], p + FRAME_BYTES, len);
+      break;
+     case RECORDING_PACKED:
+      ok = unpack(p + FRAME_BYTES, size, &current[0], len, false);
+      break;
+     default:
+      ok = unpack(p + FRAME_BYTES, size, &current[0], len, true);
+      break;
+    }
+    if(!ok) return false;
+  }
+  decoded = n;
+  return true;
+}
@@ -0,0 +1,138 @@
+// Recordings of what was sent to the wall, for replaying a show, or a
+// glitch, exactly as it happened.
+//
+// FrameRecorder appends frames, each with the time it was sent, to a
+// file; WallStream::record() tees every frame a stream sends into one, and
+// Tools/WallRecord.cpp does the same for any program writing 'Ada' frames to
+// a serial port (a Processing sketch, say).  FrameReplay maps a recording
+// into memory and hands the frames back in order, or from any point,
+// paced as they were recorded or as fast as they can be decoded.
+//
+// The file is a header, the frames one after another, then an index of
+// where each frame starts (all little-endian):
+//
+//   header   "LWRC", version (16 bits), 0 (16), LEDs (32),
+//            frames (32), index offset (64), 0 (64)
+//   frame    payload bytes (32), kind (8), 0 (24), microseconds since
+//            recording started (64), payload
+//   index    as a frame header, of kind RECORDING_INDEX, then the file
+//            offset of each frame (64)
+//
+// A frame is stored raw, packed (PackBits: literal runs and repeated
+// bytes) or as a delta (the frame XOR the one before, packed, so pixels
+// that didn't change cost next to nothing) -- whichever is smallest, with
+// a raw or packed keyframe at least every keyframe interval so replay
+// can start anywhere.  Frames are only ever appended; the frame count and
+// index are written on close(), and a recording that was never closed
+// (the program crashed, say) is indexed again by walking its frames.
+
+#ifndef LEDWALL_FRAMERECORDING_H
+#define LEDWALL_FRAMERECORDING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define RECORDING_RAW    0
+#define RECORDING_PACKED 1
+#define RECORDING_DELTA  2
+#define RECORDING_INDEX  255
+
+class FrameRecorder {
+ public:
+  FrameRecorder(void);
+  ~FrameRecorder(void);
+
+  // Starts a new recording of numLEDs-LED frames (replacing any file
+  // already there).  With compress off every frame is stored raw.  False
+  // if the file can't be made.
+  bool create(const char *path, uint32_t numLEDs, bool compress = true,
+    int keyframeInterval = 60);
+  bool isOpen(void) const { return file != NULL; }
+  // Writes the index and frame count and closes the file.
+  bool close(void);
+
+  // Appends a frame of numLEDs * 3 bytes, taken micros after the
+  // recording started, or (without micros) now.  Frames of any other
+  // length are refused.  Not thread-safe: one thread adds frames.
+  bool add(const uint8_t *rgb, size_t len, uint64_t micros);
+  bool add(const uint8_t *rgb, size_t len);
+
+  uint32_t frames(void) const { return (uint32_t)index.size(); }
+  // Bytes written so far (not counting the index)
+  uint64_t bytes(void) const  { return end; }
+
+ private:
+  bool put(const void *data, size_t len);
+
+  FILE                 *file;
+  uint32_t              leds;
+  bool                  packing;
+  int                   keyframes, sinceKeyframe;
+  uint64_t              end;
+  std::chrono::steady_clock::time_point start;
+  std::vector<uint64_t> index;
+  std::vector<uint8_t>  last, diff, packed, packedDiff;
+};
+
+class FrameReplay {
+ public:
+  FrameReplay(void);
+  ~FrameReplay(void);
+
+  // Maps a recording.  False if it can't be read or isn't one; a frame
+  // cut short at the end (the recorder stopped mid-write) is left out.
+  bool open(const char *path);
+  void close(void);
+
+  uint32_t numLEDs(void) const { return leds; }
+  uint32_t frames(void) const  { return (uint32_t)index.size(); }
+  // When frame n was sent, in microseconds since the recording started
+  uint64_t time(uint32_t n) const;
+  // Frame n, numLEDs * 3 bytes, valid until the next call; NULL if n is
+  // out of range or the file is damaged.  The next frame after the last
+  // one asked for is quickest; others decode from the keyframe before.
+  const uint8_t *frame(uint32_t n);
+
+  // Calls show(const uint8_t *rgb, size_t len, uint32_t n) for frames
+  // first to last, spaced as recorded (speed 2 = twice as fast), or back
+  // to back with speed 0.  Stops early if show() returns false or a frame
+  // is damaged; returns how many frames were shown.
+  template<class F>
+  uint32_t play(F show, double speed = 1, uint32_t first = 0, uint32_t last = UINT32_MAX) {
+    typedef std::chrono::steady_clock clock;
+    clock::time_point begin = clock::now();
+    uint32_t          n;
+
+    if(last >= frames()) last = frames() - 1;
+    for(n = first; (n <= last) && (n < frames()); n++) {
+      const uint8_t *rgb = frame(n);
+      if(rgb == NULL) break;
+      if(speed > 0) {
+        std::this_thread::sleep_until(begin +
+          std::chrono::microseconds((int64_t)((time(n) - time(first)) / speed)));
+      }
+      if(!show(rgb, (size_t)leds * 3, n)) {
+        n++;
+        break;
+      }
+    }
+    return n - first;
+  }
+
+ private:
+  bool decode(uint32_t n);
+  void scan(void);
+
+  const uint8_t        *map;
+  size_t                length;
+  uint32_t              leds;
+  std::vector<uint64_t> index;
+  std::vector<uint8_t>  current;
+  int64_t               decoded;     // Frame in current, or -1
+};
+
+#endif
@@ -0,0 +1,41 @@
+#include <math.h>
+#include "LinkPacer.h"
+
+// Measurements are smoothed over about this long, in seconds
+static const double SMOOTHING = 0.5;
+// No link is slower than this (bytes/sec); keeps the arithmetic finite
+static const double SLOWEST   = 100;
+
+LinkPacer::LinkPacer(double bytesPerSec) {
+  reset(bytesPerSec);
+}
+
+void LinkPacer::reset(double bytesPerSec) {
+  estimate   = (bytesPerSec > SLOWEST) ? bytesPerSec : SLOWEST;
+  lastTime   = 0;
+  lastGone   = 0;
+  lastQueued = 0;
+  sampled    = false;
+}
+
+void LinkPacer::sample(double t, uint64_t written, size_t queued) {
+  uint64_t gone = (written > queued) ? written - queued : 0;
+  double   dt   = t - lastTime;
+
+  // Only while the link was busy the whole time does what went out
+  // measure its speed; a buffer that ran dry says only that the program
+  // didn't keep it fed.
+  if(sampled && (lastQueued > 0) && (queued > 0) && (dt > 0) && (gone >= lastGone)) {
+    double seen = (gone - lastGone) / dt;
+    estimate += (1 - exp(-dt / SMOOTHING)) * (seen - estimate);
+    if(estimate < SLOWEST) estimate = SLOWEST;
+  }
+  lastTime   = t;
+  lastGone   = gone;
+  lastQueued = queued;
+  sampled    = true;
+}
+
+void LinkPacer::atLeast(double bytesPerSec) {
+  if(bytesPerSec > estimate) estimate = bytesPerSec;
+}
@@ -0,0 +1,49 @@
+// How fast a serial link really takes bytes, and how far behind it is,
+// for pacing frames onto it.  write() to a serial port returns as soon as
+// the bytes are in the kernel's buffer, so a program that writes frames
+// faster than the link carries them (115200 baud is about 19 full frames
+// a second for the wall) just fills that buffer, and every frame shown
+// is seconds old.  WallStream uses this to hold frames back until the
+// link is nearly ready for them, so newer frames can replace them, and to
+// drop frames that would arrive too late anyway.
+//
+// The rate is measured, not taken from the baud rate: what left the
+// buffer (bytes written, less what's still queued) over a time the buffer
+// was never empty, smoothed.  USB boards run at whatever speed they read
+// at; the board's own count of bytes received (telemetry) can raise the
+// estimate with atLeast().  Times are in seconds on any steady clock.
+
+#ifndef LEDWALL_LINKPACER_H
+#define LEDWALL_LINKPACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class LinkPacer {
+ public:
+  // bytesPerSec is the first guess, until there are measurements.
+  LinkPacer(double bytesPerSec = 11520);
+
+  // Starts again from a first guess.
+  void reset(double bytesPerSec);
+  // At time t, written bytes had been written in all and queued were
+  // still waiting to go.
+  void sample(double t, uint64_t written, size_t queued);
+  // Something else saw the link carry this many bytes a second.
+  void atLeast(double bytesPerSec);
+
+  double rate(void) const { return estimate; }
+  // Seconds until the last of bytes more, written with queued waiting,
+  // has gone.
+  double drainTime(size_t queued, size_t bytes) const {
+    return (queued + bytes) / estimate;
+  }
+
+ private:
+  double   estimate, lastTime;
+  uint64_t lastGone;           // Bytes out of the buffer at lastTime
+  size_t   lastQueued;
+  bool     sampled;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include <string.h>
+#include "Telemetry.h"
+
+// Packet from the board: 'Adt', payload size, seven 32-bit counters (high
+// byte first), checksum
+static const uint8_t reply[]  = { 'A', 'd', 't' };
+static const size_t  COUNTERS = sizeof(BoardTelemetry) / 4;
+static const size_t  PAYLOAD  = COUNTERS * 4;
+static const size_t  PACKET   = sizeof(reply) + 1 + PAYLOAD + 1;
+
+size_t telemetryRequest(uint8_t *packet, uint16_t periodMs) {
+  packet[0] = 'A';
+  packet[1] = 'd';
+  packet[2] = 'T';
+  packet[3] = periodMs >> 8;
+  packet[4] = periodMs;
+  packet[5] = packet[3] ^ packet[4] ^ 0x55;
+  return 6;
+}
+
+/*****************************************************************************/
+
+TelemetryReader::TelemetryReader(void) : acks(0), reports(0), damaged(0) {
+  memset(&newest, 0, sizeof(newest));
+}
+
+// Bytes are kept only while they could still be the start of an ACK or
+// packet; anything else the board sends is passed over.
+bool TelemetryReader::feed(const uint8_t *data, size_t len) {
+  bool   got = false;
+  size_t k;
+
+  pending.insert(pending.end(), data, data + len);
+  for(k = 0; k < pending.size(); ) {
+    const uint8_t *p    = &pending[k];
+    size_t         have = pending.size() - k;
+
+    if((p[0] != 'A') || ((have > 1) && (p[1] != 'd')) ||
+       ((have > 2) && (p[2] != 'a') && (p[2] != 't'))) {
+      k++;
+      continue;
+    }
+    if(have < 4) break;                        // Wait for the rest
+    if(p[2] == 'a') {
+      if(p[3] == '\n') acks++;
+      k += (p[3] == '\n') ? 4 : 1;
+      continue;
+    }
+    if(p[3] != PAYLOAD) {                      // Not ours, or damaged
+      damaged++;
+      k++;
+      continue;
+    }
+    if(have < PACKET) break;
+    uint8_t chk = 0x55;
+    for(size_t b = 0; b < PAYLOAD; b++) chk ^= p[4 + b];
+    if(chk != p[4 + PAYLOAD]) {
+      damaged++;
+      k++;
+      continue;
+    }
+    uint32_t c[COUNTERS];
+    for(size_t n = 0; n < COUNTERS; n++) {
+      const uint8_t *v = p + 4 + n * 4;
+      c[n] = ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) | ((uint32_t)v[2] << 8) | v[3];
+    }
+    memcpy(&newest, c, sizeof(newest));
+    reports++;
+    got = true;
+    k  += PACKET;
+  }
+  pending.erase(pending.begin(), pending.begin() + k);
+  return got;
+}
+
+bool TelemetryReader::latest(BoardTelemetry &t) const {
+  if(!reports) return false;
+  t = newest;
+  return true;
+}
+
+/*****************************************************************************/
+
+TelemetryCollector::TelemetryCollector(void) : lastShown(0), lastDropped(0), haveLast(false) {
+  memset(&last, 0, sizeof(last));
+  memset(&now, 0, sizeof(now));
+}
+
+bool TelemetryCollector::add(const BoardTelemetry &t, unsigned long shown,
+  unsigned long dropped) {
+  // Differences as unsigned 32-bit, so counters wrapping round don't
+  // matter; a clock that went backwards means the board restarted.
+  uint32_t ms      = t.millis - last.millis;
+  bool     compare = haveLast && (ms > 0) && (ms < 0x80000000UL);
+
+  if(compare) {
+    double s = ms / 1000.0;
+    now.seconds            = s;
+    now.framesPerSec       = (t.latched - last.latched) / s;
+    now.bytesPerSec        = (t.received - last.received) / s;
+    now.badChecksumsPerSec = (t.badChecksums - last.badChecksums) / s;
+    now.skippedPerSec      = (t.skipped - last.skipped) / s;
+    now.holdsPerSec        = (t.holds - last.holds) / s;
+    now.holdShare          = (t.holdMicros - last.holdMicros) / (s * 1e6);
+    now.shownPerSec        = (shown - lastShown) / s;
+    now.droppedPerSec      = (dropped - lastDropped) / s;
+  }
+  last        = t;
+  lastShown   = shown;
+  lastDropped = dropped;
+  haveLast    = true;
+  return compare;
+}
+
+const char *TelemetryCollector::limit(void) const {
+  // Waiting for data a twentieth of the time, or one frame in twenty
+  // never making it to the port, is the link falling behind.
+  if((now.holdShare > 0.05) || (now.droppedPerSec > 0.05 * now.shownPerSec)) return "link";
+  if((now.badChecksumsPerSec > 0) || (now.skippedPerSec > 0)) return "errors";
+  return "renderer";
+}
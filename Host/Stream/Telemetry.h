@@ -0,0 +1,95 @@
+// The host's end of LEDstream's telemetry (see LEDstream.pde): a board
+// asked with an 'AdT' request reports its counters -- bytes received,
+// frames latched, bad checksums, bytes skipped looking for a header, and
+// pauses in mid-frame waiting for serial data -- every so often in place
+// of its "Ada\n" ACKs.  TelemetryReader picks the packets out of what the
+// board sends; TelemetryRates turns two reports into rates, and says
+// whether it's the link or whatever draws the frames that is holding the
+// frame rate down.  WallStream::requestTelemetry() and telemetry() do the
+// reading for a stream.
+
+#ifndef LEDWALL_TELEMETRY_H
+#define LEDWALL_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// One report, as the board counted (all wrapping around at 2^32)
+struct BoardTelemetry {
+  uint32_t
+    millis,          // Board's clock when reported
+    received,        // Serial bytes received
+    latched,         // Frames shifted out and latched
+    badChecksums,    // Magic words followed by a wrong checksum
+    skipped,         // Bytes thrown away looking for a header, or
+                     // delta data past the board's resident frame
+    holds,           // Pauses in mid-frame waiting for serial data
+    holdMicros;      // Time spent in those pauses
+};
+
+// Builds the request: reports now, then every periodMs (0: just the one).
+// Returns the packet's length (6).
+size_t telemetryRequest(uint8_t *packet, uint16_t periodMs);
+
+class TelemetryReader {
+ public:
+  TelemetryReader(void);
+
+  // Takes bytes as they come from the board, in pieces of any size; true
+  // if a report was completed.
+  bool feed(const uint8_t *data, size_t len);
+  // The newest report; false if there hasn't been one.
+  bool latest(BoardTelemetry &t) const;
+
+  unsigned long
+    acks,            // "Ada\n"s seen
+    reports,         // Good telemetry packets
+    damaged;         // Telemetry packets with a bad size or checksum
+
+ private:
+  std::vector<uint8_t> pending;
+  BoardTelemetry       newest;
+};
+
+// Rates over the time between two reports.
+struct TelemetryRates {
+  double
+    seconds,         // Between the two reports, by the board's clock
+    framesPerSec,    // Latched
+    bytesPerSec,     // Received
+    badChecksumsPerSec,
+    skippedPerSec,
+    holdsPerSec,
+    holdShare,       // Of the time, spent waiting for serial data mid-frame
+    shownPerSec,     // Drawn by the program
+    droppedPerSec;   // Drawn but never sent
+};
+
+// Keeps the report before, to work out rates as each one comes.
+class TelemetryCollector {
+ public:
+  TelemetryCollector(void);
+
+  // Adds the next report, with the program's own counts of frames drawn
+  // and dropped as it came in (WallStream::Stats shown and dropped); true
+  // (and rates() filled in) if there was one before it to compare with.
+  // A board that restarted starts over.
+  bool add(const BoardTelemetry &t, unsigned long shown = 0, unsigned long dropped = 0);
+  const TelemetryRates &rates(void) const { return now; }
+
+  // What held the frame rate down between the last two reports:
+  //   "link"      the board waited for data mid-frame, or frames were
+  //               dropped because the port couldn't take them
+  //   "errors"    data arrived damaged (bad checksums, bytes skipped)
+  //   "renderer"  everything drawn was shown; drawing is the limit
+  const char *limit(void) const;
+
+ private:
+  BoardTelemetry last;
+  unsigned long  lastShown, lastDropped;
+  bool           haveLast;
+  TelemetryRates now;
+};
+
+#endif
@@ -0,0 +1,480 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include "FrameRecording.h"
+#include "WallStream.h"
+
+/*****************************************************************************/
+
+WallFrame::WallFrame(uint16_t w, uint16_t h) :
+  width(w), height(h), rgb((size_t)w * h * 3, 0) {
+}
+
+size_t WallFrame::offset(int x, int y) const {
+  if(y & 1) x = width - 1 - x;
+  return ((size_t)y * width + x) * 3;
+}
+
+void WallFrame::spc(int x, int y, uint32_t c) {
+  if((x < 0) || (x >= width) || (y < 0) || (y >= height)) return;
+  uint8_t *p = &rgb[offset(x, y)];
+  p[0] = c >> 16;
+  p[1] = c >> 8;
+  p[2] = c;
+}
+
+int32_t WallFrame::gpc(int x, int y) const {
+  if((x < 0) || (x >= width) || (y < 0) || (y >= height)) return -1;
+  const uint8_t *p = &rgb[offset(x, y)];
+  return ((int32_t)p[0] << 16) | ((int32_t)p[1] << 8) | p[2];
+}
+
+void WallFrame::setPixelColor(uint32_t n, uint32_t c) {
+  if(n >= numPixels()) return;
+  rgb[n * 3]     = c >> 16;
+  rgb[n * 3 + 1] = c >> 8;
+  rgb[n * 3 + 2] = c;
+}
+
+uint32_t WallFrame::getPixelColor(uint32_t n) const {
+  if(n >= numPixels()) return 0;
+  return ((uint32_t)rgb[n * 3] << 16) | ((uint32_t)rgb[n * 3 + 1] << 8) | rgb[n * 3 + 2];
+}
+
+void WallFrame::fill(uint32_t c) {
+  for(uint32_t n = 0; n < numPixels(); n++) setPixelColor(n, c);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::duration d) {
+  return std::chrono::duration<double>(d).count();
+}
+
+/*****************************************************************************/
+
+LatestFrameQueue::LatestFrameQueue(size_t depth) :
+  slots(depth ? depth : 1), times(slots.size()), head(0), count(0), closed(false) {
+}
+
+bool LatestFrameQueue::push(const uint8_t *data, size_t len) {
+  bool dropped = false;
+  {
+    std::lock_guard<std::mutex> hold(lock);
+    if(count == slots.size()) {
+      // Full: the oldest waiting frame makes way
+      head = (head + 1) % slots.size();
+      count--;
+      dropped = true;
+    }
+    slots[(head + count) % slots.size()].assign(data, data + len);
+    times[(head + count) % slots.size()] = Clock::now();
+    count++;
+  }
+  ready.notify_one();
+  return dropped;
+}
+
+bool LatestFrameQueue::pop(std::vector<uint8_t> &out, Time *pushed) {
+  std::unique_lock<std::mutex> hold(lock);
+  ready.wait(hold, [this]() { return count > 0 || closed; });
+  if(count == 0) return false;
+  if(pushed) *pushed = times[head];
+  // Swap rather than copy; the slot keeps out's old buffer for reuse
+  out.swap(slots[head]);
+  head = (head + 1) % slots.size();
+  count--;
+  return true;
+}
+
+void LatestFrameQueue::close(void) {
+  {
+    std::lock_guard<std::mutex> hold(lock);
+    closed = true;
+  }
+  ready.notify_all();
+}
+
+void LatestFrameQueue::reset(void) {
+  std::lock_guard<std::mutex> hold(lock);
+  head   = count = 0;
+  closed = false;
+}
+
+size_t LatestFrameQueue::waiting(void) {
+  std::lock_guard<std::mutex> hold(lock);
+  return count;
+}
+
+/*****************************************************************************/
+
+WallStream::WallStream(uint32_t numLEDs, size_t depth) :
+  leds(numLEDs), fd(-1), inFd(-1), terminal(false), queueing(false), queue(depth), useDelta(true), keyframes(60),
+  resident(200), useIndexed(true), maxColours(16), stopping(false), blankOnClose(false), maxLatency(0.15), sinceKeyframe(0), recorder(NULL), fpsFrames(0),
+  holding(false), packetBytes(6 + numLEDs * 3), linkRate(0), latency(0), fps(0),
+  showInterval(0), boardRate(0), haveReport(false), colourChanged(false), useColour(false),
+  shown(0), sent(0), dropped(0), late(0), deltas(0), indexed(0), bytes(0) {
+}
+
+WallStream::~WallStream(void) {
+  close(false);
+}
+
+bool WallStream::open(const char *path) {
+  if(fd >= 0) return false;
+  // The header's 16-bit count is LEDs - 1
+  if((leds < 1) || (leds > 65536)) return false;
+  fd = ::open(path, O_WRONLY | O_CREAT | O_NOCTTY | O_NONBLOCK, 0644);
+  if(fd < 0) return false;
+  struct stat st;
+  terminal = isatty(fd);
+  queueing = terminal || ((fstat(fd, &st) == 0) && S_ISFIFO(st.st_mode));
+  if(terminal) {
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      cfsetispeed(&tio, B115200);
+      cfsetospeed(&tio, B115200);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+    // The board's replies
+    inFd = ::open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+  }
+  queue.reset();
+  last.clear();              // First frame goes in full
+  // 115200 baud, 10 bits a byte, until measured
+  pacer.reset(11520);
+  linkRate    = pacer.rate();
+  packetBytes = 6 + leds * 3;
+  fpsStart    = Clock::now();
+  fpsFrames   = 0;
+  haveReport  = false;
+  stopping = false;
+  writer   = std::thread(&WallStream::run, this);
+  return true;
+}
+
+void WallStream::close(bool blank) {
+  if(fd < 0) return;
+  // The writer sends the blank frame itself once the queue is empty, so
+  // it can't take the place of the last frame shown
+  if(blank) shown++;
+  blankOnClose = blank;
+  stopping     = true;
+  queue.close();
+  writer.join();
+  ::close(fd);
+  fd = -1;
+  if(inFd >= 0) ::close(inFd);
+  inFd = -1;
+}
+
+void WallStream::show(const WallFrame &frame) {
+  show(frame.data(), frame.size());
+}
+
+void WallStream::show(const uint8_t *rgb, size_t len) {
+  if(len != leds * 3) return; // Header would disagree with the data
+  LatestFrameQueue::Time now = Clock::now();
+  if(shown++) showInterval = showInterval + 0.2 * (seconds(now - lastShow) - showInterval);
+  lastShow = now;
+  if(queue.push(rgb, len)) dropped++;
+}
+
+void WallStream::setDeltaFrames(bool on, int keyframeInterval, uint32_t boardLEDs) {
+  useDelta  = on;
+  keyframes = keyframeInterval;
+  resident  = boardLEDs;
+}
+
+void WallStream::setIndexedFrames(bool on, unsigned maxColours) {
+  useIndexed       = on;
+  this->maxColours = maxColours;
+}
+
+void WallStream::setPacing(double maxLatency) {
+  this->maxLatency = maxLatency;
+}
+
+bool WallStream::ready(double renderSeconds) {
+  if((fd < 0) || !queueing || (maxLatency <= 0)) return true;
+  if(queue.waiting()) return false;    // One's waiting its turn already
+  // The link takes the next frame once what's queued is down to a
+  // frame; a frame being held goes before it.
+  double rate = linkRate, n = packetBytes, q = portQueued();
+  double free = ((q > n) ? (q - n) / rate : 0) + (holding ? n / rate : 0);
+  return free <= renderSeconds;
+}
+
+void WallStream::setColour(const ColourSettings &s, bool on) {
+  std::lock_guard<std::mutex> hold(colourLock);
+  newColour     = s;
+  colourChanged = true;
+  useColour     = on;
+}
+
+WallStream::Stats WallStream::stats(void) const {
+  Stats s;
+  s.shown   = shown;
+  s.sent    = sent;
+  s.dropped = dropped;
+  s.late     = late;
+  s.deltas   = deltas;
+  s.indexed  = indexed;
+  s.bytes    = bytes;
+  s.latency  = latency;
+  s.fps      = fps;
+  s.linkRate = linkRate;
+  return s;
+}
+
+bool WallStream::requestTelemetry(uint16_t periodMs) {
+  uint8_t request[6];
+  size_t  n = telemetryRequest(request, periodMs);
+
+  if(fd < 0) return false;
+  std::lock_guard<std::mutex> hold(writeLock);
+  if(!writeAll(request, n)) return false;
+  bytes += n;
+  return true;
+}
+
+bool WallStream::telemetry(BoardTelemetry &t) {
+  uint8_t buf[256];
+  ssize_t n;
+  bool    got = false;
+
+  if(inFd < 0) return false;
+  while((n = ::read(inFd, buf, sizeof(buf))) > 0) {
+    if(fromBoard.feed(buf, n)) got = true;
+  }
+  if(!got || !fromBoard.latest(t)) return false;
+  // The link carries at least what the board says it received
+  uint32_t ms = t.millis - lastReport.millis;
+  if(haveReport && (ms > 0) && (ms < 0x80000000UL)) {
+    boardRate = (t.received - lastReport.received) * 1000.0 / ms;
+  }
+  lastReport = t;
+  haveReport = true;
+  return true;
+}
+
+// Writer thread: send each frame as it comes, newest first.  Colour
+// correction happens here rather than in show(), so frames that are
+// dropped cost nothing and dithering advances once per frame sent.
+void WallStream::run(void) {
+  LatestFrameQueue::Time shownAt;
+
+  while(queue.pop(next, &shownAt)) {
+    pace(shownAt);
+    send(shownAt);
+  }
+  if(blankOnClose) {
+    next.assign(leds * 3, 0);
+    send(Clock::now());
+  }
+}
+
+// Colour-corrects, encodes and writes the frame in next[].
+void WallStream::send(const LatestFrameQueue::Time &shownAt) {
+  bool correct;
+
+  {
+    std::lock_guard<std::mutex> hold(colourLock);
+    if(colourChanged) colour.set(newColour);
+    colourChanged = false;
+    correct       = useColour;
+  }
+  if(correct) colour.apply(&next[0], &next[0], leds);
+  size_t n = encode();
+  bool   written;
+  size_t queued;
+  {
+    std::lock_guard<std::mutex> hold(writeLock);
+    queued = portQueued();
+    pacer.sample(seconds(Clock::now().time_since_epoch()), bytes, queued);
+    written = writeAll(&packet[0], n);
+    if(written) bytes += n;
+  }
+  if(!written) {
+    sinceKeyframe = keyframes; // Board state unknown; resync in full
+    return;
+  }
+  if(recorder) recorder->add(&next[0], next.size());
+  sent++;
+  last.assign(next.begin(), next.end());
+
+  // Shown to on the board: waiting here, then behind what was queued
+  LatestFrameQueue::Time now = Clock::now();
+  double took = seconds(now - shownAt) + pacer.drainTime(queued, n);
+  latency     = (sent == 1) ? took : latency + 0.1 * (took - latency);
+  packetBytes = n;
+  linkRate    = pacer.rate();
+  fpsFrames++;
+  if(seconds(now - fpsStart) >= 1) {
+    fps       = fpsFrames / seconds(now - fpsStart);
+    fpsStart  = now;
+    fpsFrames = 0;
+  }
+}
+
+// Holds the frame in next[] while the link still has more than a frame
+// to send, taking newer frames in its place as they come.  A frame that
+// would then reach the board later than maxLatency after it was shown
+// waits a little longer for the next, if that's due soon enough to make
+// it, and gives way to it; if none comes it goes anyway.
+void WallStream::pace(LatestFrameQueue::Time &shownAt) {
+  double budget = maxLatency;
+  size_t queued;
+
+  if(!queueing || (budget <= 0)) return;
+  holding = true;
+  for(;;) {
+    double board = boardRate.exchange(0);
+    if(board > 0) pacer.atLeast(board);
+    queued = portQueued();
+    pacer.sample(seconds(Clock::now().time_since_epoch()), bytes, queued);
+    if(queue.waiting() && queue.pop(next, &shownAt)) {
+      dropped++;
+      continue;
+    }
+    if((queued > packetBytes) && !stopping) {
+      double wait = (queued - packetBytes) / pacer.rate();
+      std::this_thread::sleep_for(std::chrono::duration<double>((wait < 0.002) ? wait : 0.002));
+      continue;
+    }
+
+    double drain = pacer.drainTime(queued, packetBytes), interval = showInterval;
+    if(stopping || (seconds(Clock::now() - shownAt) + drain <= budget) ||
+       (interval >= budget - drain)) break;
+    Clock::time_point until = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(2 * interval));
+    while(!queue.waiting() && !stopping && (Clock::now() < until)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if(!queue.waiting() || !queue.pop(next, &shownAt)) break;
+    dropped++;
+    late++;
+  }
+  holding  = false;
+  linkRate = pacer.rate();
+}
+
+// Bytes written but not yet taken by the link: in a terminal's output
+// buffer, or a FIFO not yet read.  Files have none.
+size_t WallStream::portQueued(void) const {
+  int n = 0;
+  if((ioctl(fd, terminal ? TIOCOUTQ : FIONREAD, &n) < 0) || (n < 0)) return 0;
+  return n;
+}
+
+// Builds the packet for next[] in packet[]; returns its length.  The
+// smallest of a delta frame, a palette frame and a plain one is sent.
+size_t WallStream::encode(void) {
+  size_t full = 6 + next.size(), few = full, n = 0;
+
+  if(packet.size() < full) packet.resize(full);
+  if(useIndexed) {
+    palette.setMaxColours(maxColours);
+    if(palette.build(&next[0], leds)) few = FramePalette::packetSize(leds, palette.colours());
+    if(few - 6 > 0xffff) few = full; // Payload size must fit the header
+  }
+  // Records past what the board keeps would be dropped there
+  if(useDelta && (leds <= resident) && (sinceKeyframe < keyframes) &&
+     (last.size() == next.size())) {
+    n = encodeDelta();
+  }
+  if((n > 0) && (n < full) && (n < few)) {
+    sinceKeyframe++;
+    deltas++;
+    return n;
+  }
+  if(few < full) {
+    sinceKeyframe = 0; // Whole frame, as good as a keyframe
+    indexed++;
+    return palette.encode(&packet[0]);
+  }
+
+  // Same header the sketches send: magic word, LED count minus one (high
+  // byte first), then a checksum of the two.
+  uint16_t count = leds - 1;
+  packet[0] = 'A';
+  packet[1] = 'd';
+  packet[2] = 'a';
+  packet[3] = count >> 8;
+  packet[4] = count;
+  packet[5] = packet[3] ^ packet[4] ^ 0x55;
+  memcpy(&packet[6], &next[0], next.size());
+  sinceKeyframe = 0;
+  return full;
+}
+
+// Delta frame of the LEDs that changed since the last frame sent; see
+// LEDstream for the format.  Each run of changed LEDs becomes one record
+// (starting LED, count - 1, RGB data).  Single unchanged LEDs between two
+// runs are sent anyway, as that costs the same as the 3-byte header of a
+// new record.  Returns 0 if it would be no smaller than a full frame.
+size_t WallStream::encodeDelta(void) {
+  const size_t limit = packet.size();
+  uint32_t     i = 0, start, end, count;
+  size_t       n = 6;
+  auto changed = [&](uint32_t k) { return memcmp(&next[k * 3], &last[k * 3], 3) != 0; };
+
+  while(i < leds) {
+    if(!changed(i)) {
+      i++;
+      continue;
+    }
+    start = i;
+    end   = i + 1; // Exclusive
+    while((end < leds) && (end - start < 256)) {
+      if(changed(end)) {
+        end++;
+      } else if((end + 1 < leds) && (end + 2 - start <= 256) && changed(end + 1)) {
+        end += 2;
+      } else {
+        break;
+      }
+    }
+    count = end - start;
+    if(n + 3 + count * 3 >= limit) return 0;
+    packet[n++] = start >> 8;
+    packet[n++] = start;
+    packet[n++] = count - 1;
+    memcpy(&packet[n], &next[start * 3], count * 3);
+    n += count * 3;
+    i  = end;
+  }
+
+  packet[0] = 'A';
+  packet[1] = 'd';
+  packet[2] = 'D';
+  packet[3] = (n - 6) >> 8;
+  packet[4] = (n - 6);
+  packet[5] = packet[3] ^ packet[4] ^ 0x55;
+  return n;
+}
+
+// Write everything, waiting for the port as long as it takes -- except
+// when closing, where a port that takes nothing for 100 ms is given up on.
+bool WallStream::writeAll(const uint8_t *data, size_t len) {
+  while(len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if(n > 0) {
+      data += n;
+      len  -= n;
+    } else if((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+      return false;
+    } else {
+      struct pollfd p = { fd, POLLOUT, 0 };
+      if((poll(&p, 1, 100) == 0) && stopping) return false;
+      if(p.revents & (POLLERR | POLLHUP)) return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,234 @@
+// Native host-side streaming to a wall running LEDstream, in place of the
+// serial code every Processing sketch copies from CommunicationTemplate.
+//
+// A program draws into a WallFrame (same spc()/gpc() grid and serpentine
+// wiring as the sketches) and hands it to WallStream::show(), which only
+// copies it into a small queue and returns.  A writer thread takes frames
+// from the queue, encodes them ('Ada' frames, or 'AdD' delta or 'AdP'
+// palette frames when smaller) and writes them to the serial port.  The
+// queue is bounded and the newest frame always wins: when the link can't
+// keep up, frames not yet started are dropped rather than queueing up
+// lag, and rendering never waits for the port.
+//
+// The port's own buffer would still queue up lag, so frames are paced
+// (LinkPacer.h): each is held until the link has little more than a
+// frame's worth left to send, and one that would reach the board later
+// than the latency allowed gives way to a newer one if that comes in time.
+// ready() tells a render loop whether a frame drawn now would go out
+// straight away, so it can skip drawing ones that wouldn't.
+//
+// Anything a WS2801FileOutput can open works as the port: a serial
+// device, a FIFO, a file, or a pseudo-terminal (see Fuzz/WallStreamPty.cpp).
+// What's sent can be recorded for replay with record() (FrameRecording.h).
+// On a serial port the board's telemetry can be asked for and read back
+// (Telemetry.h), to see whether the link or the drawing limits the rate.
+
+#ifndef LEDWALL_WALLSTREAM_H
+#define LEDWALL_WALLSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ColourPipeline.h"
+#include "FramePalette.h"
+#include "LinkPacer.h"
+#include "Telemetry.h"
+
+class FrameRecorder;
+
+// RGB pixels in strand order, addressed either directly or by grid
+// position.  Even rows run left to right, odd rows right to left.
+class WallFrame {
+ public:
+  WallFrame(uint16_t w, uint16_t h);
+
+  uint16_t w(void) const { return width; }
+  uint16_t h(void) const { return height; }
+  uint32_t numPixels(void) const { return (uint32_t)width * height; }
+
+  // Column x, row y; out-of-range positions are ignored (or read as -1),
+  // as in the sketches.
+  void     spc(int x, int y, uint32_t c);
+  int32_t  gpc(int x, int y) const;
+  void     setPixelColor(uint32_t n, uint32_t c);
+  uint32_t getPixelColor(uint32_t n) const;
+  void     fill(uint32_t c);
+
+  const uint8_t *data(void) const { return &rgb[0]; }
+  size_t         size(void) const { return rgb.size(); }
+
+ private:
+  size_t offset(int x, int y) const;
+
+  uint16_t             width, height;
+  std::vector<uint8_t> rgb;
+};
+
+// Bounded queue of frames where, once full, each new frame replaces the
+// oldest one waiting.  Slots keep their buffers, so after the first few
+// frames nothing is allocated.
+class LatestFrameQueue {
+ public:
+  LatestFrameQueue(size_t depth);
+
+  typedef std::chrono::steady_clock::time_point Time;
+
+  // Copies a frame in; returns true if a waiting frame was dropped to
+  // make room.
+  bool push(const uint8_t *data, size_t len);
+  // Waits for a frame and swaps it into out, with when it was pushed if
+  // pushed isn't NULL; false once closed and empty.
+  bool pop(std::vector<uint8_t> &out, Time *pushed = NULL);
+  // Wakes pop() for good; frames still queued are handed out first.
+  void close(void);
+  // Empties the queue and opens it again.
+  void reset(void);
+  size_t waiting(void);
+
+ private:
+  std::mutex                        lock;
+  std::condition_variable           ready;
+  std::vector<std::vector<uint8_t>> slots;
+  std::vector<Time>                 times;
+  size_t                            head, count;
+  bool                              closed;
+};
+
+class WallStream {
+ public:
+  struct Stats {
+    unsigned long
+      shown,         // Frames passed to show()
+      sent,          // Frames written in full
+      dropped,       // Frames replaced in the queue before being sent
+      late,          // Of those dropped, how many for being too late
+      deltas,        // Of those sent, how many as delta frames
+      indexed,       // and how many as palette frames
+      bytes;         // Bytes written to the port
+    double
+      latency,       // Seconds from show() to the board having the frame
+                     // (estimated, smoothed over the last few frames)
+      fps,           // Frames sent per second, over the last second or so
+      linkRate;      // Bytes per second the link is taking (estimated)
+  };
+
+  // numLEDs must match what show() is given; depth is how many frames
+  // may wait for the port (1 = only ever the newest).
+  WallStream(uint32_t numLEDs, size_t depth = 1);
+  ~WallStream(void);
+
+  // Opens a serial device (set to raw, 115200 baud if it's a terminal)
+  // or other file and starts the writer thread.  False if it can't, or
+  // if numLEDs isn't from 1 to 65536 (what a frame header can say).
+  bool open(const char *path);
+  bool isOpen(void) const { return fd >= 0; }
+  // Sends what's queued, then (if blank) an all-off frame, and stops.
+  void close(bool blank = true);
+
+  // Queue a frame; never waits for the port.
+  void show(const WallFrame &frame);
+  void show(const uint8_t *rgb, size_t len);
+
+  // Pacing, on by default: frames should reach the board within
+  // maxLatency seconds of show().  0 turns it off, and every frame taken
+  // from the queue is written at once.  Only a terminal or FIFO is paced;
+  // a file takes everything at once.
+  void setPacing(double maxLatency);
+  // Whether a frame shown renderSeconds from now would be sent without
+  // waiting (nothing else waiting, the link about ready for it); when
+  // not, drawing it is likely wasted.  Always true when not pacing.
+  bool ready(double renderSeconds = 0);
+
+  // Delta frames, with a full frame at least every keyframeInterval
+  // frames, as in CommunicationTemplate.  Off for the old LEDstream.
+  // The board applies them to a copy of the last frame only boardLEDs
+  // long (LEDstream's MAXLEDS) and drops records past it, so a wall with
+  // more LEDs than that is sent plain or palette frames only.
+  void setDeltaFrames(bool on, int keyframeInterval = 60, uint32_t boardLEDs = 200);
+  // Palette frames (FramePalette.h) for frames of maxColours colours or
+  // fewer, when smaller than the alternatives; they count as full frames
+  // for the keyframe interval.  16 suits every board; up to 256 for
+  // boards that aren't AVRs.  Off for LEDstream before palette frames.
+  void setIndexedFrames(bool on, unsigned maxColours = 16);
+
+  // Colour-correct frames (gamma, white balance, brightness, dithering)
+  // as they are sent.  Off until first set; off again with on = false.
+  void setColour(const ColourSettings &s, bool on = true);
+
+  // Adds every frame sent to a recording as well (from the writer
+  // thread): as sent, colour correction and all, and whole even when it
+  // went as a delta.  NULL to stop.  Change only while the stream is
+  // closed; the recording must be open before open().
+  void record(FrameRecorder *to) { recorder = to; }
+
+  Stats stats(void) const;
+
+  // Asks the board for telemetry now and every periodMs (0: just once),
+  // sent between frames.  False if the stream isn't open.
+  bool requestTelemetry(uint16_t periodMs);
+  // Reads what the board has sent; true, with t set, if a new report came
+  // in since the last call.  Only a terminal is read from (a FIFO or file
+  // would give back what was written), so elsewhere this is always
+  // false.  One thread at a time.
+  bool telemetry(BoardTelemetry &t);
+
+ private:
+  void   run(void);
+  void   send(const LatestFrameQueue::Time &shownAt);
+  size_t encode(void);
+  size_t encodeDelta(void);
+  void   pace(LatestFrameQueue::Time &shownAt);
+  size_t portQueued(void) const;
+  bool   writeAll(const uint8_t *data, size_t len);
+
+  uint32_t             leds;
+  int                  fd, inFd;
+  bool                 terminal, queueing; // queueing: has a buffer to measure
+  LatestFrameQueue     queue;
+  std::thread          writer;
+  std::atomic<bool>    useDelta;
+  std::atomic<int>     keyframes;
+  std::atomic<uint32_t> resident;       // LEDs the board keeps for deltas
+  std::atomic<bool>    useIndexed;
+  std::atomic<unsigned> maxColours;
+  std::atomic<bool>    stopping;
+  std::atomic<bool>    blankOnClose;
+  std::atomic<double>  maxLatency;
+
+  // Writer thread only:
+  std::vector<uint8_t> next, last, packet;
+  int                  sinceKeyframe;
+  ColourPipeline       colour;
+  FramePalette         palette;
+  FrameRecorder       *recorder;
+  LinkPacer            pacer;
+  LatestFrameQueue::Time fpsStart;
+  unsigned long        fpsFrames;
+
+  // Pacing, as the writer last saw it, for ready() and stats()
+  std::atomic<bool>    holding;
+  std::atomic<size_t>  packetBytes;
+  std::atomic<double>  linkRate, latency, fps, showInterval, boardRate;
+  LatestFrameQueue::Time lastShow;
+
+  // Held while a packet is written, so requests go between frames
+  std::mutex           writeLock;
+  TelemetryReader      fromBoard;
+  BoardTelemetry       lastReport;
+  bool                 haveReport;
+
+  // Colour settings from setColour(), for the writer to pick up
+  std::mutex           colourLock;
+  ColourSettings       newColour;
+  bool                 colourChanged, useColour;
+
+  std::atomic<unsigned long>
+    shown, sent, dropped, late, deltas, indexed, bytes;
+};
+
+#endif
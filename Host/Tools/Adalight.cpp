@@ -0,0 +1,145 @@
+// Headless ModifiedAdalight: downsamples screens from image files or a
+// shared-memory frame buffer onto the wall with the native Downsampler,
+// colour-corrects them and streams them to the board with WallStream.
+//
+// Usage: adalight [-g WxH] [-t threads] [-n frames] [-p port [-s]] source...
+//
+//   -g   wall grid, serpentine as in the sketches (default 18x11)
+//   -t   downsampling threads (default: one per core)
+//   -n   stop after this many frames (default 100 from files; shared
+//        memory runs until interrupted)
+//   -p   serial port (or pty, FIFO...) to stream to; else only timed
+//   -s   print the board's telemetry as rates once a second, and whether
+//        the link or the capture is what limits the frame rate
+//
+// source is shm:<name> for a SharedFrame, or one or more PPM files, which
+// are shown in turn, over and over.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../Capture/Downsampler.h"
+#include "../Capture/FrameSource.h"
+#include "../Stream/WallStream.h"
+
+typedef std::chrono::steady_clock Time;
+
+int main(int argc, char **argv) {
+  unsigned gw = 18, gh = 11;
+  int      threads = std::thread::hardware_concurrency(), c;
+  long     frames  = -1;
+  char    *port    = NULL;
+  bool     report  = false;
+
+  while((c = getopt(argc, argv, "g:t:n:p:s")) != -1) {
+    switch(c) {
+     case 'g': sscanf(optarg, "%ux%u", &gw, &gh); break;
+     case 't': threads = atoi(optarg);           break;
+     case 'n': frames  = atol(optarg);           break;
+     case 'p': port    = optarg;                 break;
+     case 's': report  = true;                   break;
+     default:  return 2;
+    }
+  }
+  if((optind >= argc) || !gw || !gh) {
+    fprintf(stderr, "usage: %s [-g WxH] [-t threads] [-n frames] [-p port [-s]] shm:<name> | file.ppm...\n", argv[0]);
+    return 2;
+  }
+
+  // Screens: shared memory, or every file loaded up front
+  SharedFrame                         shared;
+  std::vector<std::vector<uint32_t> > files;
+  uint32_t                            w = 0, h = 0;
+  if(strncmp(argv[optind], "shm:", 4) == 0) {
+    if(!shared.open(argv[optind] + 4)) {
+      fprintf(stderr, "Can't open shared frame %s\n", argv[optind] + 4);
+      return 1;
+    }
+    w = shared.width();
+    h = shared.height();
+  } else {
+    for(int a = optind; a < argc; a++) {
+      uint32_t fw, fh;
+      files.push_back(std::vector<uint32_t>());
+      if(!readPPM(argv[a], fw, fh, files.back()) || (w && ((fw != w) || (fh != h)))) {
+        fprintf(stderr, "Can't read %s (or it's a different size)\n", argv[a]);
+        return 1;
+      }
+      w = fw;
+      h = fh;
+    }
+    if(frames < 0) frames = 100;
+  }
+
+  std::vector<CaptureLed> leds;
+  for(unsigned y = 0; y < gh; y++) {
+    for(unsigned x = 0; x < gw; x++) {
+      CaptureLed l = { (uint16_t)((y & 1) ? gw - 1 - x : x), (uint16_t)y };
+      leds.push_back(l);
+    }
+  }
+  Downsampler          down(w, h, gw, gh, &leds[0], leds.size(), threads);
+  WallStream           stream(leds.size());
+  std::vector<uint8_t> rgb(leds.size() * 3);
+  if(port) {
+    if(!stream.open(port)) {
+      fprintf(stderr, "Can't open %s\n", port);
+      return 1;
+    }
+    stream.setColour(ColourSettings());
+    if(report) stream.requestTelemetry(1000);
+  }
+  TelemetryCollector collector;
+  BoardTelemetry     board;
+
+  double        busy = 0;
+  uint32_t      seen = shared.sequence();
+  unsigned long skipped = 0;
+  for(long f = 0; (frames < 0) || (f < frames); f++) {
+    const uint32_t *screen;
+    if(files.empty()) {
+      while(shared.sequence() == seen) usleep(1000); // Wait for a new frame
+      seen   = shared.sequence();
+      screen = shared.pixels();
+      // The link isn't ready for another: this one would only wait
+      if(port && !stream.ready()) {
+        skipped++;
+        continue;
+      }
+    } else {
+      screen = &files[f % files.size()][0];
+    }
+    Time::time_point t = Time::now();
+    down.process(screen, &rgb[0]);
+    busy += std::chrono::duration<double>(Time::now() - t).count();
+    if(port) stream.show(&rgb[0], rgb.size());
+    if(report && stream.telemetry(board)) {
+      WallStream::Stats s = stream.stats();
+      // Screens skipped count as drawn and dropped: the link wasn't ready
+      if(collector.add(board, s.shown + skipped, s.dropped + skipped)) {
+        const TelemetryRates &r = collector.rates();
+        printf("board: %.1f frames/s, %.0f bytes/s, %.1f%% waiting for data, "
+          "%.0f bad headers/s; %.1f drawn/s, %.1f dropped/s; limit: %s\n",
+          r.framesPerSec, r.bytesPerSec, r.holdShare * 100, r.badChecksumsPerSec,
+          r.shownPerSec, r.droppedPerSec, collector.limit());
+      }
+    }
+  }
+
+  long done = frames - skipped;
+  printf("%ld frames of %ux%u onto %ux%u, %d threads%s: %.3f ms/frame downsampling",
+    done, w, h, gw, gh, threads, down.usingAVX2() ? ", AVX2" : "", busy * 1000 / done);
+  if(skipped) printf(" (%lu skipped, the link being busy)", skipped);
+  printf("\n");
+  if(port) {
+    stream.close();
+    WallStream::Stats s = stream.stats();
+    printf("%lu frames sent, %lu dropped (%lu late); %.1f frames/s, %.0f ms latency, "
+      "link %.0f bytes/s\n", s.sent, s.dropped, s.late, s.fps, s.latency * 1000, s.linkRate);
+  }
+  return 0;
+}
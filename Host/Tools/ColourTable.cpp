@@ -0,0 +1,49 @@
+// Writes LEDstream/ColourTable.h: the ColourPipeline's levels, rounded to
+// 8 bits, as a table in flash for LEDstream built with COLOURTABLE.
+//
+// Usage: colourtable [gamma [red green blue [brightness]]] > ../LEDstream/ColourTable.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../Stream/ColourPipeline.h"
+
+int main(int argc, char **argv) {
+  ColourSettings s;
+  uint8_t        t[3 * 256];
+
+  if(argc > 1) s.gamma = atof(argv[1]);
+  if(argc > 4) {
+    s.red   = atoi(argv[2]);
+    s.green = atoi(argv[3]);
+    s.blue  = atoi(argv[4]);
+  }
+  if(argc > 5) s.brightness = atoi(argv[5]);
+  ColourPipeline(s).table(t);
+
+  printf("// Colour correction table for LEDstream (used when COLOURTABLE is\n"
+         "// defined): gamma %.2f, white balance %u/%u/%u, brightness %u.\n"
+         "// Generated by Host/Tools/ColourTable.cpp; regenerate rather than edit.\n\n",
+         s.gamma, s.red, s.green, s.blue, s.brightness);
+  printf("#ifndef _COLOURTABLE_H_\n#define _COLOURTABLE_H_\n\n"
+         "#ifdef __AVR__\n"
+         " #include <avr/pgmspace.h>\n"
+         "#else\n"
+         " #ifndef PROGMEM\n"
+         "  #define PROGMEM\n"
+         " #endif\n"
+         " #ifndef pgm_read_byte\n"
+         "  #define pgm_read_byte(addr) (*(const uint8_t *)(addr))\n"
+         " #endif\n"
+         "#endif\n\n"
+         "// colourTable[channel][value]; channel 0 = R, 1 = G, 2 = B\n"
+         "static const uint8_t colourTable[3][256] PROGMEM = {\n");
+  for(int c = 0; c < 3; c++) {
+    printf("  {");
+    for(int v = 0; v < 256; v++) {
+      printf("%s%3u%s", (v % 16) ? " " : "\n    ", t[c * 256 + v], (v < 255) ? "," : "");
+    }
+    printf(" }%s\n", (c < 2) ? "," : "");
+  }
+  printf("};\n\n#endif // _COLOURTABLE_H_\n");
+  return 0;
+}
@@ -0,0 +1,184 @@
+// Records what a program sends to the wall, for any program that speaks
+// the LEDstream protocol (a Processing sketch, Adalight...): reads the
+// byte stream it writes, passes it on to the board unchanged, and decodes
+// it with LEDstream's own state machine so every frame the wall would
+// show goes into a recording -- plain, delta and staged frames alike --
+// stamped with when it arrived.  Replay it with wallreplay.
+//
+// Usage: wallrecord [-p port] [-r] [-k frames] recording [input]
+//
+//   -p   serial port (or pty, FIFO...) to pass the stream on to
+//   -r   store frames raw rather than compressed
+//   -k   most frames between keyframes (default 60)
+//
+// input is a file or FIFO the program writes to (default: standard
+// input), e.g.  mkfifo /tmp/wall; wallrecord -p /dev/ttyACM0 show.lwr /tmp/wall
+// with the sketch's port pointed at /tmp/wall.  Stops at the end of the
+// input or on Ctrl-C.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+// Frames as big as the protocol's 16-bit LED count allows
+#define MAXLEDS 21845
+#include "../../LEDstream/LEDstreamCore.h"
+#include "../Stream/FrameRecording.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int) {
+  interrupted = 1;
+}
+
+// Simulated time for the state machine, as in the fuzzer: every call
+// moves it on a microsecond, so the latch wait ends at once and waiting
+// for the next frame never counts as the 15-second silence.
+class StepClock {
+ public:
+  unsigned long us;
+  StepClock() : us(0) {}
+  unsigned long micros(void) { return us++; }
+  unsigned long millis(void) { return us / 1000; }
+};
+
+// The program's output, passed on to the port as it's read.  Never
+// waits, as the state machine has work to do between reads; idle counts
+// the reads since data last came.
+class TeeSource {
+ public:
+  int           in, out;
+  bool          done;
+  unsigned long idle;
+  TeeSource() : in(0), out(-1), done(false), idle(0) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    struct pollfd p = { in, POLLIN, 0 };
+    ssize_t       n = 0;
+    if(!done && (poll(&p, 1, 0) > 0) && ((n = ::read(in, buf, len)) <= 0)) {
+      if((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) done = true;
+      n = 0;
+    }
+    if(n == 0) {
+      idle++;
+      return 0;
+    }
+    idle = 0;
+    for(ssize_t k = 0; (out >= 0) && (k < n); ) {
+      ssize_t w = ::write(out, buf + k, n - k);
+      if(w > 0) {
+        k += w;
+      } else if(errno != EINTR) {
+        perror("port");
+        out = -1;
+      }
+    }
+    return n;
+  }
+  void write(const uint8_t *, uint8_t) { } // ACKs go nowhere
+};
+
+// SPI output: each latched frame goes into the recording.
+class RecordSink {
+ public:
+  FrameRecorder        recorder;
+  std::vector<uint8_t> current;
+  const char          *path;
+  bool                 compress;
+  int                  keyframes;
+  unsigned long        skipped;
+  RecordSink() : path(NULL), compress(true), keyframes(60), skipped(0) {}
+  bool ready(void) { return true; }
+  void write(uint8_t b) { current.push_back(b); }
+  void indicator(bool on) {
+    if(!on) return;
+    // The first frame sets the size of the wall
+    if(!recorder.isOpen() && !current.empty() &&
+       !recorder.create(path, current.size() / 3, compress, keyframes)) {
+      perror(path);
+      exit(1);
+    }
+    if(!recorder.add(&current[0], current.size())) skipped++;
+    current.clear();
+  }
+};
+
+int main(int argc, char **argv) {
+  TeeSource  source;
+  RecordSink sink;
+  StepClock  clock;
+  int        c;
+
+  while((c = getopt(argc, argv, "p:rk:")) != -1) {
+    switch(c) {
+     case 'p':
+      if((source.out = open(optarg, O_WRONLY | O_CREAT | O_NOCTTY, 0644)) < 0) {
+        perror(optarg);
+        return 1;
+      }
+      if(isatty(source.out)) {
+        struct termios tio;
+        if(tcgetattr(source.out, &tio) == 0) {
+          cfmakeraw(&tio);
+          cfsetispeed(&tio, B115200);
+          cfsetospeed(&tio, B115200);
+          tcsetattr(source.out, TCSANOW, &tio);
+        }
+      }
+      break;
+     case 'r': sink.compress  = false;        break;
+     case 'k': sink.keyframes = atoi(optarg); break;
+     default:  return 2;
+    }
+  }
+  if((optind >= argc) || (argc - optind > 2)) {
+    fprintf(stderr, "usage: %s [-p port] [-r] [-k frames] recording [input]\n", argv[0]);
+    return 2;
+  }
+  sink.path = argv[optind];
+  if((optind + 1 < argc) && ((source.in = open(argv[optind + 1], O_RDONLY)) < 0)) {
+    perror(argv[optind + 1]);
+    return 1;
+  }
+  signal(SIGINT, interrupt);
+  signal(SIGTERM, interrupt);
+
+  LEDstreamCore<TeeSource, RecordSink, StepClock, 16384> core(source, sink, clock);
+  core.begin();
+  while(!source.done && !interrupted) {
+    core.poll();
+    // Everything received has long been dealt with: wait for more
+    // without spinning
+    if(source.idle > 100000) usleep(1000);
+  }
+  // What's still buffered, until nothing more comes out
+  for(unsigned long quiet = 0; !interrupted && (quiet < 100000); quiet++) {
+    uint32_t seen = sink.recorder.frames();
+    core.poll();
+    if(sink.recorder.frames() != seen) quiet = 0;
+  }
+
+  if(!sink.recorder.isOpen()) {
+    fprintf(stderr, "No frames\n");
+    return 1;
+  }
+  uint32_t frames = sink.recorder.frames();
+  uint64_t bytes  = sink.recorder.bytes();
+  if(!sink.recorder.close()) {
+    perror(sink.path);
+    return 1;
+  }
+  FrameReplay check;
+  check.open(sink.path);
+  printf("%u frames of %u LEDs, %.1f s: %llu bytes (%.1f%% of raw)",
+    frames, check.numLEDs(), frames ? check.time(frames - 1) / 1e6 : 0,
+    (unsigned long long)bytes, 100.0 * bytes / ((double)frames * check.numLEDs() * 3 + 1));
+  if(sink.skipped) printf(", %lu frames of other sizes left out", sink.skipped);
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Plays a recording (from wallrecord or WallStream::record()) back: to a
+// board through WallStream, or through LEDstream's state machine in
+// process, checking that every frame comes out as recorded.  Either way
+// frames are spaced as they were recorded, or sent back to back.
+//
+// Usage: wallreplay [-p port] [-x speed | -f] [-s first] [-n frames] [-l] recording
+//
+//   -p   serial port (or pty, FIFO...) to stream to; else simulated
+//   -x   playback speed (default 1, as recorded)
+//   -f   as fast as possible
+//   -s   first frame (default 0)
+//   -n   frames to play (default: to the end)
+//   -l   loop until interrupted
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+#define MAXLEDS 21845
+#include "../../LEDstream/LEDstreamCore.h"
+#include "../Stream/FrameRecording.h"
+#include "../Stream/WallStream.h"
+
+typedef std::chrono::steady_clock Time;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int) {
+  interrupted = 1;
+}
+
+// The simulated board: each frame goes in as an 'Ada' packet, and what's
+// shifted out up to the latch must be the frame again.
+class StepClock {
+ public:
+  unsigned long us;
+  StepClock() : us(0) {}
+  unsigned long micros(void) { return us++; }
+  unsigned long millis(void) { return us / 1000; }
+};
+
+class PacketSource {
+ public:
+  std::vector<uint8_t> in;
+  size_t               pos;
+  PacketSource() : pos(0) {}
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    if(len > in.size() - pos) len = in.size() - pos;
+    memcpy(buf, &in[pos], len);
+    pos += len;
+    return len;
+  }
+  void write(const uint8_t *, uint8_t) { }
+};
+
+class FrameSink {
+ public:
+  std::vector<uint8_t> current;
+  bool                 latched;
+  FrameSink() : latched(false) {}
+  bool ready(void) { return true; }
+  void write(uint8_t b) { current.push_back(b); }
+  void indicator(bool on) { if(on) latched = true; }
+};
+
+struct Simulator {
+  PacketSource source;
+  FrameSink    sink;
+  StepClock    clock;
+  LEDstreamCore<PacketSource, FrameSink, StepClock, 16384> core;
+  unsigned long bytes, wrong;
+
+  Simulator() : core(source, sink, clock), bytes(0), wrong(0) { core.begin(); }
+
+  void show(const uint8_t *rgb, size_t len) {
+    uint16_t count = len / 3 - 1;
+    uint8_t  h[6]  = { 'A', 'd', 'a', (uint8_t)(count >> 8), (uint8_t)count, 0 };
+    h[5] = h[3] ^ h[4] ^ 0x55;
+    source.in.assign(h, h + 6);
+    source.in.insert(source.in.end(), rgb, rgb + len);
+    source.pos = 0;
+    sink.current.clear();
+    sink.latched = false;
+    for(int n = 0; !sink.latched && (n < 1000000); n++) core.poll();
+    bytes += source.in.size();
+    if((sink.current.size() != len) || memcmp(&sink.current[0], rgb, len)) wrong++;
+  }
+};
+
+int main(int argc, char **argv) {
+  double   speed = 1;
+  uint32_t first = 0, count = UINT32_MAX;
+  bool     loop  = false;
+  char    *port  = NULL;
+  int      c;
+
+  while((c = getopt(argc, argv, "p:x:fs:n:l")) != -1) {
+    switch(c) {
+     case 'p': port  = optarg;       break;
+     case 'x': speed = atof(optarg); break;
+     case 'f': speed = 0;            break;
+     case 's': first = atol(optarg); break;
+     case 'n': count = atol(optarg); break;
+     case 'l': loop  = true;         break;
+     default:  return 2;
+    }
+  }
+  if((optind != argc - 1) || (speed < 0)) {
+    fprintf(stderr, "usage: %s [-p port] [-x speed | -f] [-s first] [-n frames] [-l] recording\n", argv[0]);
+    return 2;
+  }
+
+  FrameReplay replay;
+  struct stat st;
+  if(!replay.open(argv[optind]) || stat(argv[optind], &st)) {
+    fprintf(stderr, "Can't read recording %s\n", argv[optind]);
+    return 1;
+  }
+  uint32_t frames = replay.frames(), leds = replay.numLEDs();
+  printf("%s: %u frames of %u LEDs, %.1f s, %lld bytes (%.1f%% of raw)\n", argv[optind],
+    frames, leds, frames ? replay.time(frames - 1) / 1e6 : 0, (long long)st.st_size,
+    100.0 * st.st_size / ((double)frames * leds * 3 + 1));
+  if(first >= frames) return 0;
+  uint32_t last = (count < frames - first) ? first + count - 1 : frames - 1;
+
+  WallStream stream(leds);
+  Simulator  sim;
+  if(port && !stream.open(port)) {
+    fprintf(stderr, "Can't open %s\n", port);
+    return 1;
+  }
+  signal(SIGINT, interrupt);
+  signal(SIGTERM, interrupt);
+
+  Time::time_point start = Time::now();
+  unsigned long    shown = 0;
+  do {
+    shown += replay.play([&](const uint8_t *rgb, size_t len, uint32_t) {
+      if(port) stream.show(rgb, len);
+      else     sim.show(rgb, len);
+      return !interrupted;
+    }, speed, first, last);
+  } while(loop && !interrupted);
+  double secs = std::chrono::duration<double>(Time::now() - start).count();
+
+  printf("%lu frames in %.2f s: %.1f frames/s", shown, secs, shown / secs);
+  if(shown < (unsigned long)(last - first + 1) && !interrupted) printf(" (stopped at a damaged frame)");
+  printf("\n");
+  if(port) {
+    stream.close();
+    WallStream::Stats s = stream.stats();
+    printf("%lu frames sent (%lu as deltas), %lu dropped, %lu bytes\n",
+      s.sent, s.deltas, s.dropped, s.bytes);
+    return 0;
+  }
+  printf("Simulated: %lu bytes streamed, %lu frames came out wrong\n", sim.bytes, sim.wrong);
+  return sim.wrong ? 1 : 0;
+}
@@ -71,44 +71,108 @@
 // XOR 0x55).  LED data follows, 3 bytes per LED, in order R, G, B,
 // where 0 = off and 255 = max brightness.
 
-static const uint8_t magic[] = {'A','d','a'};
-#define MAGICSIZE  sizeof(magic)
-#define HEADERSIZE (MAGICSIZE + 3)
-
-#define MODE_HEADER 0
-#define MODE_HOLD   1
-#define MODE_DATA   2
+// Delta frames carry only the pixels that changed since the previous
+// frame.  The header is the same as above except that the last character
+// of the magic word is 'D', and the 16-bit count is the number of payload
+// bytes that follow (not LEDs).  The payload is a series of records, each
+// a 16-bit starting LED index (high byte first), a count of LEDs minus 1
+// (so 1 to 256 LEDs per record), then that many R, G, B triplets.  Records
+// are applied to a resident copy of the last frame, which is then shifted
+// out in full.  Plain 'Ada' frames also refresh the resident copy, so the
+// host may fall back to them at any time (and should, now and then, in
+// case a delta was lost).  The resident copy is only MAXLEDS LEDs long
+// (200 unless set otherwise): data for LEDs past it is read and thrown
+// away, and counted as skipped in the telemetry, so a host driving a
+// longer strand must send it plain or palette frames instead.
+
+// Walls too big for one board are split across several, each on its own
+// serial port.  To make them all change at the same moment, the host
+// sends each board its part of the frame as a staged frame, then a latch
+// command to every board.  A staged frame ('AdS') is a delta frame that
+// is applied to the resident frame but not shown.  A latch command
+// ('AdL', count 0, no payload) shows the resident frame.
+
+// Effects with few colours can send a palette frame instead.  The magic
+// word ends in 'P' and the 16-bit count is the payload size.  The payload
+// is a 16-bit LED count minus 1 (high byte first), the number of colours
+// minus 1, the colours (R, G, B each), then each LED's colour as an index
+// into them: 4 bits when there are 16 colours or fewer (two LEDs a byte,
+// the first in the high half), else 8 bits.  It is shown like a plain
+// frame, and also refreshes the resident copy.  Boards take up to
+// PALETTESIZE colours (16 on AVRs, 256 elsewhere); a frame with more, or
+// with a payload of the wrong size, is ignored.
+
+// The board says it's there by sending "Ada\n" once a second while no
+// data arrives.  For a look at how streaming is going, the host sends a
+// telemetry request ('AdT', no payload), where the 16-bit count is a
+// period in milliseconds: the board answers at once with a telemetry
+// packet, then sends one every period in place of the ACKs (a period of
+// 0 asks for one packet and goes back to ACKs).  The packet is 'Adt', a
+// byte giving the payload size, the payload -- 32-bit counters, high
+// byte first: milliseconds since start, serial bytes received, frames
+// latched, bad header checksums, bytes skipped (looking for a header,
+// or delta data past MAXLEDS), pauses in mid-frame waiting for serial
+// data, and microseconds spent in those pauses -- then the payload
+// bytes XORed together and with 0x55.  Counters wrap around; hosts should look at differences
+// (Host/Stream/Telemetry.h turns them into rates).
+
+// The framing state machine itself is in LEDstreamCore.h, so that it
+// can be tested and benchmarked on a host computer (see Host/).  This
+// file supplies the Arduino's serial port, SPI and clock to it.
+
+// Uncomment to gamma-correct and white-balance on the board, for host
+// software that sends uncorrected colours (ColourTable.h is generated by
+// the host build; see Host/Tools/ColourTable.cpp).
+// #define COLOURTABLE
+
+// Uncomment to change the serial receive buffer from its default (256
+// bytes on AVRs, 2048 elsewhere); a power of two from 64 to 16384.  It
+// takes that many bytes of RAM: an Uno's 2 KB already holds the 600-byte
+// resident frame, so go no further than 512 there.  Past 256 the
+// buffer's indices are 16-bit, which costs a little speed on AVRs.
+// #define RINGSIZE 512
+
+#include "LEDstreamCore.h"
+
+// Serial data from the host, and ACKs back to it.  Reads take all the
+// bytes that have arrived at once: on USB boards (Teensy, 32u4) that is
+// a whole packet per call rather than a call per byte.
+class SerialSource {
+ public:
+  uint16_t read(uint8_t *buf, uint16_t len) {
+    int n = Serial.available();
+    if(n <= 0) return 0;
+    if((uint16_t)n > len) n = len;
+    return Serial.readBytes((char *)buf, n);
+  }
+  void write(const uint8_t *data, uint8_t len) { Serial.write(data, len); }
+};
+
+// Hardware SPI to the LEDs, plus the status LED (on while latching).
+class SPISink {
+ public:
+  bool ready(void) { return SPSR & _BV(SPIF); }
+  void write(uint8_t b) { SPDR = b; }
+  void indicator(bool on) {
+    if(on) LED_PORT |=  LED_PIN;
+    else   LED_PORT &= ~LED_PIN;
+  }
+};
 
-// If no serial data is received for a while, the LEDs are shut off
-// automatically.  This avoids the annoying "stuck pixel" look when
-// quitting LED display programs on the host computer.
-static const unsigned long serialTimeout = 15000; // 15 seconds
+class ArduinoClock {
+ public:
+  unsigned long micros(void) { return ::micros(); }
+  unsigned long millis(void) { return ::millis(); }
+};
 
 void setup()
 {
-  // Dirty trick: the circular buffer for serial data is 256 bytes,
-  // and the "in" and "out" indices are unsigned 8-bit types -- this
-  // much simplifies the cases where in/out need to "wrap around" the
-  // beginning/end of the buffer.  Otherwise there'd be a ton of bit-
-  // masking and/or conditional code every time one of these indices
-  // needs to change, slowing things down tremendously.
-  uint8_t
-    buffer[256],
-    indexIn       = 0,
-    indexOut      = 0,
-    mode          = MODE_HEADER,
-    hi, lo, chk, i, spiFlag;
-  int16_t
-    bytesBuffered = 0,
-    hold          = 0,
-    c;
-  int32_t
-    bytesRemaining;
-  unsigned long
-    startTime,
-    lastByteTime,
-    lastAckTime,
-    t;
+  SerialSource source;
+  SPISink      sink;
+  ArduinoClock clock;
+  LEDstreamCore<SerialSource, SPISink, ArduinoClock> stream(source, sink, clock);
+  uint8_t i;
+  int16_t c;
 
   LED_DDR  |=  LED_PIN; // Enable output for LED
   LED_PORT &= ~LED_PIN; // LED off
@@ -136,108 +200,12 @@ void setup()
     delay(1); // One millisecond pause = latch
   }
 
-  Serial.print("Ada\n"); // Send ACK string to host
-
-  startTime    = micros();
-  lastByteTime = lastAckTime = millis();
+  stream.begin(); // Sends ACK string to host
 
   // loop() is avoided as even that small bit of function overhead
   // has a measurable impact on this code's overall throughput.
 
-  for(;;) {
-
-    // Implementation is a simple finite-state machine.
-    // Regardless of mode, check for serial input each time:
-    t = millis();
-    if((bytesBuffered < 256) && ((c = Serial.read()) >= 0)) {
-      buffer[indexIn++] = c;
-      bytesBuffered++;
-      lastByteTime = lastAckTime = t; // Reset timeout counters
-    } else {
-      // No data received.  If this persists, send an ACK packet
-      // to host once every second to alert it to our presence.
-      if((t - lastAckTime) > 1000) {
-        Serial.print("Ada\n"); // Send ACK string to host
-        lastAckTime = t; // Reset counter
-      }
-      // If no data received for an extended time, turn off all LEDs.
-      if((t - lastByteTime) > serialTimeout) {
-        for(c=0; c<32767; c++) {
-          for(SPDR=0; !(SPSR & _BV(SPIF)); );
-        }
-        delay(1); // One millisecond pause = latch
-        lastByteTime = t; // Reset counter
-      }
-    }
-
-    switch(mode) {
-
-     case MODE_HEADER:
-
-      // In header-seeking mode.  Is there enough data to check?
-      if(bytesBuffered >= HEADERSIZE) {
-        // Indeed.  Check for a 'magic word' match.
-        for(i=0; (i<MAGICSIZE) && (buffer[indexOut++] == magic[i++]););
-        if(i == MAGICSIZE) {
-          // Magic word matches.  Now how about the checksum?
-          hi  = buffer[indexOut++];
-          lo  = buffer[indexOut++];
-          chk = buffer[indexOut++];
-          if(chk == (hi ^ lo ^ 0x55)) {
-            // Checksum looks valid.  Get 16-bit LED count, add 1
-            // (# LEDs is always > 0) and multiply by 3 for R,G,B.
-            bytesRemaining = 3L * (256L * (long)hi + (long)lo + 1L);
-            bytesBuffered -= 3;
-            spiFlag        = 0;         // No data out yet
-            mode           = MODE_HOLD; // Proceed to latch wait mode
-          } else {
-            // Checksum didn't match; search resumes after magic word.
-            indexOut  -= 3; // Rewind
-          }
-        } // else no header match.  Resume at first mismatched byte.
-        bytesBuffered -= i;
-      }
-      break;
-
-     case MODE_HOLD:
-
-      // Ostensibly "waiting for the latch from the prior frame
-      // to complete" mode, but may also revert to this mode when
-      // underrun prevention necessitates a delay.
-
-      if((micros() - startTime) < hold) break; // Still holding; keep buffering
-
-      // Latch/delay complete.  Advance to data-issuing mode...
-      LED_PORT &= ~LED_PIN;  // LED off
-      mode      = MODE_DATA; // ...and fall through (no break):
-
-     case MODE_DATA:
-
-      while(spiFlag && !(SPSR & _BV(SPIF))); // Wait for prior byte
-      if(bytesRemaining > 0) {
-        if(bytesBuffered > 0) {
-          SPDR = buffer[indexOut++];   // Issue next byte
-          bytesBuffered--;
-          bytesRemaining--;
-          spiFlag = 1;
-        }
-        // If serial buffer is threatening to underrun, start
-        // introducing progressively longer pauses to allow more
-        // data to arrive (up to a point).
-        if((bytesBuffered < 32) && (bytesRemaining > bytesBuffered)) {
-          startTime = micros();
-          hold      = 100 + (32 - bytesBuffered) * 10;
-          mode      = MODE_HOLD;
-	}
-      } else {
-        // End of data -- issue latch:
-        startTime  = micros();
-        hold       = 1000;        // Latch duration = 1000 uS
-        LED_PORT  |= LED_PIN;     // LED on
-        mode       = MODE_HEADER; // Begin next header search
-      }
-    } // end switch
-  } // end for(;;)
+  for(;;) stream.poll();
 }
 
 void loop()
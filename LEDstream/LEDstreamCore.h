@@ -0,0 +1,560 @@
+// Framing state machine for LEDstream, independent of the hardware it
+// runs on.  Serial input, SPI output and time are reached only through
+// the three classes the core is instantiated with, so the same code runs
+// in the sketch and in the host test and benchmark programs.
+//
+// The classes need only provide these members (nothing is virtual; the
+// compiler sees the real calls and inlines them, which matters as much
+// here as it did when everything lived in setup()):
+//
+//   Source:  uint16_t read(uint8_t *buf, uint16_t len); // up to len bytes
+//                                              // (those already received;
+//                                              // never waits), returns count
+//            void write(const uint8_t *data, uint8_t len); // to the host
+//   Sink:    bool ready(void);                   // previous byte sent?
+//            void write(uint8_t b);              // start sending b
+//            void indicator(bool on);            // status LED
+//   Clock:   unsigned long micros(void);
+//            unsigned long millis(void);
+//
+// The wire protocol is described in LEDstream.pde.
+
+#ifndef _LEDSTREAMCORE_H_
+#define _LEDSTREAMCORE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// For hosts that send colours uncorrected, define COLOURTABLE (before
+// including this) to pass every byte shifted out through the gamma and
+// white balance table in ColourTable.h.  The resident frame keeps the
+// colours as received, so delta frames still apply to them.
+#ifdef COLOURTABLE
+#include "ColourTable.h"
+#endif
+
+static const uint8_t magic[] = {'A','d','a'};
+#define MAGICSIZE  ((uint8_t)sizeof(magic))
+#define HEADERSIZE (MAGICSIZE + 3)
+
+static const uint8_t deltaMagic = 'D';
+static const uint8_t stageMagic = 'S';
+static const uint8_t latchMagic = 'L';
+static const uint8_t telemetryMagic = 'T';
+static const uint8_t paletteMagic = 'P';
+
+// Telemetry packets to the host: 'Adt', payload size, the counters below
+// (each 32 bits, high byte first), then a checksum (the payload bytes
+// XORed together, XOR 0x55).
+static const uint8_t telemetryReply[] = {'A','d','t'};
+
+// What the core has seen since it started.  Counting costs a few
+// instructions per header or serial read, never per byte; everything
+// wraps around at 2^32, so the host works with differences.
+struct LEDstreamCounters {
+  uint32_t
+    millis,                  // When reported
+    received,                // Serial bytes read
+    latched,                 // Frames shifted out and latched
+    badChecksums,            // Magic words followed by a wrong checksum
+    skipped,                 // Bytes thrown away looking for a header,
+                             // or delta data for LEDs past MAXLEDS
+    holds,                   // Pauses in mid-frame for serial data
+    holdMicros;              // Time spent in those pauses
+};
+#define TELEMETRYSIZE ((uint8_t)(sizeof(LEDstreamCounters) / 4))
+
+// Size of the resident frame, in LEDs.  Pixels beyond this are still
+// shown from plain frames but can't be updated by delta frames; delta
+// data for them is dropped (and counted as skipped).
+#ifndef MAXLEDS
+#define MAXLEDS    200
+#endif
+#define FRAMESIZE  (MAXLEDS * 3)
+
+// Most colours a palette frame may have.  16 needs only 4-bit indices
+// and 48 bytes of RAM, which small AVRs can spare; up to 256 (8-bit
+// indices) elsewhere.
+#ifndef PALETTESIZE
+#ifdef __AVR__
+#define PALETTESIZE 16
+#else
+#define PALETTESIZE 256
+#endif
+#endif
+
+// Serial receive buffer, in bytes; a power of two from 64 to 16384.  On
+// boards with RAM to spare it holds several whole frames, so the state
+// machine almost never has to pause for data; on small AVRs it stays at
+// 256 bytes.  Set it in LEDstream.pde (or with -D) to change it.
+#ifndef RINGSIZE
+#ifdef __AVR__
+#define RINGSIZE   256
+#else
+#define RINGSIZE   2048
+#endif
+#endif
+
+// Buffers of up to 256 bytes use 8-bit indices, which are cheaper on AVR
+// and wrap around on their own; bigger ones need 16 bits.  Either way
+// indices only ever increase, and are masked when the buffer is accessed.
+template<bool Wide> struct LEDstreamRingIndex       { typedef uint8_t  type; };
+template<>          struct LEDstreamRingIndex<true> { typedef uint16_t type; };
+
+#define MODE_HEADER 0
+#define MODE_HOLD   1
+#define MODE_DATA   2
+#define MODE_DELTA  3
+#define MODE_PALETTE 4
+
+// If no serial data is received for a while, the LEDs are shut off
+// automatically.  This avoids the annoying "stuck pixel" look when
+// quitting LED display programs on the host computer.
+static const unsigned long serialTimeout = 15000; // 15 seconds
+
+template<class Source, class Sink, class Clock, uint16_t RingSize = RINGSIZE>
+class LEDstreamCore {
+
+  static_assert(RingSize >= 64 && RingSize <= 16384 &&
+    (RingSize & (RingSize - 1)) == 0, "RingSize must be a power of two, 64 to 16384");
+
+  typedef typename LEDstreamRingIndex<(RingSize > 256)>::type Index;
+  static const Index mask = RingSize - 1;
+
+ public:
+
+  LEDstreamCore(Source &s, Sink &o, Clock &c) :
+    source(s), sink(o), clock(c) {
+    indexIn       = 0;
+    indexOut      = 0;
+    mode          = MODE_HEADER;
+    fromFrame     = 0;
+    channel       = 0;
+    staged        = 0;
+    spiFlag       = 0;
+    bytesBuffered = 0;
+    hold          = 0;
+    frameBytes    = 0;
+    framePos      = 0;
+    runBytes      = 0;
+    underrun      = 0;
+    indexed       = 0;
+    component     = 0;
+    nibble        = 0;
+    held          = 0;
+    paletteBytes  = 0;
+    palettePos    = 0;
+    indexBytes    = 0;
+    colour        = palette;
+    telemetryPeriod = 0;
+    memset(&counters, 0, sizeof(counters));
+    // A delta can arrive before any plain frame; pixels it doesn't
+    // cover should then be off rather than whatever was in RAM.
+    memset(frame, 0, sizeof(frame));
+  }
+
+  // Send the first ACK and start the clocks.
+  void begin(void) {
+    ack();
+    startTime    = clock.micros();
+    lastByteTime = lastAckTime = lastTelemetryTime = clock.millis();
+  }
+
+  // One pass of the state machine: take in whatever serial data has
+  // arrived (as much as fits), then do whatever the current mode calls
+  // for.  Never blocks (except to shut the LEDs off after a long
+  // silence).
+  void poll(void) {
+    uint8_t  hi, lo, chk, i, b;
+    uint16_t n, room;
+    unsigned long t;
+    int32_t  need;
+
+    // Implementation is a simple finite-state machine.
+    // Regardless of mode, check for serial input each time.  Read
+    // straight into the buffer, up to its end (the rest next time).
+    t    = clock.millis();
+    room = RingSize - bytesBuffered;
+    n    = RingSize - (indexIn & mask);
+    if(n > room) n = room;
+    if((n > 0) && ((n = source.read(&buffer[indexIn & mask], n)) > 0)) {
+      indexIn       += n;
+      bytesBuffered += n;
+      counters.received += n;
+      lastByteTime = lastAckTime = t; // Reset timeout counters
+    } else {
+      // No data received.  If this persists, send an ACK packet
+      // to host once every second to alert it to our presence
+      // (unless telemetry is going out anyway).
+      if(!telemetryPeriod && ((t - lastAckTime) > 1000)) {
+        ack();
+        lastAckTime = t; // Reset counter
+      }
+      // If no data received for an extended time, turn off all LEDs.
+      if((t - lastByteTime) > serialTimeout) {
+        blackout();
+        lastByteTime = t; // Reset counter
+      }
+    }
+    if(telemetryPeriod && ((t - lastTelemetryTime) >= telemetryPeriod)) telemetry(t);
+
+    switch(mode) {
+
+     case MODE_HEADER:
+
+      // In header-seeking mode.  Is there enough data to check?
+      if(bytesBuffered >= HEADERSIZE) {
+        // Indeed.  Check for a 'magic word' match.  All but the last
+        // character are common to both frame types; the last one tells
+        // plain frames from delta frames.
+        for(i=0; (i<MAGICSIZE-1) &&
+          (buffer[(Index)(indexOut + i) & mask] == magic[i]); i++);
+        b = buffer[(Index)(indexOut + i) & mask];
+        if((i == MAGICSIZE-1) && ((b == magic[i]) || (b == deltaMagic) ||
+          (b == stageMagic) || (b == latchMagic) || (b == telemetryMagic) ||
+          (b == paletteMagic))) {
+          // Magic word matches.  Now how about the checksum?
+          indexOut += MAGICSIZE;
+          hi  = buffer[indexOut++ & mask];
+          lo  = buffer[indexOut++ & mask];
+          chk = buffer[indexOut++ & mask];
+          if(chk == (hi ^ lo ^ 0x55)) {
+            if((b == deltaMagic) || (b == stageMagic)) {
+              // Checksum looks valid.  Get 16-bit payload size and
+              // start applying change records.
+              bytesRemaining = 256L * (long)hi + (long)lo;
+              runBytes       = 0;
+              staged         = (b == stageMagic);
+              mode           = MODE_DELTA;
+            } else if(b == paletteMagic) {
+              // Palette frame: 16-bit payload size; the palette comes
+              // next.
+              bytesRemaining = 256L * (long)hi + (long)lo;
+              paletteBytes   = 0;
+              mode           = MODE_PALETTE;
+            } else if(b == latchMagic) {
+              // Show the resident frame (no payload).
+              showFrame();
+            } else if(b == telemetryMagic) {
+              // Report now, then every count milliseconds (0: just
+              // now, and ACKs as before).
+              telemetryPeriod = 256 * (uint16_t)hi + lo;
+              telemetry(t);
+            } else {
+              // Checksum looks valid.  Get 16-bit LED count, add 1
+              // (# LEDs is always > 0) and multiply by 3 for R,G,B.
+              bytesRemaining = 3L * (256L * (long)hi + (long)lo + 1L);
+              startFrame(0);
+            }
+            bytesBuffered -= HEADERSIZE;
+          } else {
+            // Checksum didn't match; search resumes after magic word.
+            indexOut      -= 3; // Rewind
+            bytesBuffered -= MAGICSIZE;
+            counters.badChecksums++;
+            counters.skipped += MAGICSIZE;
+          }
+        } else {
+          // No header match.  Resume at first mismatched byte.
+          if(i == 0) i = 1;
+          indexOut      += i;
+          bytesBuffered -= i;
+          counters.skipped += i;
+        }
+      }
+      break;
+
+     case MODE_DELTA:
+
+      // Applying a delta frame's change records to the resident frame.
+      // Nothing goes out over SPI until the whole payload has arrived.
+      if(bytesRemaining <= 0) {
+        // All records applied -- shift out the resident frame, unless
+        // it is to wait for a latch command.
+        if(staged) mode = MODE_HEADER;
+        else       showFrame();
+      } else if(runBytes > 0) {
+        // Inside a record; copy as much of its pixel data as is here
+        // in one go, rather than a byte per trip round the loop (but
+        // not past the payload, if the record claims more than that).
+        n = ((int16_t)runBytes < bytesBuffered) ? runBytes : bytesBuffered;
+        if(n > bytesRemaining) n = bytesRemaining;
+        bytesBuffered  -= n;
+        bytesRemaining -= n;
+        runBytes       -= n;
+        while(n--) {
+          b = buffer[indexOut++ & mask];
+          if(framePos < FRAMESIZE) {
+            frame[framePos++] = b;
+            if(framePos > frameBytes) frameBytes = framePos;
+          } else {
+            counters.skipped++; // Past the resident frame
+          }
+        }
+      } else if(bytesRemaining < 3) {
+        bytesRemaining = 0; // Truncated record; ignore the rest
+      } else if(bytesBuffered >= 3) {
+        // Next record: starting LED, LED count - 1.
+        hi       = buffer[indexOut++ & mask];
+        lo       = buffer[indexOut++ & mask];
+        framePos = 256 * (uint16_t)hi + lo;
+        framePos = (framePos < MAXLEDS) ? (framePos * 3) : FRAMESIZE;
+        runBytes = 3 * ((uint16_t)buffer[indexOut++ & mask] + 1);
+        bytesBuffered  -= 3;
+        bytesRemaining -= 3;
+      }
+      break;
+
+     case MODE_PALETTE:
+
+      // Reading a palette frame's LED count and palette.  Its indices
+      // are turned into colours as they are shifted out.
+      if(paletteBytes == 0) {
+        if(bytesBuffered < 3) break;
+        // LED count - 1, then colours - 1
+        hi = buffer[indexOut++ & mask];
+        lo = buffer[indexOut++ & mask];
+        b  = buffer[indexOut++ & mask];
+        bytesBuffered -= 3;
+        paletteBytes   = 3 * ((uint16_t)b + 1);
+        palettePos     = 0;
+        nibble         = (b < 16) ? 1 : 0;    // Two indices a byte?
+        n              = 256 * (uint16_t)hi + lo;
+        need           = nibble ? (n / 2 + 1L) : (n + 1L);
+        // The payload must be exactly that; if not, or the palette is
+        // too big for us, look for the next header.
+        if((paletteBytes > 3 * PALETTESIZE) ||
+           (bytesRemaining != 3L + paletteBytes + need)) {
+          counters.skipped += 3;
+          paletteBytes = 0;
+          mode         = MODE_HEADER;
+          break;
+        }
+        indexBytes     = need;
+        bytesRemaining = 3L * ((long)n + 1L);
+      }
+      while((palettePos < paletteBytes) && (bytesBuffered > 0)) {
+        palette[palettePos++] = buffer[indexOut++ & mask];
+        bytesBuffered--;
+      }
+      if(palettePos == paletteBytes) {
+        paletteBytes = 0;
+        startFrame(1);
+      }
+      break;
+
+     case MODE_HOLD:
+
+      // Ostensibly "waiting for the latch from the prior frame
+      // to complete" mode, but may also revert to this mode when
+      // underrun prevention necessitates a delay.
+
+      t = clock.micros() - startTime;
+      if(t < (unsigned long)hold) break; // Still holding; keep buffering
+      if(underrun) {
+        counters.holdMicros += t;
+        underrun = 0;
+      }
+
+      // Latch/delay complete.  Advance to data-issuing mode...
+      sink.indicator(false); // LED off
+      mode = MODE_DATA;      // ...and fall through (no break):
+
+     case MODE_DATA:
+
+      while(spiFlag && !sink.ready()); // Wait for prior byte
+      if(bytesRemaining > 0) {
+        // Issue up to a packet's worth of bytes before going back for
+        // more serial data; waiting on SPI between them here costs less
+        // than a trip round the loop.
+        for(n = 0; (n < 64) && (bytesRemaining > 0); n++) {
+          if(fromFrame) {
+            // Resident frame is already in RAM; no underrun possible.
+            b = frame[framePos++];
+          } else if(indexed) {
+            // Palette frame: a new index every three bytes (two to a
+            // byte when 4-bit, high half first).
+            if(component == 0) {
+              if(nibble == 2) {
+                b      = held;
+                nibble = 1;
+              } else {
+                if(starved(indexBytes)) break;
+                b = buffer[indexOut++ & mask];
+                bytesBuffered--;
+                indexBytes--;
+                if(nibble) {
+                  held   = b & 0x0f;
+                  b    >>= 4;
+                  nibble = 2;
+                }
+              }
+              colour = &palette[3 * (uint16_t)b];
+            }
+            b = colour[component];
+            if(++component == 3) component = 0;
+            if(framePos < FRAMESIZE) frame[framePos++] = b;
+          } else {
+            if(starved(bytesRemaining)) break;
+            b = buffer[indexOut++ & mask];
+            if(framePos < FRAMESIZE) frame[framePos++] = b;
+            bytesBuffered--;
+          }
+#ifdef COLOURTABLE
+          b = pgm_read_byte(&colourTable[channel][b]);
+          if(++channel == 3) channel = 0;
+#endif
+          while(spiFlag && !sink.ready()); // Wait for prior byte
+          sink.write(b);                   // Issue next byte
+          spiFlag = 1;
+          bytesRemaining--;
+        }
+      } else {
+        // End of data -- issue latch:
+        if(!fromFrame) frameBytes = framePos;
+        fromFrame  = 0;
+        indexed    = 0;
+        startTime  = clock.micros();
+        hold       = 1000;        // Latch duration = 1000 uS
+        sink.indicator(true);     // LED on
+        mode       = MODE_HEADER; // Begin next header search
+        counters.latched++;
+      }
+    } // end switch
+  }
+
+  // Current mode (MODE_HEADER etc.), for tests.
+  uint8_t getMode(void) { return mode; }
+
+  // Counters so far, as a telemetry packet would report them.
+  const LEDstreamCounters &getCounters(void) {
+    counters.millis = clock.millis();
+    return counters;
+  }
+
+ private:
+
+  // Shift out a frame as it arrives (once the latch from the prior frame
+  // is over): its bytes, or if palette, the colours its indices pick.
+  void startFrame(uint8_t indices) {
+    framePos  = 0;
+    fromFrame = 0;
+    indexed   = indices;
+    channel   = 0;
+    component = 0;
+    spiFlag   = 0;         // No data out yet
+    mode      = MODE_HOLD; // Proceed to latch wait mode
+  }
+
+  // Shift out the resident frame (once the latch from the prior frame is
+  // over).
+  void showFrame(void) {
+    bytesRemaining = frameBytes;
+    framePos       = 0;
+    fromFrame      = 1;
+    channel        = 0;
+    spiFlag        = 0;
+    mode           = MODE_HOLD;
+  }
+
+  // If the serial buffer is threatening to underrun, with more than it
+  // holds still to come, start introducing progressively longer pauses
+  // to allow more data to arrive (up to a point).  True if pausing.
+  bool starved(int32_t needed) {
+    if((bytesBuffered >= 32) || (needed <= bytesBuffered)) return false;
+    startTime = clock.micros();
+    hold      = 100 + (32 - bytesBuffered) * 10;
+    mode      = MODE_HOLD;
+    underrun  = 1;
+    counters.holds++;
+    return true;
+  }
+
+  void ack(void) {
+    source.write((const uint8_t *)"Ada\n", 4); // Send ACK string to host
+  }
+
+  // Telemetry packet in place of an ACK.  Built on the stack and sent in
+  // one write, so nothing is kept for it between reports.
+  void telemetry(unsigned long t) {
+    uint8_t  packet[MAGICSIZE + 2 + 4 * TELEMETRYSIZE], chk = 0x55, *p;
+    uint32_t c[TELEMETRYSIZE], v;
+
+    counters.millis = t;
+    memcpy(c, &counters, sizeof(c));
+    memcpy(packet, telemetryReply, MAGICSIZE);
+    packet[MAGICSIZE] = 4 * TELEMETRYSIZE;
+    p = &packet[MAGICSIZE + 1];
+    for(uint8_t k = 0; k < TELEMETRYSIZE; k++) {
+      v = c[k];
+      *p++ = v >> 24;
+      *p++ = v >> 16;
+      *p++ = v >> 8;
+      *p++ = v;
+    }
+    for(p = &packet[MAGICSIZE + 1]; p < &packet[sizeof(packet) - 1]; p++) chk ^= *p;
+    *p = chk;
+    source.write(packet, sizeof(packet));
+    lastTelemetryTime = t;
+  }
+
+  // Shift out zeros to as many LEDs as could plausibly be connected,
+  // then wait out the latch.
+  void blackout(void) {
+    unsigned long t;
+    for(uint16_t n=0; n<32767; n++) {
+      sink.write(0);
+      while(!sink.ready());
+    }
+    spiFlag = 0;
+    for(t = clock.micros(); (clock.micros() - t) < 1000; ); // Latch
+  }
+
+  Source &source;
+  Sink   &sink;
+  Clock  &clock;
+
+  // Circular buffer for serial data.  Its size is a power of two so
+  // that wrapping around is a mask rather than a test.
+  uint8_t
+    buffer[RingSize],
+    frame[FRAMESIZE],        // Resident copy of the last frame shown
+    palette[3 * PALETTESIZE],// Colours of the palette frame coming in
+    *colour;                 // Palette entry of the pixel going out
+  Index
+    indexIn,
+    indexOut;
+  uint8_t
+    mode,
+    fromFrame,               // If 1, MODE_DATA shifts out frame[]
+    staged,                  // If 1, MODE_DELTA doesn't show the result
+    underrun,                // If 1, MODE_HOLD is waiting for serial data
+    indexed,                 // If 1, MODE_DATA shifts out palette colours
+    component,               // Of the palette colour going out (0-2)
+    nibble,                  // 4-bit indices: 1, or 2 with one in held
+    held,
+    channel,                 // Of the next byte out (0-2), for COLOURTABLE
+    spiFlag;
+  int16_t
+    bytesBuffered,
+    hold;
+  uint16_t
+    frameBytes,              // Bytes of frame[] holding valid data
+    framePos,                // Next frame[] byte to store or shift out
+    runBytes,                // Bytes left in the current delta record
+    paletteBytes,            // Size of the palette coming in, 0 before
+    palettePos,              // Palette bytes read so far
+    indexBytes,              // Palette frame index bytes still to come
+    telemetryPeriod;         // Milliseconds between reports; 0 for none
+  int32_t
+    bytesRemaining;
+  unsigned long
+    startTime,
+    lastByteTime,
+    lastAckTime,
+    lastTelemetryTime;
+  LEDstreamCounters
+    counters;
+};
+
+#endif // _LEDSTREAMCORE_H_
@@ -29,6 +29,7 @@
 import java.awt.*;
 import java.awt.image.*;
 import processing.serial.*;
+import java.util.concurrent.*;
 
 // CONFIGURABLE PROGRAM CONSTANTS --------------------------------------------
 
@@ -64,6 +65,34 @@ static final boolean useFullScreenCaps = true;
 
 static final int timeout = 5000; // 5 seconds
 
+// Delta frames send only the runs of LEDs that changed since the last
+// frame, which is much faster over a slow serial link when little of the
+// wall changes.  A full frame is still sent every keyframeInterval frames
+// (and whenever the delta wouldn't be smaller), so the board recovers
+// from any lost bytes.  Set useDeltaFrames to false for boards running
+// the older LEDstream code, which only understands full frames.
+
+static final boolean useDeltaFrames   = true;
+static final int     keyframeInterval = 60;
+
+// A wall too big for one board (or too slow on one serial link) can be
+// split across several boards, each on its own serial port and driving
+// its own run of the leds[] list below, in strand order, starting from
+// its own first LED.  Each run can be at most 200 LEDs (the size of
+// LEDstream's resident frame).  Every frame, each board is sent just its
+// part -- all ports at once, from separate threads -- and once every part
+// has gone out, a latch command goes to every board so they all show the
+// new frame together.  Each entry is a port name and the number of LEDs
+// on that board; the runs follow each other along leds[].  Leave empty to
+// use the single port opened in initialize().
+
+static final String controllerPorts[] = {
+//  "/dev/ttyACM0", "/dev/ttyACM1"
+};
+static final int    controllerLeds[]  = {
+//  99, 99
+};
+
 // PER-DISPLAY INFORMATION ---------------------------------------------------
 
 // This array contains details for each display that the software will
@@ -120,7 +149,9 @@ static final int leds[][] = new int[][] {
 // GLOBAL VARIABLES ---- You probably won't need to modify any of this -------
 
 byte[]           serialData  = new byte[6 + leds.length * 3];
-byte[]           serialCopy  = new byte[6 + leds.length * 3];
+byte[]           serialCopy  = new byte[6 + leds.length * 3]; // Last frame sent
+byte[]           deltaData   = new byte[6 + leds.length * 3];
+int              framesSinceKeyframe = keyframeInterval; // First frame is full
 short[][]        ledColor    = new short[leds.length][3],
                  prevColor   = new short[leds.length][3];
 byte[][]         gamma       = new byte[256][3];
@@ -132,6 +163,8 @@ int[][]          pixelOffset = new int[leds.length][256],
                  screenData; // Alloc'd only if full-screen captures
 PImage[]         preview     = new PImage[displays.length];
 Serial           port;
+Controller[]     controllers = new Controller[controllerPorts.length];
+ExecutorService  writers;    // One thread per controller
 DisposeHandler   dh; // For disabling LEDs on exit
 
 int              w           = 18;
@@ -196,7 +229,7 @@ void draw () {
   
   preview();
   
-  if(port != null) port.write(serialData); // Issue data to Arduino
+  sendFrame(); // Issue data to Arduino
   
 //  println(frameRate); // How are we doing?
 
@@ -206,6 +239,132 @@ void draw () {
 
 // HELPER FUNCTIONS ----------------------------------------------------------
 
+// Sends serialData to the board, as a delta frame when possible, else as
+// a full 'Ada' frame.  With several controllers, each gets its own part.
+void sendFrame() {
+  boolean keyframe = !useDeltaFrames ||
+    (framesSinceKeyframe >= keyframeInterval);
+  int     n        = -1;
+
+  if(controllers.length > 0) {
+    sendToControllers(keyframe);
+  } else {
+    if(!keyframe) n = encodeDelta();
+    if(port != null) {
+      if(n < 0) port.write(serialData);
+      else      port.write(java.util.Arrays.copyOf(deltaData, n));
+    }
+    keyframe = (n < 0);
+  }
+  framesSinceKeyframe = keyframe ? 0 : framesSinceKeyframe + 1;
+  arraycopy(serialData, serialCopy);
+}
+
+// One of several boards sharing the wall: its port and its run of LEDs.
+class Controller implements Callable<Object> {
+  Serial port;
+  int    first, count;       // Run of leds[]
+  byte[] data;               // Staged frame being sent
+  int    length;
+
+  Controller(Serial port, int first, int count) {
+    this.port  = port;
+    this.first = first;
+    this.count = count;
+    // Worst case: a record header (3 bytes) for every LED, plus its data
+    data       = new byte[7 + count * 6];
+  }
+
+  // Writes the staged frame; run on this controller's own thread
+  public Object call() {
+    port.write(java.util.Arrays.copyOf(data, length));
+    return null;
+  }
+}
+
+// Sends each controller its part of the frame as a staged frame (all of
+// it on keyframes, else just the changed runs), waits until every part is
+// out, then latches all of them.
+void sendToControllers(boolean keyframe) {
+  java.util.List<Future<Object>> pending = new java.util.ArrayList<Future<Object>>();
+  byte[] latch = { 'A', 'd', 'L', 0, 0, 0x55 };
+
+  for(Controller c : controllers) {
+    c.length = encodeRecords(c.data, 'S', c.first, c.first + c.count, keyframe);
+    pending.add(writers.submit(c));
+  }
+  for(Future<Object> f : pending) {
+    try {
+      f.get();
+    }
+    catch(Exception e) {
+      System.out.println("Controller write failed: " + e);
+    }
+  }
+  for(Controller c : controllers) c.port.write(latch);
+}
+
+// True if LED i differs between serialData and the last frame sent
+boolean ledChanged(int i) {
+  int k = 6 + i * 3;
+  return (serialData[k]     != serialCopy[k])     ||
+         (serialData[k + 1] != serialCopy[k + 1]) ||
+         (serialData[k + 2] != serialCopy[k + 2]);
+}
+
+// Builds a delta frame in deltaData; see LEDstream for the format.
+// Returns the frame length, or -1 if a full frame would be no larger.
+int encodeDelta() {
+  int n = encodeRecords(deltaData, 'D', 0, leds.length, false);
+  return (n >= serialData.length) ? -1 : n;
+}
+
+// Builds a frame of change records in out[] for LEDs first to end - 1
+// (which the board numbers from 0), of the given type ('D' delta, 'S'
+// staged).  Each run of changed LEDs (or all of them, if all is true)
+// becomes one record (starting LED, count - 1, RGB data).  Single
+// unchanged LEDs between two runs are sent anyway, as that costs the
+// same as the 3-byte header of a new record.  Returns the frame length,
+// or out.length if it doesn't fit.
+int encodeRecords(byte[] out, char type, int first, int end, boolean all) {
+  int i = first, start, stop, count, n = 6;
+
+  while(i < end) {
+    if(!all && !ledChanged(i)) {
+      i++;
+      continue;
+    }
+    start = i;
+    stop  = i + 1; // Exclusive
+    while((stop < end) && (stop - start < 256)) {
+      if(all || ledChanged(stop)) {
+        stop++;
+      } else if((stop + 1 < end) && (stop + 2 - start <= 256) &&
+                ledChanged(stop + 1)) {
+        stop += 2;
+      } else {
+        break;
+      }
+    }
+    count = stop - start;
+    if(n + 3 + count * 3 >= out.length) return out.length;
+    out[n++] = (byte)((start - first) >> 8);
+    out[n++] = (byte)((start - first) & 0xff);
+    out[n++] = (byte)(count - 1);
+    arraycopy(serialData, 6 + start * 3, out, n, count * 3);
+    n += count * 3;
+    i  = stop;
+  }
+
+  out[0] = 'A';                                  // Magic word
+  out[1] = 'd';
+  out[2] = (byte)type;                           // Frame type
+  out[3] = (byte)((n - 6) >> 8);                 // Payload size high byte
+  out[4] = (byte)((n - 6) & 0xff);               // Payload size low byte
+  out[5] = (byte)(out[3] ^ out[4] ^ 0x55);       // Checksum
+  return n;
+}
+
 // Show live preview image(s)
 void preview() {
   color c;
@@ -310,6 +469,10 @@ public class DisposeHandler {
 //    Arrays.fill(serialData, 6, serialData.length, (byte)0);
     java.util.Arrays.fill(serialData, 6, serialData.length, (byte)0);
     if(port != null) port.write(serialData);
+    if(controllers.length > 0) {
+      sendToControllers(true);
+      writers.shutdown();
+    }
   }
 }
 
@@ -338,6 +501,15 @@ void initialize() {
   // And finally, to test the software alone without an Arduino connected,
   // don't open a port...just comment out the serial lines above.
 
+  // With several controllers, open each one's port instead.
+  for(d=0, i=0; d<controllers.length; i+=controllerLeds[d], d++) {
+    controllers[d] = new Controller(new Serial(this, controllerPorts[d], 115200),
+      i, controllerLeds[d]);
+  }
+  if(controllers.length > 0) {
+    writers = Executors.newFixedThreadPool(controllers.length);
+  }
+
   // Initialize screen capture code for each display's dimensions.
   dispBounds = new Rectangle[displays.length];
   if(useFullScreenCaps == true) {
@@ -64,6 +64,18 @@ static final boolean useFullScreenCaps = true;
 
 static final int timeout = 5000; // 5 seconds
 
+// Overall LED brightness, applied along with the gamma curve and white
+// balance (0.0 to 1.0).
+
+static final float brightness = 1.0;
+
+// Colours are corrected to more precision than the 8 bits sent; rounding
+// each frame on its own turns the dimmest levels off entirely.  With
+// dithering, each LED's rounding error is carried over to its next frame,
+// so dim colours average out to the right level instead.
+
+static final boolean useDithering = true;
+
 // PER-DISPLAY INFORMATION ---------------------------------------------------
 
 // This array contains details for each display that the software will
@@ -122,7 +134,8 @@ static final int leds[][] = new int[][] {
 byte[]           serialData  = new byte[6 + leds.length * 3];
 short[][]        ledColor    = new short[leds.length][3],
                  prevColor   = new short[leds.length][3];
-byte[][]         gamma       = new byte[256][3];
+int[][]          gamma       = new int[256][3];  // 8.8 fixed point
+int[]            dither      = new int[leds.length * 3]; // Carried error
 int              nDisplays   = displays.length;
 Robot[]          bot         = new Robot[displays.length];
 Rectangle[]      dispBounds  = new Rectangle[displays.length],
@@ -251,10 +264,31 @@ void setup() {
 
   // Pre-compute gamma correction table for LED brightness levels:
   for(i=0; i<256; i++) {
-    f           = pow((float)i / 255.0, 2.8);
-    gamma[i][0] = (byte)(f * 255.0);
-    gamma[i][1] = (byte)(f * 240.0);
-    gamma[i][2] = (byte)(f * 220.0);
+    f           = pow((float)i / 255.0, 2.8) * brightness * 256.0;
+    gamma[i][0] = min(65280, (int)(f * 255.0 + 0.5));
+    gamma[i][1] = min(65280, (int)(f * 240.0 + 0.5));
+    gamma[i][2] = min(65280, (int)(f * 220.0 + 0.5));
+  }
+  // Carried errors start at half a step, so levels round to nearest
+  java.util.Arrays.fill(dither, 128);
+}
+
+// Apply gamma curve, white balance and brightness to the whole frame and
+// place it in the serial output buffer, in one pass.
+void correctColours() {
+  int i, c, v, k = 0;
+
+  for(i=0; i<leds.length; i++) {
+    for(c=0; c<3; c++, k++) {
+      v = gamma[ledColor[i][c]][c];
+      if(useDithering) {
+        v        += dither[k];
+        dither[k] = v & 0xff;
+      } else {
+        v        += 128;
+      }
+      serialData[6 + k] = (byte)(v >> 8);
+    }
   }
 }
 
@@ -309,7 +343,7 @@ Serial openPort() {
 
 void draw () {
   BufferedImage img;
-  int           d, i, j, o, c, weight, rb, g, sum, deficit, s2;
+  int           d, i, o, c, weight, rb, g, sum, deficit, s2;
   int[]         pxls, offs;
 
   if(useFullScreenCaps == true ) {
@@ -323,7 +357,6 @@ void draw () {
   }
 
   weight = 257 - fade; // 'Weighting factor' for new frame vs. old
-  j      = 6;          // Serial led data follows header / magic word
 
   // This computes a single pixel value filtered down from a rectangular
   // section of the screen.  While it would seem tempting to use the native
@@ -381,15 +414,13 @@ void draw () {
       }
     }
 
-    // Apply gamma curve and place in serial output buffer
-    serialData[j++] = gamma[ledColor[i][0]][0];
-    serialData[j++] = gamma[ledColor[i][1]][1];
-    serialData[j++] = gamma[ledColor[i][2]][2];
     // Update pixels in preview image
     preview[d].pixels[leds[i][2] * displays[d][1] + leds[i][1]] =
      (ledColor[i][0] << 16) | (ledColor[i][1] << 8) | ledColor[i][2];
   }
 
+  correctColours(); // Into serial output buffer
+
   for(int x = 0; x < w; x++) {
     for (int y = 0; y < h; y++) {
       spc(x,y,32); 
@@ -29,7 +29,6 @@
 import java.awt.*;
 import java.awt.image.*;
 import processing.serial.*;
-import java.util.concurrent.ArrayBlockingQueue;
 import ddf.minim.*;
 import ddf.minim.analysis.*;
 
@@ -327,9 +326,15 @@ void clearBackground(int c) {
 
 // SKETCH SPECIFIC FUNCTIONS -------------------------------------------------
 
-// Performs one iteration, mixing a pixels adjacent colours
+// Performs one iteration, mixing a pixels adjacent colours.  Each channel
+// is the running average of the pixel and its neighbours (right, below,
+// left, above), as Colour.colourAdd() did it, in plain ints -- no objects
+// per pixel.
+int[] nbr = new int[4];
+
 void iterate() {
-   int new_i, new_j;
+   int new_i, new_j, n, c, r, g, b, norm;
+   float s;
    byte[][] dir = {{1,0},{0,1},{-1,0},{0,-1}};
    
    // Swap the byte buffers
@@ -337,82 +342,76 @@ void iterate() {
    serialCopy = serialData;
    serialData = temp;
    
-   Colour c;
-   ArrayList<Colour> loc;
    for(int x = 0; x < w; x++) {
      for(int y = 0; y < h; y++) {
        
-       c = new Colour(gpc(x,y));
-       
-       loc = new ArrayList<Colour>();
+       c = gpc(x,y);
+       r = (c >> 16) & 255;
+       g = (c >> 8) & 255;
+       b = c & 255;
        
+       n = 0;
        for (int k = 0; k < 4; k++) {
          new_i = x + dir[k][0];
          new_j = y + dir[k][1];
          if (new_i >= w || new_j >= h || new_i < 0 || new_j < 0)
            continue;
-         loc.add(new Colour(gpc(new_i, new_j)));
+         nbr[n++] = gpc(new_i, new_j);
        }
        
-       c.colourAdd(loc);
-       if (c.colourNorm() > 200)
-         c.colourScale(0.8);
-       else {
-         if (c.colourNorm() > 50)
-           c.colourScale(0.9);
-         else
-           c.colourScale(1.05);
+       for (int i = 0; i < n; i++) {
+         r = (i+1)*r/(i+2) + ((nbr[i] >> 16) & 255)/(i+2);
+         g = (i+1)*g/(i+2) + ((nbr[i] >> 8) & 255)/(i+2);
+         b = (i+1)*b/(i+2) + (nbr[i] & 255)/(i+2);
        }
+       norm = max(r,g,b);
+       s = (norm > 200) ? 0.8 : (norm > 50) ? 0.9 : 1.05;
+       r *= s;
+       g *= s;
+       b *= s;
        
-       spc(x,y,c);
+       spc(x,y,(r << 16) + (g << 8) + b);
        
      }
    }
    
 }
 
+// Falloff of a pulse, 0.8 / d^1.5, by offset: falloff[dy*w + dx].  Worked
+// out once, instead of a pow() for every pixel of every pulse.
+float[] falloff = null;
+
 void pulse(int x, int y, int colour) {
-  byte[][] dir = {{1,0},{0,1},{-1,0},{0,-1}};
+  int i, j, c, r, g, b, cr, cg, cb;
+  float s;
+
+  if (falloff == null) {
+    falloff = new float[w*h];
+    for (j = 0; j < h; j++)
+      for (i = 0; i < w; i++)
+        if (i > 0 || j > 0)
+          falloff[j*w + i] = 1/pow(i*i + j*j, 0.75);
+  }
 
-  int i, j, new_i, new_j;
-  Colour c, cc,o;
-  
-  // Map of already accessed pixels
-  byte[] m = new byte[w*h];
-  
-  // Set m's elements to 0
-  for (i = 0; i < w*h; i++)
-    m[i] = 0;
-  
-  // Initialize queue for BFS
-  ArrayBlockingQueue<Integer> q = new ArrayBlockingQueue<Integer>(2*w*h);
-  q.add(x);
-  q.add(y);
-  c = new Colour(colour);
-  spc(x,y,c);
-  
-  while (q.size() != 0) {
-     i = q.remove();
-     j = q.remove();
-     // Set element as accessed
-     m[j * w + i] = 1;
-     
-     for (int k = 0; k < 4; k++) {
-       new_i = i + dir[k][0];
-       new_j = j + dir[k][1];
-       if (new_i >= w || new_j >= h || new_i < 0 || new_j < 0)
-         continue;
-       if (m[new_j * w + new_i] == 0) {
-         o = new Colour(gpc(new_i, new_j));
-         cc = new Colour(c.returnInt());
-         cc.colourScale(1/pow((x-new_i)*(x-new_i) + (y-new_j)*(y-new_j), 0.75));
-         o.colourAdd(cc);
-         spc(new_i,new_j, o);
-         q.add(new_i);
-         q.add(new_j);
-         m[new_j * w + new_i] = 1;
-       }
-     }
+  cr = (colour >> 16) & 255;
+  cg = (colour >> 8) & 255;
+  cb = colour & 255;
+  spc(x,y,colour);
+
+  // Every other pixel gains 0.8 of the colour scaled by the falloff (the
+  // whole wall, as the BFS reached it), capped rather than overflowing
+  // into the next channel
+  for (i = 0; i < w; i++) {
+    for (j = 0; j < h; j++) {
+      if (i == x && j == y)
+        continue;
+      s = falloff[abs(j - y)*w + abs(i - x)];
+      c = gpc(i, j);
+      r = min(255, (int) (((c >> 16) & 255) + 0.8*((int) (cr*s))));
+      g = min(255, (int) (((c >> 8) & 255) + 0.8*((int) (cg*s))));
+      b = min(255, (int) ((c & 255) + 0.8*((int) (cb*s))));
+      spc(i,j, (r << 16) + (g << 8) + b);
+    }
   }
 }
 
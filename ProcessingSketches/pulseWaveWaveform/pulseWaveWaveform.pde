@@ -122,7 +122,13 @@ static final int leds[][] = new int[][] {
 
 // GLOBAL VARIABLES ---- You probably won't need to modify any of this -------
 
-ArrayBlockingQueue<Integer> pulses = new ArrayBlockingQueue<Integer>(100);
+// Pulse waves in flight: centre, radius and colour of each
+static final int maxPulses = 25;
+int[]            pulseX      = new int[maxPulses],
+                 pulseY      = new int[maxPulses],
+                 pulseR      = new int[maxPulses],
+                 pulseC      = new int[maxPulses];
+int              pulseCount  = 0;
 byte[]           bg          = new byte[6 + leds.length * 3];
 byte[]           bgCopy      = new byte[6 + leds.length * 3];
 byte[]           serialData  = new byte[6 + leds.length * 3];
@@ -391,18 +397,27 @@ void approxWaveform() {
 
 // Creates a new pulse
 void newPulse(int x, int y, int c) {
-  pulses.add(x);
-  pulses.add(y);
-  pulses.add(1);
-  pulses.add(c); 
+  if (pulseCount == maxPulses)
+    return;
+  pulseX[pulseCount] = x;
+  pulseY[pulseCount] = y;
+  pulseR[pulseCount] = 1;
+  pulseC[pulseCount] = c;
+  pulseCount++;
 }
 
-// Performs one iteration, mixing a pixels adjacent colours
+// Performs one iteration, mixing a pixels adjacent colours.  Each channel
+// is the running average of the pixel and its neighbours (right, below,
+// left, above), as Colour.colourAdd() did it, in plain ints -- no objects
+// per pixel.
+int[] nbr = new int[4];
+
 void iterate() {
   
    pulseWave();
   
-   int new_i, new_j;
+   int new_i, new_j, n, c, r, g, b, norm;
+   float s;
    byte[][] dir = {{1,0},{0,1},{-1,0},{0,-1}};
    
    // Swap the byte buffers
@@ -410,81 +425,76 @@ void iterate() {
    bg = bgCopy;
    bgCopy = temp;
    
-   Colour c;
-   ArrayList<Colour> loc;
    for(int x = 0; x < w; x++) {
      for(int y = 0; y < h; y++) {
        
-       c = new Colour(gpc(x,y,bgCopy));
-       
-       loc = new ArrayList<Colour>();
+       c = gpc(x,y,bgCopy);
+       r = (c >> 16) & 255;
+       g = (c >> 8) & 255;
+       b = c & 255;
        
+       n = 0;
        for (int k = 0; k < 4; k++) {
          new_i = x + dir[k][0];
          new_j = y + dir[k][1];
          if (new_i >= w || new_j >= h || new_i < 0 || new_j < 0)
            continue;
-         loc.add(new Colour(gpc(new_i, new_j, bgCopy)));
+         nbr[n++] = gpc(new_i, new_j, bgCopy);
        }
        
-       c.colourAdd(loc);
-       if (c.colourNorm() > 200)
-         c.colourScale(0.7);
-       else {
-         if (c.colourNorm() > 50)
-           c.colourScale(0.8);
-         else
-           c.colourScale(1.05);
+       for (int i = 0; i < n; i++) {
+         r = (i+1)*r/(i+2) + ((nbr[i] >> 16) & 255)/(i+2);
+         g = (i+1)*g/(i+2) + ((nbr[i] >> 8) & 255)/(i+2);
+         b = (i+1)*b/(i+2) + (nbr[i] & 255)/(i+2);
        }
-       spc(x,y,c,bg);
+       norm = max(r,g,b);
+       s = (norm > 200) ? 0.7 : (norm > 50) ? 0.8 : 1.05;
+       r *= s;
+       g *= s;
+       b *= s;
+       spc(x,y,(r << 16) + (g << 8) + b,bg);
        
      }
    }
    
 }
 
-// Performs all of the pulse waves
+// Performs all of the pulse waves: pixels within each one's radius fade
+// to 0.8 and gain 0.8 of its colour (capped, rather than overflowing into
+// the next channel); then it grows, up to a radius of 5.
 void pulseWave() {
   
-  ArrayBlockingQueue<Integer> next = new ArrayBlockingQueue<Integer>(100);
+  int x, y, r, c, o, k, n = 0;
   
-  int x;
-  int y;
-  int r;
-  int colour;
-  Colour c,cc,o;
-  
-  while(pulses.size() != 0) {
-    x = pulses.remove();
-    y = pulses.remove();
-    r = pulses.remove();
-    colour = pulses.remove();
-    c = new Colour(colour);
+  for (k = 0; k < pulseCount; k++) {
+    x = pulseX[k];
+    y = pulseY[k];
+    r = pulseR[k];
+    c = pulseC[k];
     
-    for (int i = 0; i < w; i++) {
-      for (int j = 0; j < h; j++) {
+    for (int i = max(0, x - r); i <= min(w - 1, x + r); i++) {
+      for (int j = max(0, y - r); j <= min(h - 1, y + r); j++) {
         if ((x-i)*(x-i) + (y-j)*(y-j) <= r*r) {
-          o = new Colour(gpc(i, j, bg));
-          o.colourScale(0.8);
-          cc = new Colour(c.returnInt());
-//          cc.colourScale(1/pow((x-i)*(x-i) + (y-j)*(y-j), 0.5));
-          o.colourAdd(cc);
-          spc(i,j, o, bg);
-          
+          o = gpc(i, j, bg);
+          int or = min(255, (int) ((int) (((o >> 16) & 255) * 0.8) + 0.8*((c >> 16) & 255)));
+          int og = min(255, (int) ((int) (((o >> 8) & 255) * 0.8) + 0.8*((c >> 8) & 255)));
+          int ob = min(255, (int) ((int) ((o & 255) * 0.8) + 0.8*(c & 255)));
+          spc(i,j, (or << 16) + (og << 8) + ob, bg);
         }
       }
     }
     
+    // Keep the ones still growing, in order
     if (r < 5) {
-      next.add(x);
-      next.add(y);
-      next.add(r+1);
-      next.add(colour); 
+      pulseX[n] = x;
+      pulseY[n] = y;
+      pulseR[n] = r + 1;
+      pulseC[n] = c;
+      n++;
     }
-    
   }
   
-  pulses = next;
+  pulseCount = n;
   
 }
 
@@ -138,16 +138,25 @@ int              w           = 18;
 int              h           = 11;
 int              iterCnt     = 0;
 
-// Board with soluntion at time t
-float[][]          wb        = new float[w+2][h+2];
-// Board with solution at time t-1
-float[][]          wbc       = new float[w+2][h+2];
-// Board with solution at time t-2
-float[][]          wbcp      = new float[w+2][h+2];
+// Time steps per frame; more makes the waves move faster
+static final int substeps    = 1;
+// Set to drive the board with source() every step (it's evaluated for
+// every cell, so leave it off unless source() does something)
+static final boolean driven  = false;
+
+// The board, w+2 by h+2 (ghost cells round the edge), row after row in
+// one array: cell (i,j) is at j*ws + i.  wb is time t, wbp time t-1; a
+// step writes time t+1 over wbp (each cell only reads its own old value)
+// and swaps the two.
+int                ws        = w + 2;
+float[]            wb        = new float[ws * (h+2)];
+float[]            wbp       = new float[ws * (h+2)];
+float[]            src       = new float[ws * (h+2)];
 float dt                     = 0.05;
 float dx                     = 1./((float) w);
 float dy                     = 1./((float) h);
 float k                      = 0.1;
+float coef                   = k*dt*dt/(dx*dx);
 int waveIterCnt              = 0;
 
 // INITIALIZATION ------------------------------------------------------------
@@ -155,24 +164,15 @@ int waveIterCnt              = 0;
 void setup() {
   initialize();
   
-  // Boundary Conditions
-  for(int i = 0; i < w+1; i++) {
-    wb[i][0] = 0;
-    wb[i][h+1] = 0;
-  }
-  
-  for(int j = 0; j < h+1; j++) {
-    wb[0][j] = 0;
-    wb[w+1][j] = 0;
-  }
-  
-  // Initial Conditions to the wave equation
+  // Initial Conditions to the wave equation (still, so both levels match)
   for(int i = 1; i < w+1; i++) {
     for(int j = 1; j < h+1; j++) {
-      wb[i][j]  = exp(-50 * ((i*dx - 0.5)*(i*dx - 0.5)+(j*dy - 0.5)*(j*dy - 0.5)));
-      wbc[i][j] = exp(-50 * ((i*dx - 0.5)*(i*dx - 0.5)+(j*dy - 0.5)*(j*dy - 0.5)));
-    } 
+      wb[j*ws + i]  = exp(-50 * ((i*dx - 0.5)*(i*dx - 0.5)+(j*dy - 0.5)*(j*dy - 0.5)));
+      wbp[j*ws + i] = wb[j*ws + i];
+    }
   }
+  mirror(wb);
+  mirror(wbp);
 }
 
 // Open and return serial connection to Arduino running LEDstream code.  This
@@ -228,7 +228,7 @@ void draw () {
   
   preview();
   
-  if (iterCnt % 1 == 0)
+  for(int s = 0; s < substeps; s++)
     iterate();
     
   writeSerial(wb, serialData);
@@ -245,41 +245,42 @@ void draw () {
 
 // HELPER FUNCTIONS ----------------------------------------------------------
 
-// Writes solution in form to be sent to board
-void writeSerial(float[][] arr, byte[] to) {
+// Writes solution in form to be sent to board.  The two colours are
+// worked out once; each cell is then scaled straight into serialData.
+void writeSerial(float[] arr, byte[] to) {
+
+  int col = (iterCnt/2) % 255, t;
+  int r1, g1, b1, r2, g2, b2;
 
-  int col = (iterCnt/2) % 255;
-  
-  Colour c1, c2;
-  
   if (col < 85) {
-    c1 = new Colour(col * 3, 255 - col * 3, 0);
-    c2 = new Colour(0, 255 - col * 3, col * 3);
+    t = col * 3;
+    r1 = t;       g1 = 255 - t; b1 = 0;
+    r2 = 0;       g2 = 255 - t; b2 = t;
   } else if (col < 170) {
-   col -= 85;
-    c1 = new Colour(255 - col * 3, 0, col * 3);
-    c2 = new Colour(col * 3, 0, 255 - col * 3);
+    t = (col - 85) * 3;
+    r1 = 255 - t; g1 = 0;       b1 = t;
+    r2 = t;       g2 = 0;       b2 = 255 - t;
   } else {
-   col -= 170; 
-    c1 = new Colour(0, col * 3, 255 - col * 3);
-    c2 = new Colour(255 - col * 3, col * 3, 0);
+    t = (col - 170) * 3;
+    r1 = 0;       g1 = t;       b1 = 255 - t;
+    r2 = 255 - t; g2 = t;       b2 = 0;
   }
-  
-  Colour c;
-  for(int i = 1; i < w+1; i++) {
-    for (int j = 1; j < h+1; j++) {
-      if (arr[i][j] < 0)
-        c = new Colour(c1.returnInt());
-      else
-        c = new Colour(c2.returnInt());
-      c.colourScale(min(1., abs(arr[i][j])/1.5));
-      spc(i-1,j-1, c);
-     
-//      print(abs(arr[i][j]) + " ");
-    } 
+
+  for (int j = 0; j < h; j++) {
+    // Odd rows run right to left on the wall
+    int n   = 6 + 3*w*j + ((j % 2 == 0) ? 0 : 3*(w - 1));
+    int dir = (j % 2 == 0) ? 3 : -3;
+    int row = (j+1)*ws + 1;
+    for (int i = 0; i < w; i++, n += dir) {
+      float v = arr[row + i];
+      float s = min(1., abs(v)/1.5);
+      if (v < 0) {
+        to[n] = (byte) (int) (r1 * s); to[n+1] = (byte) (int) (g1 * s); to[n+2] = (byte) (int) (b1 * s);
+      } else {
+        to[n] = (byte) (int) (r2 * s); to[n+1] = (byte) (int) (g2 * s); to[n+2] = (byte) (int) (b2 * s);
+      }
+    }
   }
-//  println();
-//  println();
 }
 // Show live preview image(s)
 void preview() {
@@ -370,49 +371,42 @@ void clearBackground(int c) {
 
 // Performs one iteration of solving the wave equation
 void iterate() {
-   // swap pointers
-   float[][] temp;
-   temp = wbc;
-   wbc = wbcp;
-   wbcp = temp;
-   
-   temp = wb;
-   wb = wbc;
-   wbc = temp;
-   
-   for(int i = 1; i < w+1; i++) {
-     for (int j = 1; j < h+1; j++) {
-       wb[i][j] = 2*wbc[i][j] - wbcp[i][j] 
-                    + k*dt*dt/(dx*dx) * (wbc[i+1][j] - 2*wbc[i][j] + wbc[i-1][j]
-                                         + wbc[i][j+1] - 2*wbc[i][j] + wbc[i][j-1])
-                  - source(i*dx,j*dy,dt*waveIterCnt++);
-     }
+   if (driven) {
+     for(int j = 1; j < h+1; j++)
+       for(int i = 1; i < w+1; i++)
+         src[j*ws + i] = source(i*dx, j*dy, dt*waveIterCnt);
    }
-   
-   for(int j = 0; j < h+2; j++) {
-     wb[0][j] = wb[2][j];
-     wb[w+1][j] = wb[w-1][j]; 
-   }
-   for(int i = 0; i < w+2; i++) {
-     wb[i][0] = wb[i][2];
-     wb[i][h+1] = wb[i][h-1]; 
+
+   for(int j = 1; j < h+1; j++) {
+     int r = j*ws;
+     for (int i = 1; i < w+1; i++) {
+       float m = wb[r + i];
+       wbp[r + i] = 2*m - wbp[r + i]
+                    + coef * (wb[r + i+1] - 2*m + wb[r + i-1]
+                              + wb[r + ws + i] - 2*m + wb[r - ws + i])
+                    - src[r + i];
+     }
    }
-   
-/*
-  for(int i = 0; i < w+1; i++) {
-    wb[i][0] = wb[i][1];
-    wb[i][h+1] = wb[i][h];
-  }
-  
-  for(int j = 0; j < h+1; j++) {
-    wb[0][j] = wb[1][j];
-    wb[w+1][j] = wb[w][j];
-  }
-*/
+   mirror(wbp);
+
+   // swap pointers
+   float[] temp = wb;
+   wb = wbp;
+   wbp = temp;
 
    waveIterCnt++;
 }
 
+// Ghost cells take the value of the cell one in from the edge
+void mirror(float[] a) {
+   for(int j = 0; j < h+2; j++) {
+     a[j*ws] = a[j*ws + 2];
+     a[j*ws + w+1] = a[j*ws + w-1];
+   }
+   arraycopy(a, 2*ws, a, 0, ws);
+   arraycopy(a, (h-1)*ws, a, (h+1)*ws, ws);
+}
+
 // Source function
 float source(float x, float y, float t) {
 //  if (.3 < x && x < .7 && .3 < y && y < .7 && ((int) t) % 100 == 0)